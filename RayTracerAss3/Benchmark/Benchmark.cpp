@@ -0,0 +1,358 @@
+/*  Benchmark harness: runs any stage's renderer over the standard scene/size/sample matrix,
+reports the median and 95th percentile time of each configuration (and the rays/samples per second they work out to),
+and can write the results as CSV/JSON and compare them against a stored baseline. */
+
+#pragma warning(disable: 4996)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+// one scene/size/sample configuration of the matrix
+struct BenchmarkConfig
+{
+	const char* scene;
+	int width, height, samples;
+};
+
+// the configurations baseTiming.bat and stage4Timing.bat have always used
+static const BenchmarkConfig standardMatrix[] = {
+	{ "Scenes/cornell.txt",            1024, 1024, 1 },
+	{ "Scenes/cornell.txt",            1024, 1024, 4 },
+	{ "Scenes/cornell.txt",            1024, 1024, 16 },
+	{ "Scenes/allmaterials.txt",       1000, 1000, 4 },
+	{ "Scenes/5000spheres.txt",        1280, 720,  1 },
+	{ "Scenes/donuts.txt",             1024, 1024, 1 },
+	{ "Scenes/cornell-199lights.txt",  1024, 1024, 1 },
+};
+
+// timings of one configuration
+struct BenchmarkResult
+{
+	std::string name;
+	const BenchmarkConfig* config;
+	std::vector<double> times;				// milliseconds taken by each measured run
+
+	double median, p95;						// milliseconds
+	double mraysPerSecond, samplesPerSecond;
+
+	double baseline;						// median from the baseline file (0 if there isn't one)
+	bool regressed;
+};
+
+// name used for a configuration in the output and baseline files (e.g. cornell_1024x1024x4)
+static std::string configName(const BenchmarkConfig& config)
+{
+	const char* scene = strrchr(config.scene, '/');
+	scene = scene ? scene + 1 : config.scene;
+
+	std::string name(scene, strcspn(scene, "."));
+	char size[64];
+	sprintf(size, "_%dx%dx%d", config.width, config.height, config.samples);
+	return name + size;
+}
+
+// run the renderer once (it renders the configuration `runs` times) and return everything it printed
+static bool runRenderer(const char* exe, const char* extraArgs, const BenchmarkConfig& config, int runs, const char* outputDir, std::string& output)
+{
+	char command[2048];
+	snprintf(command, sizeof(command), "%s -runs %d -size %d %d -samples %d -input %s -output %s/benchmark_%s.bmp %s",
+		exe, runs, config.width, config.height, config.samples, config.scene, outputDir, configName(config).c_str(), extraArgs);
+
+	FILE* pipe = popen(command, "r");
+	if (pipe == NULL) return false;
+
+	char line[4096];
+	while (fgets(line, sizeof(line), pipe) != NULL) output += line;
+
+	return pclose(pipe) == 0;
+}
+
+// pull the time of each run out of the renderer's output, skipping the warm-up runs
+// (renderers with the phase timer print a line of JSON with every run's total_ms)
+static bool parseRunTimes(const std::string& output, int warmup, std::vector<double>& times)
+{
+	size_t json = output.find("{\"runs\":[");
+	if (json == std::string::npos) return false;
+
+	size_t end = output.find('\n', json);
+	int run = 0;
+	for (size_t pos = output.find("\"total_ms\":", json); pos != std::string::npos && pos < end; pos = output.find("\"total_ms\":", pos + 1), ++run)
+	{
+		if (run >= warmup) times.push_back(atof(output.c_str() + pos + strlen("\"total_ms\":")));
+	}
+	return !times.empty();
+}
+
+// pull the average time of the runs after the first out of an older stage's output (all it prints)
+static bool parseAverageTime(const std::string& output, double* time)
+{
+	size_t average = output.find("subsequent average time taken");
+	if (average == std::string::npos) return false;
+
+	size_t value = output.find("):", average);
+	if (value == std::string::npos || output.compare(value + 3, 3, "N/A") == 0) return false;
+	*time = atof(output.c_str() + value + 2);
+	return true;
+}
+
+// nearest-rank percentile of a sorted list
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.999999);
+	if (rank < 1) rank = 1;
+	if (rank > sorted.size()) rank = sorted.size();
+	return sorted[rank - 1];
+}
+
+static void calculateStatistics(BenchmarkResult& result)
+{
+	std::vector<double> sorted(result.times);
+	std::sort(sorted.begin(), sorted.end());
+
+	size_t n = sorted.size();
+	result.median = n % 2 ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+	result.p95 = percentile(sorted, 95.0);
+
+	// every sample casts one camera ray (an aaLevel x aaLevel grid per pixel), bounces and shadow rays aren't counted
+	double samples = (double)result.config->width * result.config->height * result.config->samples * result.config->samples;
+	result.samplesPerSecond = samples / (result.median / 1000.0);
+	result.mraysPerSecond = result.samplesPerSecond / 1e6;
+}
+
+// read the medians from a CSV file written by -csv
+static bool readBaseline(const char* filename, std::map<std::string, double>& medians)
+{
+	FILE* file = fopen(filename, "r");
+	if (file == NULL) return false;
+
+	char line[1024];
+	fgets(line, sizeof(line), file);		// header
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		char name[512];
+		double median;
+		if (sscanf(line, "%511[^,],%*d,%lf", name, &median) == 2) medians[name] = median;
+	}
+
+	fclose(file);
+	return true;
+}
+
+static bool writeCSV(const char* filename, const std::vector<BenchmarkResult>& results)
+{
+	FILE* file = fopen(filename, "w");
+	if (file == NULL) return false;
+
+	fprintf(file, "config,runs,median_ms,p95_ms,mrays_per_s,samples_per_s,baseline_ms\n");
+	for (const BenchmarkResult& r : results)
+	{
+		fprintf(file, "%s,%d,%.3f,%.3f,%.3f,%.0f,%.3f\n", r.name.c_str(), (int)r.times.size(), r.median, r.p95, r.mraysPerSecond, r.samplesPerSecond, r.baseline);
+	}
+
+	fclose(file);
+	return true;
+}
+
+static bool writeJSON(const char* filename, const char* exe, const char* extraArgs, const std::vector<BenchmarkResult>& results)
+{
+	FILE* file = fopen(filename, "w");
+	if (file == NULL) return false;
+
+	// backslashes in Windows paths need escaping
+	std::string exeEscaped, argsEscaped;
+	for (const char* c = exe; *c; ++c) { if (*c == '\\' || *c == '"') exeEscaped += '\\'; exeEscaped += *c; }
+	for (const char* c = extraArgs; *c; ++c) { if (*c == '\\' || *c == '"') argsEscaped += '\\'; argsEscaped += *c; }
+
+	fprintf(file, "{\"exe\":\"%s\",\"args\":\"%s\",\"configs\":[", exeEscaped.c_str(), argsEscaped.c_str());
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchmarkResult& r = results[i];
+		fprintf(file, "%s\n  {\"config\":\"%s\",\"median_ms\":%.3f,\"p95_ms\":%.3f,\"mrays_per_s\":%.3f,\"samples_per_s\":%.0f,", i == 0 ? "" : ",",
+			r.name.c_str(), r.median, r.p95, r.mraysPerSecond, r.samplesPerSecond);
+		if (r.baseline > 0.0) fprintf(file, "\"baseline_ms\":%.3f,\"regressed\":%s,", r.baseline, r.regressed ? "true" : "false");
+
+		fprintf(file, "\"times_ms\":[");
+		for (size_t j = 0; j < r.times.size(); ++j) fprintf(file, "%s%.3f", j == 0 ? "" : ",", r.times[j]);
+		fprintf(file, "]}");
+	}
+	fprintf(file, "\n]}\n");
+
+	fclose(file);
+	return true;
+}
+
+static void printUsage()
+{
+	printf("usage: Benchmark -exe <renderer> [options]\n");
+	printf("  -exe <path>          renderer to benchmark (any stage, e.g. Release\\Stage5.exe)\n");
+	printf("  -args \"<args>\"       extra arguments passed to every run (e.g. \"-threads 1\" or \"-wavefront\")\n");
+	printf("  -warmup <n>          runs discarded before measuring (default 1, at least 1 as the first run includes startup)\n");
+	printf("  -repeats <n>         measured runs per configuration (default 5, each a launch of its own for stages that only print an average)\n");
+	printf("  -only <text>         only run configurations whose name contains text (e.g. cornell_1024x1024x4)\n");
+	printf("  -csv <file>          write the results as CSV (can be used as a baseline later)\n");
+	printf("  -json <file>         write the results, including every run's time, as JSON\n");
+	printf("  -baseline <file>     compare the medians against a CSV written by an earlier run\n");
+	printf("  -threshold <pct>     slowdown over the baseline counted as a regression (default 5)\n");
+	printf("  -outputDir <dir>     where the rendered images go (default Outputs)\n");
+	printf("exits with 1 if any configuration fails to run or regresses\n");
+}
+
+// run the matrix against the renderer given, print a table of the results and optionally compare them against a baseline
+int main(int argc, char* argv[])
+{
+	const char* exe = NULL;
+	const char* extraArgs = "";
+	int warmup = 1;
+	int repeats = 5;
+	const char* only = NULL;
+	const char* csvFilename = NULL;
+	const char* jsonFilename = NULL;
+	const char* baselineFilename = NULL;
+	double threshold = 5.0;
+	const char* outputDir = "Outputs";
+
+	// do stuff with command line args
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-exe") == 0 && i + 1 < argc)
+		{
+			exe = argv[++i];
+		}
+		else if (strcmp(argv[i], "-args") == 0 && i + 1 < argc)
+		{
+			extraArgs = argv[++i];
+		}
+		else if (strcmp(argv[i], "-warmup") == 0 && i + 1 < argc)
+		{
+			warmup = std::max(1, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "-repeats") == 0 && i + 1 < argc)
+		{
+			repeats = std::max(1, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "-only") == 0 && i + 1 < argc)
+		{
+			only = argv[++i];
+		}
+		else if (strcmp(argv[i], "-csv") == 0 && i + 1 < argc)
+		{
+			csvFilename = argv[++i];
+		}
+		else if (strcmp(argv[i], "-json") == 0 && i + 1 < argc)
+		{
+			jsonFilename = argv[++i];
+		}
+		else if (strcmp(argv[i], "-baseline") == 0 && i + 1 < argc)
+		{
+			baselineFilename = argv[++i];
+		}
+		else if (strcmp(argv[i], "-threshold") == 0 && i + 1 < argc)
+		{
+			threshold = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-outputDir") == 0 && i + 1 < argc)
+		{
+			outputDir = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "unknown argument: %s\n", argv[i]);
+		}
+	}
+
+	if (exe == NULL)
+	{
+		printUsage();
+		return 1;
+	}
+
+	std::map<std::string, double> baseline;
+	if (baselineFilename != NULL && !readBaseline(baselineFilename, baseline))
+	{
+		fprintf(stderr, "Couldn't read the baseline file %s\n", baselineFilename);
+		return 1;
+	}
+
+	printf("benchmarking %s %s (%d warm-up, %d measured run(s) per configuration)\n", exe, extraArgs, warmup, repeats);
+	printf("%-30s %10s %10s %9s %13s", "config", "median ms", "p95 ms", "Mrays/s", "samples/s");
+	if (!baseline.empty()) printf(" %11s %8s", "baseline ms", "change");
+	printf("\n");
+
+	std::vector<BenchmarkResult> results;
+	bool failed = false, regressed = false;
+	bool averageOnly = false;
+
+	for (const BenchmarkConfig& config : standardMatrix)
+	{
+		BenchmarkResult result;
+		result.name = configName(config);
+		result.config = &config;
+		if (only != NULL && result.name.find(only) == std::string::npos) continue;
+
+		// older stages only print the average of the runs after the first, so each measured run is a launch of its own that renders
+		// twice (the first taking the startup), found from the first configuration's output, which is then just a warm-up
+		bool ran = true;
+		if (!averageOnly)
+		{
+			std::string output;
+			ran = runRenderer(exe, extraArgs, config, warmup + repeats, outputDir, output);
+			double average;
+			if (ran && !parseRunTimes(output, warmup, result.times)) averageOnly = parseAverageTime(output, &average);
+		}
+		for (int repeat = 0; repeat < repeats && ran && averageOnly; ++repeat)
+		{
+			std::string output;
+			double time;
+			ran = runRenderer(exe, extraArgs, config, 2, outputDir, output) && parseAverageTime(output, &time);
+			if (ran) result.times.push_back(time);
+		}
+
+		if (!ran || result.times.empty())
+		{
+			printf("%-30s failed (no timing in the renderer's output)\n", result.name.c_str());
+			failed = true;
+			continue;
+		}
+
+		calculateStatistics(result);
+		printf("%-30s %10.2f %10.2f %9.2f %13.0f", result.name.c_str(), result.median, result.p95, result.mraysPerSecond, result.samplesPerSecond);
+
+		// slower than the baseline by more than the threshold is a regression
+		std::map<std::string, double>::const_iterator base = baseline.find(result.name);
+		result.baseline = base != baseline.end() ? base->second : 0.0;
+		result.regressed = result.baseline > 0.0 && result.median > result.baseline * (1.0 + threshold / 100.0);
+		if (result.baseline > 0.0)
+		{
+			printf(" %11.2f %+7.1f%%%s", result.baseline, (result.median / result.baseline - 1.0) * 100.0, result.regressed ? "  REGRESSION" : "");
+		}
+		printf("\n");
+		fflush(stdout);
+
+		regressed = regressed || result.regressed;
+		results.push_back(result);
+	}
+
+	if (csvFilename != NULL && !writeCSV(csvFilename, results))
+	{
+		fprintf(stderr, "Couldn't write %s\n", csvFilename);
+		failed = true;
+	}
+	if (jsonFilename != NULL && !writeJSON(jsonFilename, exe, extraArgs, results))
+	{
+		fprintf(stderr, "Couldn't write %s\n", jsonFilename);
+		failed = true;
+	}
+
+	if (regressed) printf("slower than the baseline by more than %.1f%%\n", threshold);
+
+	return failed || regressed ? 1 : 0;
+}
@@ -0,0 +1,218 @@
+/*  Image comparator: checks a render against its reference in Outputs_REFERENCE (replaces "magick compare -metric mae" in the test scripts).
+Reports the mean absolute error, PSNR and largest error over the colour channels, can write an image of the differences,
+and exits with 1 if the error is over the threshold (2 if the images couldn't be compared at all). */
+
+#pragma warning(disable: 4996)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <emmintrin.h>
+#include "ImageIO.h"
+
+// how the two images differ
+struct ImageDifference
+{
+	unsigned long long sumAbsolute;		// sum of |a - b| over every channel
+	unsigned long long sumSquared;		// sum of (a - b)^2 over every channel
+	unsigned int maxError;				// largest |a - b| of any channel
+	unsigned int differingPixels;		// pixels with any channel different
+};
+
+// add the four 32 bit lanes of a running sum of squares to a 64 bit total (before they can overflow)
+static inline __m128i flushSquares(__m128i total, __m128i squares)
+{
+	__m128i zero = _mm_setzero_si128();
+	total = _mm_add_epi64(total, _mm_unpacklo_epi32(squares, zero));
+	return _mm_add_epi64(total, _mm_unpackhi_epi32(squares, zero));
+}
+
+// compare two images with the same layout write_bmp takes (one pixel per int, top byte unused and zero)
+// 4 pixels are compared at once, and the difference of each channel (times diffScale) is written to diff if it isn't NULL
+static ImageDifference compareImages(const unsigned int* a, const unsigned int* b, unsigned int* diff, int numPixels, int diffScale)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i scale = _mm_set1_epi16((short)diffScale);
+
+	__m128i sumAbsolute = zero, sumSquared = zero, squares = zero, maxError = zero;
+	unsigned int differingPixels = 0;
+
+	int i = 0, batches = 0;
+	for (; i + 4 <= numPixels; i += 4)
+	{
+		__m128i pixelsA = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i pixelsB = _mm_loadu_si128((const __m128i*)(b + i));
+
+		// |a - b| of every channel (bytes saturate at zero, so one of the two subtractions is always zero)
+		__m128i absolute = _mm_or_si128(_mm_subs_epu8(pixelsA, pixelsB), _mm_subs_epu8(pixelsB, pixelsA));
+
+		sumAbsolute = _mm_add_epi64(sumAbsolute, _mm_sad_epu8(absolute, zero));
+		maxError = _mm_max_epu8(maxError, absolute);
+
+		// squares of the 16 bit differences, summed in pairs
+		__m128i low = _mm_unpacklo_epi8(absolute, zero);
+		__m128i high = _mm_unpackhi_epi8(absolute, zero);
+		squares = _mm_add_epi32(squares, _mm_add_epi32(_mm_madd_epi16(low, low), _mm_madd_epi16(high, high)));
+		if (++batches == 4096)
+		{
+			sumSquared = flushSquares(sumSquared, squares);
+			squares = zero;
+			batches = 0;
+		}
+
+		// pixels with every channel the same
+		int same = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(absolute, zero)));
+		differingPixels += 4 - ((same & 1) + ((same >> 1) & 1) + ((same >> 2) & 1) + ((same >> 3) & 1));
+
+		if (diff != NULL)
+		{
+			__m128i scaled = _mm_packus_epi16(_mm_mullo_epi16(low, scale), _mm_mullo_epi16(high, scale));
+			_mm_storeu_si128((__m128i*)(diff + i), scaled);
+		}
+	}
+	sumSquared = flushSquares(sumSquared, squares);
+
+	ImageDifference result;
+
+	unsigned long long lanes[2];
+	_mm_storeu_si128((__m128i*)lanes, sumAbsolute);
+	result.sumAbsolute = lanes[0] + lanes[1];
+	_mm_storeu_si128((__m128i*)lanes, sumSquared);
+	result.sumSquared = lanes[0] + lanes[1];
+
+	unsigned char bytes[16];
+	_mm_storeu_si128((__m128i*)bytes, maxError);
+	result.maxError = 0;
+	for (int j = 0; j < 16; ++j) if (bytes[j] > result.maxError) result.maxError = bytes[j];
+
+	result.differingPixels = differingPixels;
+
+	// pixels left over after the last batch of 4
+	for (; i < numPixels; ++i)
+	{
+		unsigned int diffPixel = 0;
+		for (int shift = 0; shift < 24; shift += 8)
+		{
+			int channelA = (a[i] >> shift) & 0xFF, channelB = (b[i] >> shift) & 0xFF;
+			unsigned int absolute = (unsigned int)abs(channelA - channelB);
+
+			result.sumAbsolute += absolute;
+			result.sumSquared += absolute * absolute;
+			if (absolute > result.maxError) result.maxError = absolute;
+
+			unsigned int scaled = absolute * diffScale;
+			diffPixel |= (scaled > 255 ? 255 : scaled) << shift;
+		}
+
+		if (diffPixel != 0) result.differingPixels++;
+		if (diff != NULL) diff[i] = diffPixel;
+	}
+
+	return result;
+}
+
+static void printUsage()
+{
+	printf("usage: Compare <image.bmp> <reference.bmp> [options]\n");
+	printf("  -diff <file.bmp>     write an image of the differences\n");
+	printf("  -diffScale <n>       multiply the differences in the diff image by n so small ones show up (default 16)\n");
+	printf("  -threshold <mae>     largest mean absolute error (in 0-255 levels) that passes (default 1.0)\n");
+	printf("  -maxError <n>        largest error of any channel that passes (default 255, i.e. not checked)\n");
+	printf("exits with 0 if the images match within the thresholds, 1 if they don't, and 2 if they can't be compared\n");
+}
+
+// read both images, compare them, and report the result
+int main(int argc, char* argv[])
+{
+	const char* imageFilename = NULL;
+	const char* referenceFilename = NULL;
+	const char* diffFilename = NULL;
+	int diffScale = 16;
+	double threshold = 1.0;
+	unsigned int maxErrorAllowed = 255;
+
+	// do stuff with command line args
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-diff") == 0 && i + 1 < argc)
+		{
+			diffFilename = argv[++i];
+		}
+		else if (strcmp(argv[i], "-diffScale") == 0 && i + 1 < argc)
+		{
+			diffScale = atoi(argv[++i]);
+			if (diffScale < 1) diffScale = 1;
+			if (diffScale > 255) diffScale = 255;
+		}
+		else if (strcmp(argv[i], "-threshold") == 0 && i + 1 < argc)
+		{
+			threshold = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-maxError") == 0 && i + 1 < argc)
+		{
+			maxErrorAllowed = (unsigned int)atoi(argv[++i]);
+		}
+		else if (argv[i][0] != '-' && imageFilename == NULL)
+		{
+			imageFilename = argv[i];
+		}
+		else if (argv[i][0] != '-' && referenceFilename == NULL)
+		{
+			referenceFilename = argv[i];
+		}
+		else
+		{
+			fprintf(stderr, "unknown argument: %s\n", argv[i]);
+		}
+	}
+
+	if (imageFilename == NULL || referenceFilename == NULL)
+	{
+		printUsage();
+		return 2;
+	}
+
+	unsigned int* image = NULL;
+	unsigned int* reference = NULL;
+	int width, height, referenceWidth, referenceHeight;
+	if (!read_bmp(imageFilename, image, width, height) || !read_bmp(referenceFilename, reference, referenceWidth, referenceHeight))
+	{
+		return 2;
+	}
+
+	if (width != referenceWidth || height != referenceHeight)
+	{
+		printf("%s: size %dx%d doesn't match the reference (%dx%d)\n", imageFilename, width, height, referenceWidth, referenceHeight);
+		return 2;
+	}
+
+	int numPixels = width * height;
+	unsigned int* diff = diffFilename != NULL ? new unsigned int[numPixels] : NULL;
+
+	ImageDifference difference = compareImages(image, reference, diff, numPixels, diffScale);
+
+	double numChannels = 3.0 * numPixels;
+	double mae = difference.sumAbsolute / numChannels;
+	double mse = difference.sumSquared / numChannels;
+	bool passed = mae <= threshold && difference.maxError <= maxErrorAllowed;
+
+	// PSNR is infinite when the images are the same
+	char psnr[32];
+	if (mse > 0.0) sprintf(psnr, "%.2fdB", 10.0 * log10(255.0 * 255.0 / mse));
+	else strcpy(psnr, "inf");
+
+	printf("%s: mae %.4f (%.6f normalised), psnr %s, max error %u, differing pixels %u (%.3f%%) -- %s\n",
+		imageFilename, mae, mae / 255.0, psnr, difference.maxError, difference.differingPixels, 100.0 * difference.differingPixels / numPixels,
+		passed ? "pass" : "FAIL");
+
+	if (diff != NULL)
+	{
+		write_bmp(diffFilename, diff, width, height, width);
+		delete[] diff;
+	}
+
+	delete[] image;
+	delete[] reference;
+
+	return passed ? 0 : 1;
+}
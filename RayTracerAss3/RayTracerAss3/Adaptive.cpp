@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "Adaptive.h"
+#include "ImageIO.h"
+
+int adaptiveBaseLevel(int aaLevel)
+{
+	return aaLevel >= 4 ? 2 : 1;
+}
+
+int neighbourhoodContrast(const unsigned int* image, int width, int height, int x, int y)
+{
+	int contrast = 0;
+
+	// neighbourhood is cut short at the edges of the image
+	int top = y > 0 ? y - 1 : y, bottom = y < height - 1 ? y + 1 : y;
+	int left = x > 0 ? x - 1 : x, right = x < width - 1 ? x + 1 : x;
+
+	for (int shift = 0; shift < 24; shift += 8)
+	{
+		int lowest = 255, highest = 0;
+		for (int ny = top; ny <= bottom; ++ny)
+		{
+			for (int nx = left; nx <= right; ++nx)
+			{
+				int channel = (image[ny * width + nx] >> shift) & 0xFF;
+				if (channel < lowest) lowest = channel;
+				if (channel > highest) highest = channel;
+			}
+		}
+
+		if (highest - lowest > contrast) contrast = highest - lowest;
+	}
+
+	return contrast;
+}
+
+void printSamplesSaved(unsigned long long samplesRendered, unsigned int refinedPixels, int width, int height, int aaLevel)
+{
+	unsigned long long uniformSamples = (unsigned long long)width * height * aaLevel * aaLevel;
+	long long saved = (long long)uniformSamples - (long long)samplesRendered;
+
+	printf("adaptive sampling: %u of %d pixels refined (%.2f%%), %llu samples against %llu uniform, %lld saved (%.2f%%)\n",
+		refinedPixels, width * height, 100.0 * refinedPixels / (width * height),
+		samplesRendered, uniformSamples, saved, 100.0 * saved / uniformSamples);
+}
+
+bool printReferenceError(const unsigned int* image, int width, int height, const char* referenceFilename)
+{
+	unsigned int* reference = NULL;
+	int referenceWidth, referenceHeight;
+	if (!read_bmp(referenceFilename, reference, referenceWidth, referenceHeight)) return false;
+
+	if (referenceWidth != width || referenceHeight != height)
+	{
+		printf("reference %s is %dx%d, not %dx%d\n", referenceFilename, referenceWidth, referenceHeight, width, height);
+		delete[] reference;
+		return false;
+	}
+
+	unsigned long long sumAbsolute = 0;
+	for (int i = 0; i < width * height; ++i)
+	{
+		for (int shift = 0; shift < 24; shift += 8)
+		{
+			sumAbsolute += abs((int)((image[i] >> shift) & 0xFF) - (int)((reference[i] >> shift) & 0xFF));
+		}
+	}
+	delete[] reference;
+
+	printf("mae against %s: %.4f\n", referenceFilename, sumAbsolute / (3.0 * width * height));
+	return true;
+}
@@ -0,0 +1,19 @@
+#ifndef __ADAPTIVE_H
+#define __ADAPTIVE_H
+
+// adaptive anti-aliasing renders every pixel with a cheap grid of samples first,
+// then renders the full grid again only for pixels whose neighbourhood in the cheap image has enough contrast
+
+// samples along each axis of the cheap pass (2x2 for grids of 4x4 and up, otherwise a single sample)
+int adaptiveBaseLevel(int aaLevel);
+
+// largest difference (in 0-255 levels) of any channel between the pixels of the 3x3 neighbourhood around x, y
+int neighbourhoodContrast(const unsigned int* image, int width, int height, int x, int y);
+
+// print how many samples were rendered against a uniform render of the same size and grid
+void printSamplesSaved(unsigned long long samplesRendered, unsigned int refinedPixels, int width, int height, int aaLevel);
+
+// print the mean absolute error (over the colour channels, in 0-255 levels) against a reference image, returning false if it can't be compared
+bool printReferenceError(const unsigned int* image, int width, int height, const char* referenceFilename);
+
+#endif // __ADAPTIVE_H
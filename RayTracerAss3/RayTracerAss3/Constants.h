@@ -10,6 +10,10 @@
 // maximum size of image
 const int MAX_WIDTH = 2048, MAX_HEIGHT = 2048;
 
+// size of the square tiles the image is split into for rendering, and the most threads that can render them
+const int TILE_SIZE = 32;
+const int MAX_THREADS = 256;
+
 // math constants
 const float PI = 3.14159265358979323846f;
 const float PIOVER180 = 0.017453292519943295769236907684886f;
@@ -93,7 +93,7 @@ unsigned int read_int16(ifstream& f)
 	return (((unsigned char) value2) << 8) | ((unsigned char) value1);
 }
 
-/*bool read_bmp(const char* name, Texture& t)
+bool read_bmp(const char* name, unsigned int*& buffer, int& width, int& height)
 {
 	ifstream imageFile(name, ios_base::binary);
 	if (!imageFile) 
@@ -117,16 +117,20 @@ unsigned int read_int16(ifstream& f)
 	int offset = read_int32(imageFile);
 	int header_size = read_int32(imageFile);
 
-	if (offset != header_size + 14)
+	if (offset < header_size + 14)
 	{
 		fprintf(stderr, "Header and offset size mismatch in %s.\n", name);
 		return false;
 	}
 
-	int width = read_int32(imageFile);
-	int height = read_int32(imageFile);
+	width = read_int32(imageFile);
+	height = read_int32(imageFile);
 	int planes = read_int16(imageFile);
-
+	if (planes != 1)
+	{
+		fprintf(stderr, "BMP %s doesn't have 1 colour plane.\n", name);
+		return false;
+	}
 	int bpp = read_int16(imageFile);
 	if (bpp != 24) 
 	{
@@ -134,33 +138,52 @@ unsigned int read_int16(ifstream& f)
 		return false;
 	}
 	int compression = read_int32(imageFile);
+	if (compression != 0)
+	{
+		fprintf(stderr, "BMP %s is compressed.\n", name);
+		return false;
+	}
 
-	int buffer_size = read_int32(imageFile);
+	// a negative height means the rows are stored top down rather than bottom up
+	bool topDown = height < 0;
+	if (topDown) height = -height;
+	if (width <= 0 || height == 0)
+	{
+		fprintf(stderr, "BMP %s has no pixels.\n", name);
+		return false;
+	}
 
-	int hres = read_int32(imageFile);
-	int vres = read_int32(imageFile);
-	int colours = read_int32(imageFile);
-	int important_colours = read_int32(imageFile);
+	// each row is padded to a multiple of four bytes (except by write_bmp, whose files are exactly the size of the unpadded rows)
+	int rowSize = (width * 3 + 3) & ~3;
+	if (file_size == offset + width * 3 * height) rowSize = width * 3;
+	char* row = new char[rowSize];
 
-	t.width = width;
-	t.height = height;
-	t.sRGB = false;
-	t.exposed = false;
-	t.data = new unsigned int[width * height];
+	imageFile.seekg(offset);
+	buffer = new unsigned int[width * height];
 
 	for (int y = 0; y < height; ++y)
 	{
+		if (!imageFile.read(row, rowSize) && imageFile.gcount() < width * 3)
+		{
+			fprintf(stderr, "BMP %s is truncated.\n", name);
+			delete[] row;
+			delete[] buffer;
+			buffer = NULL;
+			return false;
+		}
+
+		// same layout write_bmp takes, with the rows in the order it writes them
+		unsigned int* pixels = buffer + (topDown ? height - 1 - y : y) * width;
 		for (int x = 0; x < width; ++x)
 		{
-			char r, g, b;
-			imageFile.get(b).get(g).get(r);
-			t.data[x + y * width] = ((b & 0xFF) << 16) | ((g & 0xFF) << 8) | (r & 0xFF);
+			unsigned char* bgr = (unsigned char*)row + x * 3;
+			pixels[x] = (bgr[0] << 16) | (bgr[1] << 8) | bgr[2];
 		}
-		//** not handling padding at all (fails with files with a width not divisible by four) :/
 	}
 
+	delete[] row;
 	return true;
-}*/
+}
 
 void write_tga(const char* name, unsigned int* buffer, int width, int height, int stride)
 {
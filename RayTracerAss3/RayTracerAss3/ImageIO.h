@@ -4,7 +4,7 @@
 #define __IMAGE_IO_H
 
 // image file writing functions
-//bool read_bmp(const char *name, Texture& t);
+bool read_bmp(const char *name, unsigned int*& buffer, int& width, int& height);	// allocates buffer (delete[] it when done)
 void write_bmp(const char *name, unsigned int *screen, int width, int height, int stride);
 void write_tga(const char *name, unsigned int *screen, int width, int height, int stride);
 void write_ppm(const char *name, unsigned int *screen, int width, int height, int stride);
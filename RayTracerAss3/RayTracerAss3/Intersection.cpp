@@ -3,6 +3,7 @@
 	It is free to use for educational purpose and cannot be redistributed outside of the tutorial pages. */
 
 #include "Intersection.h"
+#include "SimdIntersection.h"
 
 // test to see if collision between ray and a plane happens before time t (equivalent to distance)
 // updates closest collision time (/distance) if collision occurs
@@ -137,6 +138,71 @@ bool isCylinderIntersected(const Cylinder* cy, const Ray* r, float* t, Vector* n
 }
 
 
+// test to see if collision between ray and a sphere happens before time t (equivalent to distance)
+// same as isSphereIntersected, but only answers yes or no, so either collision point will do
+bool isSphereOccluding(const Sphere* s, const Ray* r, const float t)
+{
+	Vector dist = s->pos - r->start;
+	float B = r->dir * dist;
+	float D = B * B - dist * dist + s->size * s->size;
+
+	if (D < 0.0f) return false;
+
+	float sqrtD = sqrtf(D);
+	float t0 = B - sqrtD;
+	float t1 = B + sqrtD;
+
+	return (t0 > EPSILON && t0 < t) || (t1 > EPSILON && t1 < t);
+}
+
+
+// test to see if collision between ray and a plane happens before time t (equivalent to distance)
+// same as isPlaneIntersected, but only answers yes or no
+bool isPlaneOccluding(const Plane* p, const Ray* r, const float t)
+{
+	float angle = r->dir * p->normal;
+
+	if (angle == 0.0f) return false;
+
+	float t0 = ((p->pos - r->start) * p->normal) / angle;
+
+	return t0 > EPSILON && t0 < t;
+}
+
+
+// test to see if collision between ray and a cylinder happens before time t (equivalent to distance)
+// same as isCylinderIntersected, but only answers yes or no, so the normal is never calculated
+bool isCylinderOccluding(const Cylinder* cy, const Ray* r, const float t)
+{
+	Vector ca = cy->p2 - cy->p1;
+	Vector oc = r->start - cy->p1;
+	float caca = ca * ca;
+	float card = ca * r->dir;
+	float caoc = ca * oc;
+
+	float a = caca - card * card;
+	float b = caca * (oc * r->dir) - caoc * card;
+	float c = caca * (oc * oc) - caoc * caoc - cy->size * cy->size * caca;
+
+	float h = b * b - a * c;
+
+	if (h < 0.0f) return false;
+
+	h = sqrt(h);
+
+	// collision with the body of the cylinder
+	float tBody = (-b - h) / a;
+	float y = caoc + tBody * card;
+
+	if (y > 0 && y < caca && tBody > EPSILON && tBody < t) return true;
+
+	// collision with the cap
+	float tCaps = (((y < 0.0f) ? 0.0f : caca) - caoc) / card;
+
+	return abs(b + a * tCaps) < h && tCaps > EPSILON && tCaps < t;
+}
+
+
 // calculate collision normal, viewProjection, object's material, and test to see if inside collision object
 void calculateIntersectionResponse(const Scene* scene, const Ray* viewRay, Intersection* intersect)
 {
@@ -181,35 +247,30 @@ bool objectIntersection(const Scene* scene, const Ray* viewRay, Intersection* in
 	intersect->objectType = Intersection::PrimitiveType::NONE;
 
 	// search for sphere collisions, storing closest one found
-    for (unsigned int i = 0; i < scene->numSpheres; ++i)
-    {
-        if (isSphereIntersected(&scene->sphereContainer[i], viewRay, &t))
-        {
-			intersect->objectType = Intersection::PrimitiveType::SPHERE;
-			intersect->sphere = &scene->sphereContainer[i];
-        }
-    }
+	// (each search only reports a collision closer than the ones already found)
+	int sphere = simdIntersection.closestSphere(scene, viewRay, &t);
+	if (sphere >= 0)
+	{
+		intersect->objectType = Intersection::PrimitiveType::SPHERE;
+		intersect->sphere = &scene->sphereContainer[sphere];
+	}
 
 	// search for plane collisions, storing closest one found
-	for (unsigned int i = 0; i < scene->numPlanes; ++i)
+	int plane = simdIntersection.closestPlane(scene, viewRay, &t);
+	if (plane >= 0)
 	{
-		if (isPlaneIntersected(&scene->planeContainer[i], viewRay, &t))
-		{
-			intersect->objectType = Intersection::PrimitiveType::PLANE;
-			intersect->plane = &scene->planeContainer[i];
-		}
+		intersect->objectType = Intersection::PrimitiveType::PLANE;
+		intersect->plane = &scene->planeContainer[plane];
 	}
 
 	// search for cylinder collisions, storing closest one found (and the normal at that point)
 	Vector normal;
-	for (unsigned int i = 0; i < scene->numCylinders; ++i)
+	int cylinder = simdIntersection.closestCylinder(scene, viewRay, &t, &normal);
+	if (cylinder >= 0)
 	{
-		if (isCylinderIntersected(&scene->cylinderContainer[i], viewRay, &t, &normal))
-		{
-			intersect->objectType = Intersection::PrimitiveType::CYLINDER;
-			intersect->normal = normal;
-			intersect->cylinder = &scene->cylinderContainer[i];
-		}
+		intersect->objectType = Intersection::PrimitiveType::CYLINDER;
+		intersect->normal = normal;
+		intersect->cylinder = &scene->cylinderContainer[cylinder];
 	}
 
 	// nothing detected, return false
@@ -6,40 +6,20 @@ It is free to use for educational purpose and cannot be redistributed outside of
 #include "Colour.h"
 #include "Intersection.h"
 #include "Texturing.h"
+#include "SimdIntersection.h"
 
 // test to see if light ray collides with any of the scene's objects
 // short-circuits when first intersection discovered, because no matter what the object will be in shadow
 bool isInShadow(const Scene* scene, const Ray* lightRay, const float lightDist)
 {
-	float t = lightDist;
-
 	// search for sphere collision
-	for (unsigned int i = 0; i < scene->numSpheres; ++i)
-	{
-		if (isSphereIntersected(&scene->sphereContainer[i], lightRay, &t))
-		{
-			return true;
-		}
-	}
+	if (simdIntersection.anySphereOccluding(scene, lightRay, lightDist)) return true;
 
 	// search for plane collision
-	for (unsigned int i = 0; i < scene->numPlanes; ++i)
-	{
-		if (isPlaneIntersected(&scene->planeContainer[i], lightRay, &t))
-		{
-			return true;
-		}
-	}
+	if (simdIntersection.anyPlaneOccluding(scene, lightRay, lightDist)) return true;
 
 	// search for cylinder collision
-	Vector normal; // unused here, but it's necessary for the function to work
-	for (unsigned int i = 0; i < scene->numCylinders; ++i)
-	{
-		if (isCylinderIntersected(&scene->cylinderContainer[i], lightRay, &t, &normal))
-		{
-			return true;
-		}
-	}
+	if (simdIntersection.anyCylinderOccluding(scene, lightRay, lightDist)) return true;
 
 	// not in shadow
 	return false;
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include "PhaseTimer.h"
+
+PhaseTimer::PhaseTimer()
+{
+	runs.push_back(std::vector<double>());
+	callback = NULL;
+	callbackContext = NULL;
+}
+
+void PhaseTimer::restart()
+{
+	timer.start();
+}
+
+// add the time since the last phase ended to a phase of a run (and let the callback know)
+static void addPhaseTime(Timer& timer, std::vector<std::string>& names, std::vector<double>& run, const char* name, PhaseCallback callback, void* callbackContext)
+{
+	timer.end();
+	double time = timer.getMillisecondsPrecise();
+	if (callback != NULL) callback(name, timer.getStartTime(), timer.getEndTime(), callbackContext);
+	timer.start();
+
+	// find the phase (or add it)
+	unsigned int phase = 0;
+	while (phase < names.size() && names[phase] != name) ++phase;
+	if (phase == names.size()) names.push_back(name);
+
+	if (run.size() <= phase) run.resize(phase + 1, -1.0);
+
+	// a phase can be ended more than once in a run, its time is the sum
+	if (run[phase] < 0.0) run[phase] = 0.0;
+	run[phase] += time;
+}
+
+void PhaseTimer::endPhase(const char* name)
+{
+	addPhaseTime(timer, names, runs.back(), name, callback, callbackContext);
+}
+
+void PhaseTimer::endOneOffPhase(const char* name)
+{
+	addPhaseTime(timer, names, runs.front(), name, callback, callbackContext);
+}
+
+void PhaseTimer::setCallback(PhaseCallback callback, void* context)
+{
+	this->callback = callback;
+	callbackContext = context;
+}
+
+void PhaseTimer::nextRun()
+{
+	runs.push_back(std::vector<double>());
+	timer.start();
+}
+
+// time of a phase in a run (-1 if it didn't happen in that run)
+static double phaseTime(const std::vector<double>& run, unsigned int phase)
+{
+	return phase < run.size() ? run[phase] : -1.0;
+}
+
+// total time of a run
+static double runTime(const std::vector<double>& run)
+{
+	double total = 0.0;
+	for (unsigned int i = 0; i < run.size(); ++i)
+	{
+		if (run[i] > 0.0) total += run[i];
+	}
+	return total;
+}
+
+// print a line with the first run's time, and the average of the runs after it (if any)
+static void printTimes(const char* name, double first, double subsequentTotal, int subsequentRuns)
+{
+	if (subsequentRuns == 0)
+		printf("  %-18s %9.2fms\n", name, first);
+	else if (first < 0.0)
+		printf("  %-18s %9s    subsequent average (%d run(s)): %.2fms\n", name, "-", subsequentRuns, subsequentTotal / subsequentRuns);
+	else
+		printf("  %-18s %9.2fms  subsequent average (%d run(s)): %.2fms\n", name, first, subsequentRuns, subsequentTotal / subsequentRuns);
+}
+
+void PhaseTimer::print() const
+{
+	// ignore a trailing run nothing was timed in
+	size_t numRuns = runs.size();
+	while (numRuns > 1 && runs[numRuns - 1].empty()) --numRuns;
+
+	printf("time taken by phase:\n");
+	for (unsigned int phase = 0; phase < names.size(); ++phase)
+	{
+		double subsequentTotal = 0.0;
+		int subsequentRuns = 0;
+		for (size_t i = 1; i < numRuns; ++i)
+		{
+			double time = phaseTime(runs[i], phase);
+			if (time < 0.0) continue;
+			subsequentTotal += time;
+			++subsequentRuns;
+		}
+
+		printTimes(names[phase].c_str(), phaseTime(runs[0], phase), subsequentTotal, subsequentRuns);
+	}
+
+	double subsequentTotal = 0.0;
+	for (size_t i = 1; i < numRuns; ++i) subsequentTotal += runTime(runs[i]);
+	printTimes("total", runTime(runs[0]), subsequentTotal, (int)numRuns - 1);
+}
+
+void PhaseTimer::printJSON() const
+{
+	size_t numRuns = runs.size();
+	while (numRuns > 1 && runs[numRuns - 1].empty()) --numRuns;
+
+	printf("{\"runs\":[");
+	for (size_t i = 0; i < numRuns; ++i)
+	{
+		printf("%s{", i == 0 ? "" : ",");
+
+		bool firstPhase = true;
+		for (unsigned int phase = 0; phase < names.size(); ++phase)
+		{
+			double time = phaseTime(runs[i], phase);
+			if (time < 0.0) continue;
+
+			// phase names are lower case words, the keys join them with underscores
+			std::string key = names[phase];
+			for (size_t c = 0; c < key.size(); ++c)
+			{
+				if (key[c] == ' ') key[c] = '_';
+			}
+
+			printf("%s\"%s_ms\":%.3f", firstPhase ? "" : ",", key.c_str(), time);
+			firstPhase = false;
+		}
+
+		printf("%s\"total_ms\":%.3f}", firstPhase ? "" : ",", runTime(runs[i]));
+	}
+	printf("]}\n");
+}
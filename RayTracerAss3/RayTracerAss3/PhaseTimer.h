@@ -0,0 +1,51 @@
+#ifndef __PHASE_TIMER_H
+#define __PHASE_TIMER_H
+
+#include <string>
+#include <vector>
+#include "Timer.h"
+
+// called with the start and end of each phase as it ends (e.g. to add it to a timeline)
+typedef void (*PhaseCallback)(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, void* context);
+
+// times each phase of each run (e.g. scene parse, kernel execution, readback)
+// every endPhase call charges the time since the previous one to the named phase of the current run,
+// so the phases of a run add up to its total time
+class PhaseTimer
+{
+	Timer timer;
+
+	// phase names in the order they first happened, and the time spent in each (runs x phases, -1 where a run skipped the phase)
+	std::vector<std::string> names;
+	std::vector<std::vector<double> > runs;
+
+	PhaseCallback callback;
+	void* callbackContext;
+
+public:
+	PhaseTimer();
+
+	// restart the clock without charging the time since the last phase to anything
+	void restart();
+
+	// charge the time since the last phase ended to this phase of the current run
+	void endPhase(const char* name);
+
+	// charge the time since the last phase ended to a phase that only happens once (e.g. writing the image after the last run)
+	// it is counted as part of the first run, the same as the setup before it
+	void endOneOffPhase(const char* name);
+
+	// call callback with every phase from now on
+	void setCallback(PhaseCallback callback, void* context);
+
+	// start a new run (phases ended from now on belong to it)
+	void nextRun();
+
+	// print each phase's first run and subsequent average times, then the totals
+	void print() const;
+
+	// print every run's phases as a single line of JSON
+	void printJSON() const;
+};
+
+#endif //__PHASE_TIMER_H
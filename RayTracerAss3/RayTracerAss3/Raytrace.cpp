@@ -2,18 +2,22 @@
 Ray tracing tutorial of http://www.codermind.com/articles/Raytracer-in-C++-Introduction-What-is-ray-tracing.html
 It is free to use for educational purpose and cannot be redistributed outside of the tutorial pages. */
 
-#define TARGET_WINDOWS
-
 #pragma warning(disable: 4996)
 #include "Timer.h"
+#include "PhaseTimer.h"
 #include "Primitives.h"
 #include "Scene.h"
 #include "Lighting.h"
 #include "Intersection.h"
 #include "ImageIO.h"
 #include "LoadCL.h"
+#include "TileScheduler.h"
+#include "SimdIntersection.h"
+#include "Adaptive.h"
+#include <thread>
 
 unsigned int buffer[MAX_WIDTH * MAX_HEIGHT];
+unsigned int baseBuffer[MAX_WIDTH * MAX_HEIGHT];
 
 // reflect the ray from an object
 Ray calculateReflection(const Ray* viewRay, const Intersection* intersect)
@@ -111,66 +115,168 @@ Colour traceRay(const Scene* scene, Ray viewRay)
 	return output;
 }
 
-// render scene at given width and height and anti-aliasing level
-int render(Scene* scene, const int width, const int height, const int aaLevel, bool testMode)
+// render a single pixel (x and y are relative to the centre of the image)
+unsigned int renderPixel(const Scene* scene, const int x, const int y, const int width, const int height, const int aaLevel, const float dirStepSize, bool testMode, unsigned int* samplesRendered)
 {
-	// angle between each successive ray cast (per pixel, anti-aliasing uses a fraction of this)
-	const float dirStepSize = 1.0f / (0.5f * width / tanf(PIOVER180 * 0.5f * scene->cameraFieldOfView));
-
-	// pointer to output buffer
-	unsigned int* out = buffer;
+	Colour output(0.0f, 0.0f, 0.0f);
 
-	// count of samples rendered
-	unsigned int samplesRendered = 0;
+	// calculate multiple samples for each pixel
+	const float sampleStep = 1.0f / aaLevel, sampleRatio = 1.0f / (aaLevel * aaLevel);
 
-	// loop through all the pixels
-	for (int y = -height / 2; y < height / 2; ++y)
+	// loop through all sub-locations within the pixel
+	for (float fragmentx = float(x); fragmentx < x + 1.0f; fragmentx += sampleStep)
 	{
-		for (int x = -width / 2; x < width / 2; ++x)
+		for (float fragmenty = float(y); fragmenty < y + 1.0f; fragmenty += sampleStep)
 		{
-			Colour output(0.0f, 0.0f, 0.0f);
+			// direction of default forward facing ray
+			Vector dir = { fragmentx * dirStepSize, fragmenty * dirStepSize, 1.0f };
 
-			// calculate multiple samples for each pixel
-			const float sampleStep = 1.0f / aaLevel, sampleRatio = 1.0f / (aaLevel * aaLevel);
+			// rotated direction of ray
+			Vector rotatedDir = {
+				dir.x * cosf(scene->cameraRotation) - dir.z * sinf(scene->cameraRotation),
+				dir.y,
+				dir.x * sinf(scene->cameraRotation) + dir.z * cosf(scene->cameraRotation) };
 
-			// loop through all sub-locations within the pixel
-			for (float fragmentx = float(x); fragmentx < x + 1.0f; fragmentx += sampleStep)
-			{
-				for (float fragmenty = float(y); fragmenty < y + 1.0f; fragmenty += sampleStep)
-				{
-					// direction of default forward facing ray
-					Vector dir = { fragmentx * dirStepSize, fragmenty * dirStepSize, 1.0f };
-
-					// rotated direction of ray
-					Vector rotatedDir = {
-						dir.x * cosf(scene->cameraRotation) - dir.z * sinf(scene->cameraRotation),
-						dir.y,
-						dir.x * sinf(scene->cameraRotation) + dir.z * cosf(scene->cameraRotation) };
-
-					// view ray starting from camera position and heading in rotated (normalised) direction
-					Ray viewRay = { scene->cameraPosition, normalise(rotatedDir) };
-
-					// follow ray and add proportional of the result to the final pixel colour
-					output += sampleRatio * traceRay(scene, viewRay);
-
-					// count this sample
-					samplesRendered++;
-				}
-			}
+			// view ray starting from camera position and heading in rotated (normalised) direction
+			Ray viewRay = { scene->cameraPosition, normalise(rotatedDir) };
 
-			if (!testMode)
-			{
-				// store saturated final colour value in image buffer
-				*out++ = output.convertToPixel(scene->exposure);
-			}
-			else
+			// follow ray and add proportional of the result to the final pixel colour
+			output += sampleRatio * traceRay(scene, viewRay);
+
+			// count this sample
+			(*samplesRendered)++;
+		}
+	}
+
+	if (!testMode)
+	{
+		// saturated final colour value
+		return output.convertToPixel(scene->exposure);
+	}
+	else
+	{
+		// colour calculated from x,y coordinates
+		return Colour((x + width / 2) % 256 / 255.0f, 0, (y + height / 2) % 256 / 255.0f).convertToPixel();
+	}
+}
+
+// everything the worker threads need to render their tiles
+struct RenderJob
+{
+	const Scene* scene;
+	int width, height, aaLevel;
+	bool testMode;
+	float dirStepSize;
+
+	int renderWidth, renderHeight;				// pixels actually rendered (odd sizes lose their last row/column)
+	int tilesX;
+	const int* tileOrder;						// tiles in the order they're handed out
+
+	// refining pass of adaptive sampling (baseImage is NULL otherwise), pixels keep their colour from the cheap pass
+	// unless their neighbourhood in it has more than contrastThreshold contrast
+	const unsigned int* baseImage;
+	int contrastThreshold;
+
+	unsigned int samplesRendered[MAX_THREADS];	// samples rendered by each thread
+	unsigned int pixelsRendered[MAX_THREADS];	// pixels rendered by each thread (rather than kept from the cheap pass)
+};
+
+// render one tile into the thread's own buffer, then copy it into the image
+void renderTile(int tile, int thread, void* context)
+{
+	RenderJob* job = (RenderJob*)context;
+
+	int tileIndex = job->tileOrder[tile];
+	int tileX = (tileIndex % job->tilesX) * TILE_SIZE;
+	int tileY = (tileIndex / job->tilesX) * TILE_SIZE;
+	int tileWidth = std::min(TILE_SIZE, job->renderWidth - tileX);
+	int tileHeight = std::min(TILE_SIZE, job->renderHeight - tileY);
+
+	unsigned int tileBuffer[TILE_SIZE * TILE_SIZE];
+	unsigned int samplesRendered = 0, pixelsRendered = 0;
+
+	for (int ty = 0; ty < tileHeight; ++ty)
+	{
+		for (int tx = 0; tx < tileWidth; ++tx)
+		{
+			int x = tileX + tx, y = tileY + ty;
+
+			if (job->baseImage != NULL && neighbourhoodContrast(job->baseImage, job->renderWidth, job->renderHeight, x, y) <= job->contrastThreshold)
 			{
-				// store colour (calculated from x,y coordinates) in image buffer 
-				*out++ = Colour((x + width / 2) % 256 / 255.0f, 0, (y + height / 2) % 256 / 255.0f).convertToPixel();
+				tileBuffer[ty * TILE_SIZE + tx] = job->baseImage[y * job->renderWidth + x];
+				continue;
 			}
+
+			tileBuffer[ty * TILE_SIZE + tx] = renderPixel(job->scene, x - job->width / 2, y - job->height / 2,
+				job->width, job->height, job->aaLevel, job->dirStepSize, job->testMode, &samplesRendered);
+			pixelsRendered++;
 		}
 	}
 
+	// rows are packed at the rendered width, the same layout the single-threaded loop wrote
+	for (int ty = 0; ty < tileHeight; ++ty)
+	{
+		memcpy(&buffer[(tileY + ty) * job->renderWidth + tileX], &tileBuffer[ty * TILE_SIZE], sizeof(unsigned int) * tileWidth);
+	}
+
+	job->samplesRendered[thread] += samplesRendered;
+	job->pixelsRendered[thread] += pixelsRendered;
+}
+
+// render scene at given width and height and anti-aliasing level, split into tiles shared between numThreads threads
+// adaptive sampling renders the whole grid only where a cheap pass has more than contrastThreshold contrast, setting refinedPixels to how many pixels that was
+int render(Scene* scene, const int width, const int height, const int aaLevel, bool testMode, int numThreads, bool adaptive, int contrastThreshold, unsigned int* refinedPixels)
+{
+	RenderJob job;
+	job.scene = scene;
+	job.width = width;
+	job.height = height;
+	job.aaLevel = aaLevel;
+	job.testMode = testMode;
+
+	// angle between each successive ray cast (per pixel, anti-aliasing uses a fraction of this)
+	job.dirStepSize = 1.0f / (0.5f * width / tanf(PIOVER180 * 0.5f * scene->cameraFieldOfView));
+
+	// pixels run from -size/2 up to (but not including) size/2
+	job.renderWidth = width / 2 * 2;
+	job.renderHeight = height / 2 * 2;
+
+	job.tilesX = (job.renderWidth + TILE_SIZE - 1) / TILE_SIZE;
+	int tilesY = (job.renderHeight + TILE_SIZE - 1) / TILE_SIZE;
+
+	static int tileOrder[(MAX_WIDTH / TILE_SIZE) * (MAX_HEIGHT / TILE_SIZE)];
+	mortonTileOrder(job.tilesX, tilesY, tileOrder);
+	job.tileOrder = tileOrder;
+
+	job.baseImage = NULL;
+	job.contrastThreshold = contrastThreshold;
+
+	for (int i = 0; i < MAX_THREADS; ++i) job.samplesRendered[i] = 0;
+
+	if (adaptive)
+	{
+		// cheap pass over every pixel, kept as the image the refining pass looks for contrast in
+		job.aaLevel = adaptiveBaseLevel(aaLevel);
+		runTilesWorkStealing(job.tilesX * tilesY, numThreads, renderTile, &job);
+
+		memcpy(baseBuffer, buffer, sizeof(unsigned int) * job.renderWidth * job.renderHeight);
+		job.baseImage = baseBuffer;
+		job.aaLevel = aaLevel;
+	}
+
+	for (int i = 0; i < MAX_THREADS; ++i) job.pixelsRendered[i] = 0;
+
+	runTilesWorkStealing(job.tilesX * tilesY, numThreads, renderTile, &job);
+
+	// count of samples rendered
+	unsigned int samplesRendered = 0;
+	*refinedPixels = 0;
+	for (int i = 0; i < MAX_THREADS; ++i)
+	{
+		samplesRendered += job.samplesRendered[i];
+		*refinedPixels += job.pixelsRendered[i];
+	}
+
 	return samplesRendered;
 }
 
@@ -295,6 +401,11 @@ int main(int argc, char* argv[])
 	// rendering options
 	int times = 1;
 	bool testMode = false;
+	int numThreads = std::max(1, std::min((int)std::thread::hardware_concurrency(), MAX_THREADS));
+	SimdLevel maxSimdLevel = SIMD_AVX2;
+	bool adaptive = false;
+	int contrastThreshold = 8;
+	const char* referenceFilename = NULL;
 
 	// default input / output filenames
 	const char* inputFilename = "Scenes/donuts.txt";
@@ -330,6 +441,33 @@ int main(int argc, char* argv[])
 		{
 			testMode = true;
 		}
+		else if (strcmp(argv[i], "-threads") == 0)
+		{
+			numThreads = std::max(1, std::min(atoi(argv[++i]), MAX_THREADS));
+		}
+		else if (strcmp(argv[i], "-simd") == 0)
+		{
+			// limit the instruction set used for intersection tests (scalar, sse or avx2)
+			++i;
+			if (strcmp(argv[i], "scalar") == 0) maxSimdLevel = SIMD_SCALAR;
+			else if (strcmp(argv[i], "sse") == 0) maxSimdLevel = SIMD_SSE;
+			else maxSimdLevel = SIMD_AVX2;
+		}
+		else if (strcmp(argv[i], "-adaptive") == 0)
+		{
+			// render the full grid of samples only where a cheap pass finds contrast
+			adaptive = true;
+		}
+		else if (strcmp(argv[i], "-adaptiveThreshold") == 0)
+		{
+			// contrast (largest difference of a channel across a pixel's neighbours, 0-255) that gets a pixel refined
+			contrastThreshold = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-reference") == 0)
+		{
+			// report the error against another render (e.g. a uniform one) once finished
+			referenceFilename = argv[++i];
+		}
 		else
 		{
 			fprintf(stderr, "unknown argument: %s\n", argv[i]);
@@ -339,6 +477,9 @@ int main(int argc, char* argv[])
 	// nasty (and fragile) kludge to make an ok-ish default output filename (can be overriden with "-output" command line option)
 	sprintf(outputFilenameBuffer, "Outputs/%s_%dx%dx%d_%s.bmp", (strrchr(inputFilename, '/') + 1), width, height, samples, (strrchr(argv[0], '\\') + 1));
 
+	// time taken by each phase (scene parse, each run's rendering, ...)
+	PhaseTimer phases;
+
 	// read scene file
 	Scene scene;
 	if (!init(inputFilename, scene))
@@ -346,46 +487,44 @@ int main(int argc, char* argv[])
 		fprintf(stderr, "Failure when reading the Scene file.\n");
 		return -1;
 	}
+	phases.endPhase("scene parse");
+
+	// copy the primitives into streams for the SIMD intersection tests, and pick the best instruction set the CPU has
+	buildSceneSoA(scene);
+	SimdLevel simdLevel = selectSimdLevel(maxSimdLevel);
+	phases.endPhase("scene setup");
+	printf("intersection tests: %s\n", simdLevelName(simdLevel));
 
 	// display info about the current scene
 	//OutputInfo(&scene);
 
-	Timer timer;																						// create timer
+	phases.restart();
 
 	// OpenCL setup code goes here
 
-	// first time and total time taken to render all runs (used to calculate average)
-	int firstTime = 0;
-	int totalTime = 0;
 	int samplesRendered = 0;
+	unsigned int refinedPixels = 0;
 	for (int i = 0; i < times; i++)
 	{
-		if (i > 0) timer.start();
+		if (i > 0) phases.nextRun();
 
 		// OpenCL execution code replaces this call to render()
-		samplesRendered = render(&scene, width, height, samples, testMode);								// raytrace scene
-
-		timer.end();																					// record end time
-		if (i > 0)
-		{
-			totalTime += timer.getMilliseconds();														// record total time taken
-		}
-		else
-		{
-			firstTime = timer.getMilliseconds();														// record first time taken
-		}
-	}
-
-	// output timing information (first run, times run and average)
-	if (times > 1)
-	{
-		printf("first run time: %dms, subsequent average time taken (%d run(s)): %.1fms\n", firstTime, times - 1, totalTime / (float)(times - 1));
-	}
-	else
-	{
-		printf("first run time: %dms, subsequent average time taken (%d run(s)): N/A\n", firstTime, times - 1);
+		samplesRendered = render(&scene, width, height, samples, testMode, numThreads, adaptive, contrastThreshold, &refinedPixels);					// raytrace scene
+		phases.endPhase("render");
 	}
 
 	// output BMP file
+	phases.restart();
 	write_bmp(outputFilename, buffer, width, height, width);
+	phases.endOneOffPhase("image write");
+
+	// output timing information (each phase of the first run and the average of the rest, then the same as JSON)
+	phases.print();
+	phases.printJSON();
+
+	if (adaptive) printSamplesSaved(samplesRendered, refinedPixels, width, height, samples);
+	if (referenceFilename != NULL) printReferenceError(buffer, width, height, referenceFilename);
+
+	releaseSceneSoA(scene);
+	releaseScene(scene);
 }
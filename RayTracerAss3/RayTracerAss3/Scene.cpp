@@ -4,221 +4,576 @@
 
 // YOU SHOULD _NOT_ NEED TO MODIFY THIS FILE (FOR ASSIGNMENT 1)
 
-#include <iostream>
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <cmath>
+#include <set>
+#include <string>
+#include <vector>
 
 #include "Scene.h"
-#include "Config.h"
 #include "SceneObjects.h"
 
-#include "ImageIO.h"
-
 #define SCENE_VERSION_MAJOR 1
 #define SCENE_VERSION_MINOR 5
 
 static const Vector NullVector = { 0.0f,0.0f,0.0f };
 static const Point Origin = { 0.0f,0.0f,0.0f };
-static const SimpleString emptyString("");
 
-bool GetMaterial(const Config &sceneFile, Material &currentMat)
-{
-    SimpleString materialType = sceneFile.GetByNameAsString("Type", emptyString);
+// the scene file is read in a single pass: sections are recognised as they're opened and each variable is converted
+// and stored straight into its object as soon as its ';' is reached, so the file is never held in memory as a whole
+
+// bytes read from the file at a time
+static const int SCENE_READ_SIZE = 1 << 16;
 
-	if (materialType.compare("checkerboard") == 0)
+// the scene file, a buffer at a time
+typedef struct SceneReader
+{
+	FILE* file;
+	char buffer[SCENE_READ_SIZE];
+	int position, size;
+	int line;
+} SceneReader;
+
+// next character of the file (EOF at the end)
+static int readChar(SceneReader& reader)
+{
+	if (reader.position == reader.size)
 	{
-        currentMat.type = Material::CHECKERBOARD;
-	} 
-	else if (materialType.compare("wood") == 0)
-    {
-        currentMat.type = Material::WOOD;
+		reader.size = (int)fread(reader.buffer, 1, SCENE_READ_SIZE, reader.file);
+		reader.position = 0;
+		if (reader.size == 0) return EOF;
 	}
-	else if (materialType.compare("circles") == 0)
+	return (unsigned char)reader.buffer[reader.position++];
+}
+
+// next character of the file without reading past it
+static int peekChar(SceneReader& reader)
+{
+	int c = readChar(reader);
+	if (c != EOF) reader.position--;
+	return c;
+}
+
+// next character that means anything (comments run from // to the end of the line, and whitespace is ignored everywhere, even inside names and values)
+static int nextChar(SceneReader& reader)
+{
+	for (;;)
 	{
-		currentMat.type = Material::CIRCLES;
+		int c = readChar(reader);
+		switch (c)
+		{
+		case '\n':
+			reader.line++;
+			break;
+		case ' ': case '\t': case '\r':
+			break;
+		case '/':
+			if (peekChar(reader) != '/') return c;
+			while ((c = readChar(reader)) != EOF && c != '\n');
+			if (c == EOF) return EOF;
+			reader.line++;
+			break;
+		default:
+			return c;
+		}
 	}
-	else
-    { 
-        // default
-        currentMat.type = Material::GOURAUD;
-    }
+}
 
-	currentMat.size = float(sceneFile.GetByNameAsFloat("Size", 0.0f));
-	currentMat.offset = sceneFile.GetByNameAsVector("Offset", NullVector);
-	currentMat.diffuse = sceneFile.GetByNameAsFloatOrColour("Diffuse", 0.0f);
-	currentMat.diffuse2 = sceneFile.GetByNameAsFloatOrColour("Diffuse2", 0.0f);
-	currentMat.reflection = float(sceneFile.GetByNameAsFloat("Reflection", 0.0f));
-	currentMat.refraction =  float(sceneFile.GetByNameAsFloat("Refraction", 0.0f)); 
-	currentMat.density = float(sceneFile.GetByNameAsFloat("Density", 0.0f));
-	currentMat.specular = sceneFile.GetByNameAsFloatOrColour("Specular", 0.0f);
-	currentMat.power = float(sceneFile.GetByNameAsFloat("Power", 0.0f)); 
+// kinds of section the scene is made of (any other section is read but ignored)
+enum SectionKind { SECTION_MATERIAL, SECTION_LIGHT, SECTION_SPHERE, SECTION_PLANE, SECTION_CYLINDER, NUM_OBJECT_SECTIONS, SECTION_SCENE = NUM_OBJECT_SECTIONS, SECTION_OTHER };
 
-	return true;
-}
+static const char* sectionNames[NUM_OBJECT_SECTIONS] = { "Material", "Light", "Sphere", "Plane", "Cylinder" };
+
+// variables each kind of section has, in the order of the bits that record whether they've been set
+static const char* const sceneVariables[] = { "Version.Major", "Version.Minor", "Skybox.Material.Id", "Camera.Position", "Camera.Rotation", "Camera.FieldOfView",
+	"Exposure", "NumberOfMaterials", "NumberOfLights", "NumberOfSpheres", "NumberOfPlanes", "NumberOfCylinders", NULL };
+static const char* const materialVariables[] = { "Type", "Size", "Offset", "Diffuse", "Diffuse2", "Reflection", "Refraction", "Density", "Specular", "Power", NULL };
+static const char* const lightVariables[] = { "Position", "Intensity", NULL };
+static const char* const sphereVariables[] = { "Center", "Size", "Material.Id", NULL };
+static const char* const planeVariables[] = { "Center", "Normal", "Material.Id", NULL };
+static const char* const cylinderVariables[] = { "Point1", "Point2", "Size", "Material.Id", NULL };
 
-bool GetSphere(const Config &sceneFile, const Scene& scene, Sphere &currentSph)
+static const char* const* sectionVariables[] = { materialVariables, lightVariables, sphereVariables, planeVariables, cylinderVariables, sceneVariables };
+
+// scene settings as they're written in the file (the camera rotation is turned into radians once the file is read)
+typedef struct SceneSettings
 {
-    currentSph.pos = sceneFile.GetByNameAsPoint("Center", Origin); 
-    currentSph.size =  float(sceneFile.GetByNameAsFloat("Size", 0.0f)); 
+	unsigned int versionMajor, versionMinor;
+	float cameraRotation;
+} SceneSettings;
 
-	currentSph.materialId = sceneFile.GetByNameAsInteger("Material.Id", 0);
+// a section that came before the Scene section, kept until the object counts are known
+typedef struct DeferredSection
+{
+	std::string name;
+	std::vector<std::string> variables;		// name then value of each variable, in the order they were set
+} DeferredSection;
 
-	if (currentSph.materialId >= scene.numMaterials)
+// what's been read of the file so far
+typedef struct SceneParser
+{
+	Scene* scene;
+	SceneSettings settings;
+	bool countsKnown;						// whether the Scene section has been read (and the object arrays allocated)
+
+	// the section being read
+	SectionKind kind;
+	unsigned int index;
+	unsigned int assigned;					// bit per variable that's been set (the first value of a variable set twice is kept)
+	DeferredSection* deferred;				// where to keep the section's variables if it came before the Scene section
+
+	// sections read so far, to catch any that appear twice (objects by index, anything else by name)
+	std::vector<bool> seen[NUM_OBJECT_SECTIONS];
+	std::set<std::string> seenNames;
+	std::vector<DeferredSection> deferredSections;
+} SceneParser;
+
+// number of objects of a kind the Scene section asked for
+static unsigned int objectCount(const Scene& scene, SectionKind kind)
+{
+	switch (kind)
 	{
-		fprintf(stderr, "Malformed Scene file: Sphere Material Id not valid.\n");
-		return false;
+	case SECTION_MATERIAL: return scene.numMaterials;
+	case SECTION_LIGHT: return scene.numLights;
+	case SECTION_SPHERE: return scene.numSpheres;
+	case SECTION_PLANE: return scene.numPlanes;
+	case SECTION_CYLINDER: return scene.numCylinders;
+	default: return 0;
 	}
-
-	return true;
 }
 
-bool GetPlane(const Config& sceneFile, const Scene& scene, Plane& currentPlane)
+// work out the kind and index of a section from its name (the index must be written the way the old parser looked it up, eg. "Sphere7" not "Sphere07")
+static SectionKind classifySection(const std::string& name, unsigned int* index)
 {
-	currentPlane.pos = sceneFile.GetByNameAsPoint("Center", Origin);
-	currentPlane.normal = normalise(sceneFile.GetByNameAsVector("Normal", NullVector));
+	if (name == "Scene") return SECTION_SCENE;
 
-	currentPlane.materialId = sceneFile.GetByNameAsInteger("Material.Id", 0);
-
-	if (currentPlane.materialId >= scene.numMaterials)
+	for (int kind = 0; kind < NUM_OBJECT_SECTIONS; ++kind)
 	{
-		fprintf(stderr, "Malformed Scene file: Plane Material Id not valid.\n");
-		return false;
+		size_t length = strlen(sectionNames[kind]);
+		if (name.size() <= length || name.compare(0, length, sectionNames[kind]) != 0) continue;
+
+		const char* digits = name.c_str() + length;
+		if (digits[0] == '0' && digits[1] != '\0') return SECTION_OTHER;
+
+		char* end;
+		unsigned long value = strtoul(digits, &end, 10);
+		if (*end != '\0' || digits[0] < '0' || digits[0] > '9' || value > 0xFFFFFFFFUL) return SECTION_OTHER;
+
+		*index = (unsigned int)value;
+		return (SectionKind)kind;
 	}
 
-	return true;
+	return SECTION_OTHER;
 }
 
-bool GetCylinder(const Config& sceneFile, const Scene& scene, Cylinder& currentCylinder)
+// read three comma separated numbers into x, y and z (the same as scanning "%f,%f,%f", but without sscanf's overhead), returning false unless all three are there
+static bool parseTriple(const char* value, float* x, float* y, float* z)
 {
-	currentCylinder.p1 = sceneFile.GetByNameAsPoint("Point1", Origin);
-	currentCylinder.p2 = sceneFile.GetByNameAsPoint("Point2", Origin);
-	currentCylinder.size = float(sceneFile.GetByNameAsFloat("Size", 0.0f));
-
-	currentCylinder.materialId = sceneFile.GetByNameAsInteger("Material.Id", 0);
+	char* end;
+	*x = strtof(value, &end);
+	if (end == value || *end != ',') return false;
+	value = end + 1;
+	*y = strtof(value, &end);
+	if (end == value || *end != ',') return false;
+	value = end + 1;
+	*z = strtof(value, &end);
+	return end != value;
+}
 
-	if (currentCylinder.materialId >= scene.numMaterials)
-	{
-		fprintf(stderr, "Malformed Scene file: Cylinder Material Id not valid.\n");
-		return false;
-	}
+static Vector parseVector(const char* value, const Vector& vDefault)
+{
+	Vector v = { 0.0f, 0.0f, 0.0f };
+	if (!parseTriple(value, &v.x, &v.y, &v.z)) return vDefault;
+	return v;
+}
 
-	return true;
+static Point parsePoint(const char* value, const Point& ptDefault)
+{
+	Point p = { 0.0f, 0.0f, 0.0f };
+	if (!parseTriple(value, &p.x, &p.y, &p.z)) return ptDefault;
+	return p;
 }
 
-void GetLight(const Config &sceneFile, Light &currentLight)
+// a single number for all three channels, or one for each
+static Colour parseFloatOrColour(const char* value)
 {
-	currentLight.pos = sceneFile.GetByNameAsPoint("Position", Origin); 
-	currentLight.intensity = sceneFile.GetByNameAsFloatOrColour("Intensity", 0.0f);
+	float scalar = float(atof(value));
+	Vector vScalar = { scalar, scalar, scalar };
+	Vector vColour = parseVector(value, vScalar);
+	return Colour(vColour.x, vColour.y, vColour.z);
 }
 
-bool init(const char* inputName, Scene& scene)
+// start a section of the file, returning false if a section by the same name has already been read
+static bool beginSection(SceneParser& parser, const std::string& name)
 {
-//	int nbMats, nbSpheres, nbBlobs, nbLights, 
-	unsigned int versionMajor, versionMinor;
-	Config sceneFile(inputName);
-    if (sceneFile.SetSection("Scene") == -1)
-    {
-		fprintf(stderr, "Malformed Scene file: No Scene section.\n");
-		return false;
-    }
+	parser.kind = classifySection(name, &parser.index);
+	parser.assigned = 0;
+	parser.deferred = NULL;
 
-	versionMajor = sceneFile.GetByNameAsInteger("Version.Major", 0);
-	versionMinor = sceneFile.GetByNameAsInteger("Version.Minor", 0);
+	// objects beyond the counts are never used, so they're treated like any other section
+	if (parser.kind < NUM_OBJECT_SECTIONS && parser.countsKnown && parser.index >= objectCount(*parser.scene, parser.kind)) parser.kind = SECTION_OTHER;
 
-	if (versionMajor != SCENE_VERSION_MAJOR || versionMinor != SCENE_VERSION_MINOR)
+	if (parser.kind < NUM_OBJECT_SECTIONS && parser.countsKnown)
+	{
+		if (parser.seen[parser.kind][parser.index]) return false;
+		parser.seen[parser.kind][parser.index] = true;
+	}
+	else if (!parser.seenNames.insert(name).second)
 	{
-        fprintf(stderr, "Malformed Scene file: Wrong scene file version.\n");
 		return false;
 	}
 
-	scene.skyboxMaterialId = sceneFile.GetByNameAsInteger("Skybox.Material.Id", 0);
+	// objects can't be stored until the Scene section says how many there are
+	if (parser.kind < NUM_OBJECT_SECTIONS && !parser.countsKnown)
+	{
+		parser.deferredSections.push_back(DeferredSection());
+		parser.deferred = &parser.deferredSections.back();
+		parser.deferred->name = name;
+		return true;
+	}
 
-	// camera details
-	scene.cameraPosition = sceneFile.GetByNameAsPoint("Camera.Position", Origin);
-    scene.cameraRotation = -float(sceneFile.GetByNameAsFloat("Camera.Rotation", 45.0f)) * PIOVER180;
+	Scene& scene = *parser.scene;
+	switch (parser.kind)
+	{
+	case SECTION_MATERIAL:
+	{
+		Material& material = scene.materialContainer[parser.index];
+		material.type = Material::GOURAUD;
+		material.size = 0.0f;
+		material.offset = NullVector;
+		material.diffuse = Colour(0.0f, 0.0f, 0.0f);
+		material.diffuse2 = Colour(0.0f, 0.0f, 0.0f);
+		material.reflection = 0.0f;
+		material.refraction = 0.0f;
+		material.density = 0.0f;
+		material.specular = Colour(0.0f, 0.0f, 0.0f);
+		material.power = 0.0f;
+		break;
+	}
+	case SECTION_LIGHT:
+		scene.lightContainer[parser.index].pos = Origin;
+		scene.lightContainer[parser.index].intensity = Colour(0.0f, 0.0f, 0.0f);
+		break;
+	case SECTION_SPHERE:
+		scene.sphereContainer[parser.index].pos = Origin;
+		scene.sphereContainer[parser.index].size = 0.0f;
+		scene.sphereContainer[parser.index].materialId = 0;
+		break;
+	case SECTION_PLANE:
+		scene.planeContainer[parser.index].pos = Origin;
+		scene.planeContainer[parser.index].normal = NullVector;
+		scene.planeContainer[parser.index].materialId = 0;
+		break;
+	case SECTION_CYLINDER:
+		scene.cylinderContainer[parser.index].p1 = Origin;
+		scene.cylinderContainer[parser.index].p2 = Origin;
+		scene.cylinderContainer[parser.index].size = 0.0f;
+		scene.cylinderContainer[parser.index].materialId = 0;
+		break;
+	default:
+		break;
+	}
 
-    scene.cameraFieldOfView = float(sceneFile.GetByNameAsFloat("Camera.FieldOfView", 45.0f));
-    if (scene.cameraFieldOfView <= 0.0f || scene.cameraFieldOfView >= 189.0f)
-    {
-	    fprintf(stderr, "Malformed Scene file: Out of range FOV.\n");
-        return false;
-    }
+	return true;
+}
 
-	scene.exposure = float(sceneFile.GetByNameAsFloat("Exposure", 1.0f));
+// store a variable of the current section in its object
+static void setVariable(SceneParser& parser, const std::string& name, const std::string& value)
+{
+	if (parser.kind == SECTION_OTHER) return;
+
+	if (parser.deferred != NULL)
+	{
+		parser.deferred->variables.push_back(name);
+		parser.deferred->variables.push_back(value);
+		return;
+	}
 
-	scene.numMaterials = sceneFile.GetByNameAsInteger("NumberOfMaterials", 0);
-	scene.numLights = sceneFile.GetByNameAsInteger("NumberOfLights", 0);
-	
-	scene.numSpheres = sceneFile.GetByNameAsInteger("NumberOfSpheres", 0);
-	scene.numPlanes = sceneFile.GetByNameAsInteger("NumberOfPlanes", 0);
-	scene.numCylinders = sceneFile.GetByNameAsInteger("NumberOfCylinders", 0);
+	// find which of the section's variables it is (anything else is ignored)
+	const char* const* variables = sectionVariables[parser.kind];
+	int variable = 0;
+	while (variables[variable] != NULL && name != variables[variable]) ++variable;
+	if (variables[variable] == NULL || (parser.assigned & (1u << variable))) return;
+	parser.assigned |= 1u << variable;
 
+	Scene& scene = *parser.scene;
+	const char* v = value.c_str();
+	switch (parser.kind)
+	{
+	case SECTION_SCENE:
+		switch (variable)
+		{
+		case 0: parser.settings.versionMajor = atol(v); break;
+		case 1: parser.settings.versionMinor = atol(v); break;
+		case 2: scene.skyboxMaterialId = atol(v); break;
+		case 3: scene.cameraPosition = parsePoint(v, Origin); break;
+		case 4: parser.settings.cameraRotation = float(atof(v)); break;
+		case 5: scene.cameraFieldOfView = float(atof(v)); break;
+		case 6: scene.exposure = float(atof(v)); break;
+		case 7: scene.numMaterials = atol(v); break;
+		case 8: scene.numLights = atol(v); break;
+		case 9: scene.numSpheres = atol(v); break;
+		case 10: scene.numPlanes = atol(v); break;
+		case 11: scene.numCylinders = atol(v); break;
+		}
+		break;
+	case SECTION_MATERIAL:
+	{
+		Material& material = scene.materialContainer[parser.index];
+		switch (variable)
+		{
+		case 0:
+			if (value == "checkerboard") material.type = Material::CHECKERBOARD;
+			else if (value == "wood") material.type = Material::WOOD;
+			else if (value == "circles") material.type = Material::CIRCLES;
+			else material.type = Material::GOURAUD;
+			break;
+		case 1: material.size = float(atof(v)); break;
+		case 2: material.offset = parseVector(v, NullVector); break;
+		case 3: material.diffuse = parseFloatOrColour(v); break;
+		case 4: material.diffuse2 = parseFloatOrColour(v); break;
+		case 5: material.reflection = float(atof(v)); break;
+		case 6: material.refraction = float(atof(v)); break;
+		case 7: material.density = float(atof(v)); break;
+		case 8: material.specular = parseFloatOrColour(v); break;
+		case 9: material.power = float(atof(v)); break;
+		}
+		break;
+	}
+	case SECTION_LIGHT:
+		if (variable == 0) scene.lightContainer[parser.index].pos = parsePoint(v, Origin);
+		else scene.lightContainer[parser.index].intensity = parseFloatOrColour(v);
+		break;
+	case SECTION_SPHERE:
+		if (variable == 0) scene.sphereContainer[parser.index].pos = parsePoint(v, Origin);
+		else if (variable == 1) scene.sphereContainer[parser.index].size = float(atof(v));
+		else scene.sphereContainer[parser.index].materialId = atol(v);
+		break;
+	case SECTION_PLANE:
+		if (variable == 0) scene.planeContainer[parser.index].pos = parsePoint(v, Origin);
+		else if (variable == 1) scene.planeContainer[parser.index].normal = parseVector(v, NullVector);
+		else scene.planeContainer[parser.index].materialId = atol(v);
+		break;
+	case SECTION_CYLINDER:
+		if (variable == 0) scene.cylinderContainer[parser.index].p1 = parsePoint(v, Origin);
+		else if (variable == 1) scene.cylinderContainer[parser.index].p2 = parsePoint(v, Origin);
+		else if (variable == 2) scene.cylinderContainer[parser.index].size = float(atof(v));
+		else scene.cylinderContainer[parser.index].materialId = atol(v);
+		break;
+	default:
+		break;
+	}
+}
+
+// finish a section, allocating the objects once the Scene section is done (and storing any that came before it)
+static bool endSection(SceneParser& parser)
+{
+	if (parser.kind != SECTION_SCENE) return true;
+
+	Scene& scene = *parser.scene;
 	scene.materialContainer = new Material[scene.numMaterials];
 	scene.lightContainer = new Light[scene.numLights];
 	scene.sphereContainer = new Sphere[scene.numSpheres];
 	scene.planeContainer = new Plane[scene.numPlanes];
 	scene.cylinderContainer = new Cylinder[scene.numCylinders];
 
-	// have to read the materials section before the material ids (used for the triangles, 
-	// spheres, and planes) can be turned into pointers to actual materials
-	for (unsigned int i = 0; i < scene.numMaterials; ++i)
-    {   
-        Material &currentMat = scene.materialContainer[i];
-        SimpleString sectionName("Material");
-        sectionName.append((unsigned long) i);
-        if (sceneFile.SetSection( sectionName ) == -1)
-        {
-			fprintf(stderr, "Malformed Scene file: Missing Material section.\n");
-		    return false;
-        }
-        if (!GetMaterial(sceneFile, currentMat))
+	for (int kind = 0; kind < NUM_OBJECT_SECTIONS; ++kind)
+	{
+		parser.seen[kind].assign(objectCount(scene, (SectionKind)kind), false);
+	}
+	parser.countsKnown = true;
+
+	// the names of the sections that came first are already known to be unique, so only the objects need marking as seen
+	std::vector<DeferredSection> deferredSections;
+	deferredSections.swap(parser.deferredSections);
+	for (size_t i = 0; i < deferredSections.size(); ++i)
+	{
+		const DeferredSection& section = deferredSections[i];
+		parser.seenNames.erase(section.name);
+		beginSection(parser, section.name);
+		for (size_t j = 0; j < section.variables.size(); j += 2)
 		{
-			fprintf(stderr, "Malformed Scene file: Malformed Material section.\n");
-		    return false;
+			setVariable(parser, section.variables[j], section.variables[j + 1]);
 		}
-    }
+	}
 
-	for (unsigned int i = 0; i < scene.numLights; ++i)
+	return true;
+}
+
+// read every section of the file, returning false if it isn't laid out as sections of name = value; pairs
+static bool parseSections(SceneReader& reader, SceneParser& parser)
+{
+	std::string name, value;
+
+	for (;;)
 	{
-		Light &currentLight = scene.lightContainer[i];
-		SimpleString sectionName("Light");
-		sectionName.append((unsigned long)i);
-		if (sceneFile.SetSection(sectionName) == -1)
+		// section name, up to its opening brace (anything after the last section is ignored)
+		name.clear();
+		int c;
+		while ((c = nextChar(reader)) != EOF && c != '{') name += (char)c;
+		if (c == EOF) return true;
+
+		if (!beginSection(parser, name))
 		{
-			fprintf(stderr, "Malformed Scene file: Missing Light section.\n");
+			fprintf(stderr, "Malformed Scene file: %s section appears twice (line %d).\n", name.c_str(), reader.line);
 			return false;
 		}
-		GetLight(sceneFile, currentLight);
+
+		// variables until the matching closing brace (braces inside a section are allowed, and their variables belong to the section)
+		int depth = 1;
+		name.clear();
+		while (depth > 0)
+		{
+			c = nextChar(reader);
+			switch (c)
+			{
+			case EOF:
+				fprintf(stderr, "Malformed Scene file: unterminated section at the end of the file.\n");
+				return false;
+			case '{':
+				++depth;
+				break;
+			case '}':
+				if (!name.empty())
+				{
+					fprintf(stderr, "Malformed Scene file: %s has no value (line %d).\n", name.c_str(), reader.line);
+					return false;
+				}
+				--depth;
+				break;
+			case '=':
+				if (name.empty())
+				{
+					fprintf(stderr, "Malformed Scene file: value without a name (line %d).\n", reader.line);
+					return false;
+				}
+
+				value.clear();
+				while ((c = nextChar(reader)) != ';')
+				{
+					if (c == EOF || c == '{' || c == '}')
+					{
+						fprintf(stderr, "Malformed Scene file: %s isn't ended by a ';' (line %d).\n", name.c_str(), reader.line);
+						return false;
+					}
+					value += (char)c;
+				}
+				if (value.empty())
+				{
+					fprintf(stderr, "Malformed Scene file: %s has no value (line %d).\n", name.c_str(), reader.line);
+					return false;
+				}
+
+				setVariable(parser, name, value);
+				name.clear();
+				break;
+			default:
+				name += (char)c;
+				break;
+			}
+		}
+
+		if (!endSection(parser)) return false;
 	}
+}
 
-	for (unsigned int i = 0; i < scene.numSpheres; ++i)
-    {   
-        Sphere &currentSphere = scene.sphereContainer[i];
-        SimpleString sectionName("Sphere");
-        sectionName.append((unsigned long) i);
-        if (sceneFile.SetSection( sectionName ) == -1)
-        {
-			fprintf(stderr, "Malformed Scene file: Missing Sphere section.\n");
-		    return false;
-        }
-		if (!GetSphere(sceneFile, scene, currentSphere))
+bool init(const char* inputName, Scene& scene)
+{
+	// settings the file doesn't give are left at these
+	scene.skyboxMaterialId = 0;
+	scene.cameraPosition = Origin;
+	scene.cameraFieldOfView = 45.0f;
+	scene.exposure = 1.0f;
+	scene.numMaterials = 0;
+	scene.numLights = 0;
+	scene.numSpheres = 0;
+	scene.numPlanes = 0;
+	scene.numCylinders = 0;
+	scene.materialContainer = NULL;
+	scene.lightContainer = NULL;
+	scene.sphereContainer = NULL;
+	scene.planeContainer = NULL;
+	scene.cylinderContainer = NULL;
+	scene.soa = NULL;
+
+	SceneParser parser;
+	parser.scene = &scene;
+	parser.settings.versionMajor = 0;
+	parser.settings.versionMinor = 0;
+	parser.settings.cameraRotation = 45.0f;
+	parser.countsKnown = false;
+
+	// the reader's buffer is too big for the stack
+	SceneReader* reader = new SceneReader;
+	reader->file = fopen(inputName, "rb");
+	reader->position = reader->size = 0;
+	reader->line = 1;
+	if (reader->file == NULL)
+	{
+		fprintf(stderr, "Malformed Scene file: couldn't open %s.\n", inputName);
+		delete reader;
+		return false;
+	}
+
+	bool parsed = parseSections(*reader, parser);
+	fclose(reader->file);
+	delete reader;
+	if (!parsed) return false;
+
+	if (!parser.countsKnown)
+	{
+		fprintf(stderr, "Malformed Scene file: No Scene section.\n");
+		return false;
+	}
+
+	if (parser.settings.versionMajor != SCENE_VERSION_MAJOR || parser.settings.versionMinor != SCENE_VERSION_MINOR)
+	{
+		fprintf(stderr, "Malformed Scene file: Wrong scene file version.\n");
+		return false;
+	}
+
+	scene.cameraRotation = -parser.settings.cameraRotation * PIOVER180;
+	if (scene.cameraFieldOfView <= 0.0f || scene.cameraFieldOfView >= 189.0f)
+	{
+		fprintf(stderr, "Malformed Scene file: Out of range FOV.\n");
+		return false;
+	}
+
+	// every object the Scene section counted must have had a section
+	for (int kind = 0; kind < NUM_OBJECT_SECTIONS; ++kind)
+	{
+		for (unsigned int i = 0; i < parser.seen[kind].size(); ++i)
 		{
-			fprintf(stderr, "Malformed Scene file: Sphere %d section.\n", i);
-		    return false;
+			if (!parser.seen[kind][i])
+			{
+				fprintf(stderr, "Malformed Scene file: Missing %s section (%s%u).\n", sectionNames[kind], sectionNames[kind], i);
+				return false;
+			}
 		}
-    }
+	}
 
-	for (unsigned int i = 0; i < scene.numPlanes; ++i)
+	for (unsigned int i = 0; i < scene.numSpheres; ++i)
 	{
-		Plane& currentPlane = scene.planeContainer[i];
-		SimpleString sectionName("Plane");
-		sectionName.append((unsigned long)i);
-		if (sceneFile.SetSection(sectionName) == -1)
+		if (scene.sphereContainer[i].materialId >= scene.numMaterials)
 		{
-			fprintf(stderr, "Malformed Scene file: Missing Plane section.\n");
+			fprintf(stderr, "Malformed Scene file: Sphere Material Id not valid.\n");
+			fprintf(stderr, "Malformed Scene file: Sphere %d section.\n", i);
 			return false;
 		}
-		if (!GetPlane(sceneFile, scene, currentPlane))
+	}
+
+	for (unsigned int i = 0; i < scene.numPlanes; ++i)
+	{
+		scene.planeContainer[i].normal = normalise(scene.planeContainer[i].normal);
+		if (scene.planeContainer[i].materialId >= scene.numMaterials)
 		{
+			fprintf(stderr, "Malformed Scene file: Plane Material Id not valid.\n");
 			fprintf(stderr, "Malformed Scene file: Plane %d section.\n", i);
 			return false;
 		}
@@ -226,16 +581,9 @@ bool init(const char* inputName, Scene& scene)
 
 	for (unsigned int i = 0; i < scene.numCylinders; ++i)
 	{
-		Cylinder& currentCyl = scene.cylinderContainer[i];
-		SimpleString sectionName("Cylinder");
-		sectionName.append((unsigned long)i);
-		if (sceneFile.SetSection(sectionName) == -1)
-		{
-			fprintf(stderr, "Malformed Scene file: Missing Cylinder section.\n");
-			return false;
-		}
-		if (!GetCylinder(sceneFile, scene, currentCyl))
+		if (scene.cylinderContainer[i].materialId >= scene.numMaterials)
 		{
+			fprintf(stderr, "Malformed Scene file: Cylinder Material Id not valid.\n");
 			fprintf(stderr, "Malformed Scene file: Cylinder %d section.\n", i);
 			return false;
 		}
@@ -244,3 +592,16 @@ bool init(const char* inputName, Scene& scene)
 	return true;
 }
 
+void releaseScene(Scene& scene)
+{
+	delete[] scene.materialContainer;
+	delete[] scene.lightContainer;
+	delete[] scene.sphereContainer;
+	delete[] scene.planeContainer;
+	delete[] scene.cylinderContainer;
+	scene.materialContainer = NULL;
+	scene.lightContainer = NULL;
+	scene.sphereContainer = NULL;
+	scene.planeContainer = NULL;
+	scene.cylinderContainer = NULL;
+}
@@ -33,8 +33,14 @@ typedef struct Scene
 	Sphere* sphereContainer;
 	Plane* planeContainer;
 	Cylinder* cylinderContainer;
+
+	// structure-of-arrays copy of the primitives for the SIMD intersection tests (see SimdIntersection.h)
+	struct SceneSoA* soa;
 } Scene;
 
 bool init(const char* inputName, Scene& scene);
 
+// free the scene's objects
+void releaseScene(Scene& scene);
+
 #endif // __SCENE_H
@@ -0,0 +1,259 @@
+#include <xmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include "SimdIntersection.h"
+
+// ---- scalar versions (one primitive at a time) ----
+
+static int closestSphereScalar(const Scene* scene, const Ray* r, float* t)
+{
+	int closest = -1;
+	for (unsigned int i = 0; i < scene->numSpheres; ++i)
+	{
+		if (isSphereIntersected(&scene->sphereContainer[i], r, t)) closest = i;
+	}
+	return closest;
+}
+
+static int closestPlaneScalar(const Scene* scene, const Ray* r, float* t)
+{
+	int closest = -1;
+	for (unsigned int i = 0; i < scene->numPlanes; ++i)
+	{
+		if (isPlaneIntersected(&scene->planeContainer[i], r, t)) closest = i;
+	}
+	return closest;
+}
+
+static int closestCylinderScalar(const Scene* scene, const Ray* r, float* t, Vector* normal)
+{
+	int closest = -1;
+	for (unsigned int i = 0; i < scene->numCylinders; ++i)
+	{
+		if (isCylinderIntersected(&scene->cylinderContainer[i], r, t, normal)) closest = i;
+	}
+	return closest;
+}
+
+static bool anySphereOccludingScalar(const Scene* scene, const Ray* r, const float t)
+{
+	for (unsigned int i = 0; i < scene->numSpheres; ++i)
+	{
+		if (isSphereOccluding(&scene->sphereContainer[i], r, t)) return true;
+	}
+	return false;
+}
+
+static bool anyPlaneOccludingScalar(const Scene* scene, const Ray* r, const float t)
+{
+	for (unsigned int i = 0; i < scene->numPlanes; ++i)
+	{
+		if (isPlaneOccluding(&scene->planeContainer[i], r, t)) return true;
+	}
+	return false;
+}
+
+static bool anyCylinderOccludingScalar(const Scene* scene, const Ray* r, const float t)
+{
+	for (unsigned int i = 0; i < scene->numCylinders; ++i)
+	{
+		if (isCylinderOccluding(&scene->cylinderContainer[i], r, t)) return true;
+	}
+	return false;
+}
+
+// ---- SIMD versions (SimdIntersectionSSE.cpp and SimdIntersectionAVX2.cpp) ----
+
+int closestSphereSSE(const Scene* scene, const Ray* r, float* t);
+int closestPlaneSSE(const Scene* scene, const Ray* r, float* t);
+int closestCylinderSSE(const Scene* scene, const Ray* r, float* t, Vector* normal);
+bool anySphereOccludingSSE(const Scene* scene, const Ray* r, const float t);
+bool anyPlaneOccludingSSE(const Scene* scene, const Ray* r, const float t);
+bool anyCylinderOccludingSSE(const Scene* scene, const Ray* r, const float t);
+
+int closestSphereAVX2(const Scene* scene, const Ray* r, float* t);
+int closestPlaneAVX2(const Scene* scene, const Ray* r, float* t);
+int closestCylinderAVX2(const Scene* scene, const Ray* r, float* t, Vector* normal);
+bool anySphereOccludingAVX2(const Scene* scene, const Ray* r, const float t);
+bool anyPlaneOccludingAVX2(const Scene* scene, const Ray* r, const float t);
+bool anyCylinderOccludingAVX2(const Scene* scene, const Ray* r, const float t);
+
+static const SimdIntersectionFunctions scalarFunctions = {
+	closestSphereScalar, closestPlaneScalar, closestCylinderScalar,
+	anySphereOccludingScalar, anyPlaneOccludingScalar, anyCylinderOccludingScalar };
+
+static const SimdIntersectionFunctions sseFunctions = {
+	closestSphereSSE, closestPlaneSSE, closestCylinderSSE,
+	anySphereOccludingSSE, anyPlaneOccludingSSE, anyCylinderOccludingSSE };
+
+static const SimdIntersectionFunctions avx2Functions = {
+	closestSphereAVX2, closestPlaneAVX2, closestCylinderAVX2,
+	anySphereOccludingAVX2, anyPlaneOccludingAVX2, anyCylinderOccludingAVX2 };
+
+SimdIntersectionFunctions simdIntersection = scalarFunctions;
+
+// ---- CPU feature detection ----
+
+static void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int registers[4])
+{
+#ifdef _MSC_VER
+	__cpuidex((int*)registers, (int)leaf, (int)subleaf);
+#else
+	__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// whether the CPU has AVX2 and the OS saves the AVX registers on a context switch
+static bool supportsAVX2()
+{
+	unsigned int registers[4];
+
+	cpuid(0, 0, registers);
+	if (registers[0] < 7) return false;
+
+	// OSXSAVE and AVX
+	cpuid(1, 0, registers);
+	if ((registers[2] & (1u << 27)) == 0 || (registers[2] & (1u << 28)) == 0) return false;
+
+	// XMM and YMM state enabled by the OS
+#ifdef _MSC_VER
+	unsigned long long xcr0 = _xgetbv(0);
+#else
+	unsigned int xcr0Low, xcr0High;
+	__asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+	unsigned long long xcr0 = ((unsigned long long)xcr0High << 32) | xcr0Low;
+#endif
+	if ((xcr0 & 6) != 6) return false;
+
+	// AVX2
+	cpuid(7, 0, registers);
+	return (registers[1] & (1u << 5)) != 0;
+}
+
+SimdLevel selectSimdLevel(SimdLevel maximum)
+{
+	SimdLevel level = SIMD_SCALAR;
+	if (maximum >= SIMD_SSE) level = SIMD_SSE;		// always there on x64
+	if (maximum >= SIMD_AVX2 && supportsAVX2()) level = SIMD_AVX2;
+
+	switch (level)
+	{
+	case SIMD_SCALAR:
+		simdIntersection = scalarFunctions;
+		break;
+	case SIMD_SSE:
+		simdIntersection = sseFunctions;
+		break;
+	case SIMD_AVX2:
+		simdIntersection = avx2Functions;
+		break;
+	}
+
+	return level;
+}
+
+const char* simdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case SIMD_SSE:
+		return "sse";
+	case SIMD_AVX2:
+		return "avx2";
+	default:
+		return "scalar";
+	}
+}
+
+// ---- structure-of-arrays scene ----
+
+// allocate a stream padded to a multiple of the widest batch (padding is zeroed, and never reported as a hit)
+static float* allocateStream(unsigned int count)
+{
+	unsigned int padded = (count + SIMD_MAX_WIDTH - 1) / SIMD_MAX_WIDTH * SIMD_MAX_WIDTH;
+	if (padded == 0) padded = SIMD_MAX_WIDTH;
+
+	float* stream = (float*)_mm_malloc(sizeof(float) * padded, sizeof(float) * SIMD_MAX_WIDTH);
+	for (unsigned int i = 0; i < padded; ++i) stream[i] = 0.0f;
+
+	return stream;
+}
+
+void buildSceneSoA(Scene& scene)
+{
+	SceneSoA* soa = new SceneSoA;
+
+	soa->sphereX = allocateStream(scene.numSpheres);
+	soa->sphereY = allocateStream(scene.numSpheres);
+	soa->sphereZ = allocateStream(scene.numSpheres);
+	soa->sphereRadiusSq = allocateStream(scene.numSpheres);
+	for (unsigned int i = 0; i < scene.numSpheres; ++i)
+	{
+		const Sphere& s = scene.sphereContainer[i];
+		soa->sphereX[i] = s.pos.x;
+		soa->sphereY[i] = s.pos.y;
+		soa->sphereZ[i] = s.pos.z;
+		soa->sphereRadiusSq[i] = s.size * s.size;
+	}
+
+	soa->planeX = allocateStream(scene.numPlanes);
+	soa->planeY = allocateStream(scene.numPlanes);
+	soa->planeZ = allocateStream(scene.numPlanes);
+	soa->planeNormalX = allocateStream(scene.numPlanes);
+	soa->planeNormalY = allocateStream(scene.numPlanes);
+	soa->planeNormalZ = allocateStream(scene.numPlanes);
+	for (unsigned int i = 0; i < scene.numPlanes; ++i)
+	{
+		const Plane& p = scene.planeContainer[i];
+		soa->planeX[i] = p.pos.x;
+		soa->planeY[i] = p.pos.y;
+		soa->planeZ[i] = p.pos.z;
+		soa->planeNormalX[i] = p.normal.x;
+		soa->planeNormalY[i] = p.normal.y;
+		soa->planeNormalZ[i] = p.normal.z;
+	}
+
+	soa->cylinderX = allocateStream(scene.numCylinders);
+	soa->cylinderY = allocateStream(scene.numCylinders);
+	soa->cylinderZ = allocateStream(scene.numCylinders);
+	soa->cylinderAxisX = allocateStream(scene.numCylinders);
+	soa->cylinderAxisY = allocateStream(scene.numCylinders);
+	soa->cylinderAxisZ = allocateStream(scene.numCylinders);
+	soa->cylinderAxisLengthSq = allocateStream(scene.numCylinders);
+	soa->cylinderRadiusTerm = allocateStream(scene.numCylinders);
+	for (unsigned int i = 0; i < scene.numCylinders; ++i)
+	{
+		const Cylinder& c = scene.cylinderContainer[i];
+		Vector ca = c.p2 - c.p1;
+		float caca = ca * ca;
+
+		soa->cylinderX[i] = c.p1.x;
+		soa->cylinderY[i] = c.p1.y;
+		soa->cylinderZ[i] = c.p1.z;
+		soa->cylinderAxisX[i] = ca.x;
+		soa->cylinderAxisY[i] = ca.y;
+		soa->cylinderAxisZ[i] = ca.z;
+		soa->cylinderAxisLengthSq[i] = caca;
+		soa->cylinderRadiusTerm[i] = c.size * c.size * caca;
+	}
+
+	scene.soa = soa;
+}
+
+void releaseSceneSoA(Scene& scene)
+{
+	SceneSoA* soa = scene.soa;
+	if (soa == NULL) return;
+
+	float* streams[] = { soa->sphereX, soa->sphereY, soa->sphereZ, soa->sphereRadiusSq,
+		soa->planeX, soa->planeY, soa->planeZ, soa->planeNormalX, soa->planeNormalY, soa->planeNormalZ,
+		soa->cylinderX, soa->cylinderY, soa->cylinderZ, soa->cylinderAxisX, soa->cylinderAxisY, soa->cylinderAxisZ,
+		soa->cylinderAxisLengthSq, soa->cylinderRadiusTerm };
+	for (size_t i = 0; i < sizeof(streams) / sizeof(streams[0]); ++i) _mm_free(streams[i]);
+
+	delete soa;
+	scene.soa = NULL;
+}
@@ -0,0 +1,62 @@
+#ifndef __SIMD_INTERSECTION_H
+#define __SIMD_INTERSECTION_H
+
+#include "Scene.h"
+#include "Intersection.h"
+
+// widest SIMD batch used, every stream is padded to a multiple of this
+const int SIMD_MAX_WIDTH = 8;
+
+// structure-of-arrays copy of the scene's primitives, so a batch of the same component of several primitives can be loaded at once
+// values are exactly those the scalar tests calculate (e.g. the cylinder axis is p2 - p1), so the batched tests agree with them
+// to within rounding
+struct SceneSoA
+{
+	// spheres: centre and radius squared
+	float* sphereX; float* sphereY; float* sphereZ; float* sphereRadiusSq;
+
+	// planes: point on the plane and normal
+	float* planeX; float* planeY; float* planeZ;
+	float* planeNormalX; float* planeNormalY; float* planeNormalZ;
+
+	// cylinders: first end, axis (p2 - p1), axis length squared and radius squared times axis length squared
+	float* cylinderX; float* cylinderY; float* cylinderZ;
+	float* cylinderAxisX; float* cylinderAxisY; float* cylinderAxisZ;
+	float* cylinderAxisLengthSq; float* cylinderRadiusTerm;
+};
+
+// build the structure-of-arrays copy of the scene (scene.soa)
+void buildSceneSoA(Scene& scene);
+
+// free the structure-of-arrays copy of the scene
+void releaseSceneSoA(Scene& scene);
+
+// instruction sets the intersection tests can use
+enum SimdLevel { SIMD_SCALAR, SIMD_SSE, SIMD_AVX2 };
+
+// tests of one ray against every primitive of a type
+// each SIMD version tests a batch of primitives at once, then confirms any possible hits with the scalar test,
+// so they give exactly the same answers as the scalar loops
+typedef struct SimdIntersectionFunctions
+{
+	// closest collision before *t (t is updated), returning the index of the primitive or -1 if there isn't one
+	int (*closestSphere)(const Scene* scene, const Ray* r, float* t);
+	int (*closestPlane)(const Scene* scene, const Ray* r, float* t);
+	int (*closestCylinder)(const Scene* scene, const Ray* r, float* t, Vector* normal);
+
+	// whether any primitive collides before t (for shadow rays)
+	bool (*anySphereOccluding)(const Scene* scene, const Ray* r, const float t);
+	bool (*anyPlaneOccluding)(const Scene* scene, const Ray* r, const float t);
+	bool (*anyCylinderOccluding)(const Scene* scene, const Ray* r, const float t);
+} SimdIntersectionFunctions;
+
+// versions of the tests currently in use (scalar until selectSimdLevel is called)
+extern SimdIntersectionFunctions simdIntersection;
+
+// use the best instruction set this CPU supports, up to maximum, returning the one chosen
+SimdLevel selectSimdLevel(SimdLevel maximum);
+
+// name of an instruction set (for output)
+const char* simdLevelName(SimdLevel level);
+
+#endif // __SIMD_INTERSECTION_H
@@ -0,0 +1,30 @@
+// AVX2 versions of the batched intersection tests (8 primitives at a time)
+// only this file is compiled for AVX2 (see the project settings), and it's only used once the CPU is known to support it
+
+#if defined(__GNUC__) && !defined(__AVX2__)
+#pragma GCC target("avx2")
+#endif
+
+#include <immintrin.h>
+#include "SimdIntersection.h"
+
+#define SIMD_WIDTH 8
+#define SIMD_NAME(name) name##AVX2
+
+typedef __m256 vfloat;
+
+#define vset1(x) _mm256_set1_ps(x)
+#define vload(p) _mm256_load_ps(p)
+#define vadd(a, b) _mm256_add_ps(a, b)
+#define vsub(a, b) _mm256_sub_ps(a, b)
+#define vmul(a, b) _mm256_mul_ps(a, b)
+#define vdiv(a, b) _mm256_div_ps(a, b)
+#define vsqrt(a) _mm256_sqrt_ps(a)
+#define vmax(a, b) _mm256_max_ps(a, b)
+#define vcmplt(a, b) _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define vcmpgt(a, b) _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define vand(a, b) _mm256_and_ps(a, b)
+#define vor(a, b) _mm256_or_ps(a, b)
+#define vmovemask(a) ((unsigned int)_mm256_movemask_ps(a))
+
+#include "SimdIntersectionImpl.h"
@@ -0,0 +1,263 @@
+// batched intersection tests, written once for any SIMD width
+// included by the file for each instruction set after it defines:
+//   SIMD_WIDTH                     number of floats in a vfloat
+//   vfloat                         vector type
+//   vset1, vload                   broadcast a float / load SIMD_WIDTH floats (aligned)
+//   vadd, vsub, vmul, vdiv, vsqrt, vmax  arithmetic
+//   vcmplt, vcmpgt                 comparisons (all bits set in lanes where true, false for NaN)
+//   vand, vor                      bitwise and/or
+//   vmovemask                      one bit per lane from the comparison masks
+//   SIMD_NAME(name)                name of the function for this instruction set
+
+// lanes of the batch starting at first that hold real primitives (the streams are padded to a multiple of the width)
+static inline unsigned int SIMD_NAME(validLanes)(unsigned int first, unsigned int count)
+{
+	unsigned int remaining = count - first;
+	return remaining >= SIMD_WIDTH ? (1u << SIMD_WIDTH) - 1 : (1u << remaining) - 1;
+}
+
+// how far the batched calculations may be from the scalar ones, relative to the size of the terms they're made from
+// (the compiler is free to fuse multiplies and adds differently in each, e.g. with /arch:AVX2, so they only agree to within rounding,
+// and a lane is only rejected when it misses by more than that, leaving anything closer to the scalar test)
+static const float BATCH_TOLERANCE = 1e-5f;
+
+// |x| in each lane
+static inline vfloat SIMD_NAME(magnitude)(vfloat x)
+{
+	return vmax(x, vsub(vset1(0.0f), x));
+}
+
+// lanes where epsilon < x < t could be true, given x may be out by up to margin (NaN fails every comparison)
+static inline vfloat SIMD_NAME(nearRange)(vfloat x, vfloat margin, vfloat epsilon, vfloat t)
+{
+	return vand(vcmpgt(vadd(x, margin), epsilon), vcmplt(vsub(x, margin), t));
+}
+
+// lanes of a batch of spheres that may collide with the ray before t (a superset of those isSphereIntersected finds)
+static inline unsigned int SIMD_NAME(sphereBatch)(const SceneSoA* soa, unsigned int first, const Ray* r, const float t)
+{
+	vfloat distX = vsub(vload(soa->sphereX + first), vset1(r->start.x));
+	vfloat distY = vsub(vload(soa->sphereY + first), vset1(r->start.y));
+	vfloat distZ = vsub(vload(soa->sphereZ + first), vset1(r->start.z));
+	vfloat radiusSq = vload(soa->sphereRadiusSq + first);
+
+	vfloat B = vadd(vadd(vmul(vset1(r->dir.x), distX), vmul(vset1(r->dir.y), distY)), vmul(vset1(r->dir.z), distZ));
+	vfloat distSq = vadd(vadd(vmul(distX, distX), vmul(distY, distY)), vmul(distZ, distZ));
+	vfloat D = vadd(vsub(vmul(B, B), distSq), radiusSq);
+
+	// rounding error in D is a small part of the terms it's made from (B * B is at most dir * dir times distSq),
+	// and the error in its square root is at most the square root of that
+	vfloat zero = vset1(0.0f);
+	vfloat margin = vmul(vset1(BATCH_TOLERANCE), vadd(vmul(vset1(r->dir * r->dir + 1.0f), distSq), radiusSq));
+
+	// only where the ray (may) hit the sphere at all, which is most often none of the batch
+	unsigned int lanes = vmovemask(vcmpgt(D, vsub(zero, margin)));
+	if (lanes == 0) return 0;
+
+	vfloat tMargin = vsqrt(margin);
+
+	vfloat sqrtD = vsqrt(vmax(D, zero));
+	vfloat t0 = vsub(B, sqrtD);
+	vfloat t1 = vadd(B, sqrtD);
+
+	vfloat epsilon = vset1(EPSILON), tMax = vset1(t);
+	return lanes & vmovemask(vor(SIMD_NAME(nearRange)(t0, tMargin, epsilon, tMax), SIMD_NAME(nearRange)(t1, tMargin, epsilon, tMax)));
+}
+
+// lanes of a batch of planes that may collide with the ray before t (a superset of those isPlaneIntersected finds)
+static inline unsigned int SIMD_NAME(planeBatch)(const SceneSoA* soa, unsigned int first, const Ray* r, const float t)
+{
+	vfloat normalX = vload(soa->planeNormalX + first);
+	vfloat normalY = vload(soa->planeNormalY + first);
+	vfloat normalZ = vload(soa->planeNormalZ + first);
+
+	vfloat angleX = vmul(vset1(r->dir.x), normalX), angleY = vmul(vset1(r->dir.y), normalY), angleZ = vmul(vset1(r->dir.z), normalZ);
+	vfloat angle = vadd(vadd(angleX, angleY), angleZ);
+
+	vfloat distX = vmul(vsub(vload(soa->planeX + first), vset1(r->start.x)), normalX);
+	vfloat distY = vmul(vsub(vload(soa->planeY + first), vset1(r->start.y)), normalY);
+	vfloat distZ = vmul(vsub(vload(soa->planeZ + first), vset1(r->start.z)), normalZ);
+	vfloat t0 = vdiv(vadd(vadd(distX, distY), distZ), angle);
+
+	// rounding error in each dot product is a small part of the sizes of its terms
+	vfloat tolerance = vset1(BATCH_TOLERANCE);
+	vfloat angleError = vmul(tolerance, vadd(vadd(SIMD_NAME(magnitude)(angleX), SIMD_NAME(magnitude)(angleY)), SIMD_NAME(magnitude)(angleZ)));
+	vfloat distError = vmul(tolerance, vadd(vadd(SIMD_NAME(magnitude)(distX), SIMD_NAME(magnitude)(distY)), SIMD_NAME(magnitude)(distZ)));
+
+	// a ray (nearly) parallel to the plane could go either way, so it's left to the scalar test
+	vfloat absAngle = SIMD_NAME(magnitude)(angle);
+	vfloat parallel = vcmpgt(vadd(angleError, angleError), absAngle);
+
+	vfloat tMargin = vdiv(vadd(distError, vmul(SIMD_NAME(magnitude)(t0), angleError)), absAngle);
+	tMargin = vadd(tMargin, tMargin);
+
+	return vmovemask(vor(parallel, SIMD_NAME(nearRange)(t0, tMargin, vset1(EPSILON), vset1(t))));
+}
+
+// lanes of a batch of cylinders that may collide with the ray before t (a superset of those isCylinderIntersected finds)
+static inline unsigned int SIMD_NAME(cylinderBatch)(const SceneSoA* soa, unsigned int first, const Ray* r, const float t)
+{
+	vfloat caX = vload(soa->cylinderAxisX + first);
+	vfloat caY = vload(soa->cylinderAxisY + first);
+	vfloat caZ = vload(soa->cylinderAxisZ + first);
+	vfloat caca = vload(soa->cylinderAxisLengthSq + first);
+	vfloat radiusTerm = vload(soa->cylinderRadiusTerm + first);
+
+	vfloat ocX = vsub(vset1(r->start.x), vload(soa->cylinderX + first));
+	vfloat ocY = vsub(vset1(r->start.y), vload(soa->cylinderY + first));
+	vfloat ocZ = vsub(vset1(r->start.z), vload(soa->cylinderZ + first));
+
+	vfloat dirX = vset1(r->dir.x), dirY = vset1(r->dir.y), dirZ = vset1(r->dir.z);
+	vfloat card = vadd(vadd(vmul(caX, dirX), vmul(caY, dirY)), vmul(caZ, dirZ));
+	vfloat caoc = vadd(vadd(vmul(caX, ocX), vmul(caY, ocY)), vmul(caZ, ocZ));
+	vfloat ocrd = vadd(vadd(vmul(ocX, dirX), vmul(ocY, dirY)), vmul(ocZ, dirZ));
+	vfloat ococ = vadd(vadd(vmul(ocX, ocX), vmul(ocY, ocY)), vmul(ocZ, ocZ));
+
+	vfloat a = vsub(caca, vmul(card, card));
+	vfloat b = vsub(vmul(caca, ocrd), vmul(caoc, card));
+	vfloat c = vsub(vsub(vmul(caca, ococ), vmul(caoc, caoc)), radiusTerm);
+	vfloat hSq = vsub(vmul(b, b), vmul(a, c));
+
+	// rounding error in a, b and c is a small part of the largest their terms can be (from the lengths of the axis, oc and the ray),
+	// and in h is a small part of the largest b * b and a * c can be, then at most the square root of that once h is taken
+	float dirSq = r->dir * r->dir;
+	vfloat tolerance = vset1(BATCH_TOLERANCE), zero = vset1(0.0f);
+	vfloat axisLength = vsqrt(caca), ocLength = vsqrt(ococ), dirLength = vset1(sqrtf(dirSq));
+	vfloat aSize = vmul(caca, vset1(1.0f + dirSq));
+	vfloat bSize = vmul(vmul(caca, ocLength), dirLength);
+	vfloat cSize = vadd(vmul(caca, ococ), radiusTerm);
+	vfloat hSqError = vmul(tolerance, vadd(vmul(bSize, bSize), vmul(aSize, cSize)));
+
+	// only where the ray (may) hit the infinite cylinder at all, which is most often none of the batch
+	unsigned int lanes = vmovemask(vcmpgt(hSq, vsub(zero, hSqError)));
+	if (lanes == 0) return 0;
+
+	vfloat aError = vmul(tolerance, aSize), bError = vmul(tolerance, bSize);
+	vfloat cardError = vmul(tolerance, vmul(axisLength, dirLength));
+	vfloat caocError = vmul(tolerance, vadd(vmul(axisLength, ocLength), caca));
+	vfloat hMargin = vsqrt(hSqError);
+
+	vfloat h = vsqrt(vmax(hSq, zero));
+	vfloat epsilon = vset1(EPSILON), tMax = vset1(t), one = vset1(1.0f);
+
+	// collision with the body (a ray (nearly) parallel to the axis could go either way, so it's left to the scalar test)
+	vfloat absA = SIMD_NAME(magnitude)(a), inverseA = vdiv(one, absA);
+	vfloat tBody = vdiv(vsub(vsub(zero, b), h), a);
+	vfloat tBodyMargin = vmul(vadd(vadd(bError, hMargin), vmul(SIMD_NAME(magnitude)(tBody), aError)), inverseA);
+	tBodyMargin = vadd(tBodyMargin, tBodyMargin);
+
+	vfloat y = vadd(caoc, vmul(tBody, card));
+	vfloat yMargin = vadd(vadd(caocError, vmul(SIMD_NAME(magnitude)(tBody), cardError)), vmul(tBodyMargin, SIMD_NAME(magnitude)(card)));
+
+	vfloat body = vand(vand(vcmpgt(vadd(y, yMargin), zero), vcmplt(vsub(y, yMargin), caca)), SIMD_NAME(nearRange)(tBody, tBodyMargin, epsilon, tMax));
+	vfloat parallel = vcmpgt(vadd(aError, aError), absA);
+	body = vor(body, parallel);
+
+	// collision with the cap at the end y is beyond, within its radius (either end if y is too close to call or the body's
+	// collision could be anywhere, and a ray (nearly) parallel to the caps is left to the scalar test)
+	vfloat absCard = SIMD_NAME(magnitude)(card), inverseCard = vdiv(one, card);
+	vfloat caps = vcmpgt(vadd(cardError, cardError), absCard);
+	vfloat nearEnd[2] = { vor(vcmplt(vsub(y, yMargin), zero), parallel), vor(vcmpgt(vadd(y, yMargin), zero), parallel) };
+	for (int end = 0; end < 2; ++end)
+	{
+		vfloat tCaps = vmul(vsub(end == 0 ? zero : caca, caoc), inverseCard);
+		vfloat tCapsMargin = vmul(vadd(caocError, vmul(SIMD_NAME(magnitude)(tCaps), cardError)), SIMD_NAME(magnitude)(inverseCard));
+		tCapsMargin = vadd(tCapsMargin, tCapsMargin);
+
+		vfloat radial = SIMD_NAME(magnitude)(vadd(b, vmul(a, tCaps)));
+		vfloat radialMargin = vadd(vadd(bError, vmul(SIMD_NAME(magnitude)(tCaps), aError)), vmul(absA, tCapsMargin));
+		vfloat withinRadius = vcmplt(vsub(radial, radialMargin), vadd(h, hMargin));
+
+		caps = vor(caps, vand(vand(nearEnd[end], withinRadius), SIMD_NAME(nearRange)(tCaps, tCapsMargin, epsilon, tMax)));
+	}
+
+	return lanes & vmovemask(vor(body, caps));
+}
+
+int SIMD_NAME(closestSphere)(const Scene* scene, const Ray* r, float* t)
+{
+	int closest = -1;
+	for (unsigned int first = 0; first < scene->numSpheres; first += SIMD_WIDTH)
+	{
+		unsigned int lanes = SIMD_NAME(sphereBatch)(scene->soa, first, r, *t) & SIMD_NAME(validLanes)(first, scene->numSpheres);
+
+		// confirm in order, so the same sphere wins as in the scalar loop
+		for (unsigned int lane = 0; lanes != 0; ++lane, lanes >>= 1)
+		{
+			if ((lanes & 1) && isSphereIntersected(&scene->sphereContainer[first + lane], r, t)) closest = first + lane;
+		}
+	}
+	return closest;
+}
+
+int SIMD_NAME(closestPlane)(const Scene* scene, const Ray* r, float* t)
+{
+	int closest = -1;
+	for (unsigned int first = 0; first < scene->numPlanes; first += SIMD_WIDTH)
+	{
+		unsigned int lanes = SIMD_NAME(planeBatch)(scene->soa, first, r, *t) & SIMD_NAME(validLanes)(first, scene->numPlanes);
+
+		for (unsigned int lane = 0; lanes != 0; ++lane, lanes >>= 1)
+		{
+			if ((lanes & 1) && isPlaneIntersected(&scene->planeContainer[first + lane], r, t)) closest = first + lane;
+		}
+	}
+	return closest;
+}
+
+int SIMD_NAME(closestCylinder)(const Scene* scene, const Ray* r, float* t, Vector* normal)
+{
+	int closest = -1;
+	for (unsigned int first = 0; first < scene->numCylinders; first += SIMD_WIDTH)
+	{
+		unsigned int lanes = SIMD_NAME(cylinderBatch)(scene->soa, first, r, *t) & SIMD_NAME(validLanes)(first, scene->numCylinders);
+
+		for (unsigned int lane = 0; lanes != 0; ++lane, lanes >>= 1)
+		{
+			if ((lanes & 1) && isCylinderIntersected(&scene->cylinderContainer[first + lane], r, t, normal)) closest = first + lane;
+		}
+	}
+	return closest;
+}
+
+bool SIMD_NAME(anySphereOccluding)(const Scene* scene, const Ray* r, const float t)
+{
+	for (unsigned int first = 0; first < scene->numSpheres; first += SIMD_WIDTH)
+	{
+		unsigned int lanes = SIMD_NAME(sphereBatch)(scene->soa, first, r, t) & SIMD_NAME(validLanes)(first, scene->numSpheres);
+
+		for (unsigned int lane = 0; lanes != 0; ++lane, lanes >>= 1)
+		{
+			if ((lanes & 1) && isSphereOccluding(&scene->sphereContainer[first + lane], r, t)) return true;
+		}
+	}
+	return false;
+}
+
+bool SIMD_NAME(anyPlaneOccluding)(const Scene* scene, const Ray* r, const float t)
+{
+	for (unsigned int first = 0; first < scene->numPlanes; first += SIMD_WIDTH)
+	{
+		unsigned int lanes = SIMD_NAME(planeBatch)(scene->soa, first, r, t) & SIMD_NAME(validLanes)(first, scene->numPlanes);
+
+		for (unsigned int lane = 0; lanes != 0; ++lane, lanes >>= 1)
+		{
+			if ((lanes & 1) && isPlaneOccluding(&scene->planeContainer[first + lane], r, t)) return true;
+		}
+	}
+	return false;
+}
+
+bool SIMD_NAME(anyCylinderOccluding)(const Scene* scene, const Ray* r, const float t)
+{
+	for (unsigned int first = 0; first < scene->numCylinders; first += SIMD_WIDTH)
+	{
+		unsigned int lanes = SIMD_NAME(cylinderBatch)(scene->soa, first, r, t) & SIMD_NAME(validLanes)(first, scene->numCylinders);
+
+		for (unsigned int lane = 0; lanes != 0; ++lane, lanes >>= 1)
+		{
+			if ((lanes & 1) && isCylinderOccluding(&scene->cylinderContainer[first + lane], r, t)) return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,26 @@
+// SSE versions of the batched intersection tests (4 primitives at a time)
+// SSE2 is part of x64, so these can always be used
+
+#include <emmintrin.h>
+#include "SimdIntersection.h"
+
+#define SIMD_WIDTH 4
+#define SIMD_NAME(name) name##SSE
+
+typedef __m128 vfloat;
+
+#define vset1(x) _mm_set1_ps(x)
+#define vload(p) _mm_load_ps(p)
+#define vadd(a, b) _mm_add_ps(a, b)
+#define vsub(a, b) _mm_sub_ps(a, b)
+#define vmul(a, b) _mm_mul_ps(a, b)
+#define vdiv(a, b) _mm_div_ps(a, b)
+#define vsqrt(a) _mm_sqrt_ps(a)
+#define vmax(a, b) _mm_max_ps(a, b)
+#define vcmplt(a, b) _mm_cmplt_ps(a, b)
+#define vcmpgt(a, b) _mm_cmpgt_ps(a, b)
+#define vand(a, b) _mm_and_ps(a, b)
+#define vor(a, b) _mm_or_ps(a, b)
+#define vmovemask(a) ((unsigned int)_mm_movemask_ps(a))
+
+#include "SimdIntersectionImpl.h"
@@ -0,0 +1,100 @@
+#include <thread>
+#include <mutex>
+#include <vector>
+#include "TileScheduler.h"
+
+// tiles still to be rendered by one worker
+struct WorkerQueue
+{
+	std::mutex lock;
+	int begin, end;			// range of tiles left, the owner takes from the front and thieves from the back
+	char padding[64];		// keeps the next queue off this cache line
+};
+
+void mortonTileOrder(int tilesX, int tilesY, int* order)
+{
+	// walk the curve over the smallest power of two square covering the tiles, skipping the positions outside the image
+	unsigned int size = 1;
+	while (size < (unsigned int)tilesX || size < (unsigned int)tilesY) size *= 2;
+
+	int count = 0;
+	for (unsigned int code = 0; code < size * size; ++code)
+	{
+		unsigned int x = 0, y = 0;
+		for (unsigned int bit = 0; (1u << bit) < size; ++bit)
+		{
+			x |= ((code >> (2 * bit)) & 1) << bit;
+			y |= ((code >> (2 * bit + 1)) & 1) << bit;
+		}
+
+		if (x < (unsigned int)tilesX && y < (unsigned int)tilesY) order[count++] = y * tilesX + x;
+	}
+}
+
+// take the next tile from this worker's own range, stealing half of another worker's range when that runs out
+static int nextTile(WorkerQueue* queues, int numThreads, int thread)
+{
+	WorkerQueue& own = queues[thread];
+	{
+		std::lock_guard<std::mutex> guard(own.lock);
+		if (own.begin < own.end) return own.begin++;
+	}
+
+	for (int i = 1; i < numThreads; ++i)
+	{
+		WorkerQueue& victim = queues[(thread + i) % numThreads];
+		int stolenBegin, stolenEnd;
+		{
+			std::lock_guard<std::mutex> guard(victim.lock);
+			int remaining = victim.end - victim.begin;
+			if (remaining <= 0) continue;
+
+			// take the back half (rounded up, so a last single tile can be stolen too)
+			stolenEnd = victim.end;
+			stolenBegin = victim.end - (remaining + 1) / 2;
+			victim.end = stolenBegin;
+		}
+
+		std::lock_guard<std::mutex> guard(own.lock);
+		own.begin = stolenBegin + 1;
+		own.end = stolenEnd;
+		return stolenBegin;
+	}
+
+	// nothing left anywhere (tiles still being rendered by other workers will be finished by them)
+	return -1;
+}
+
+static void worker(WorkerQueue* queues, int numThreads, int thread, TileFunction renderTile, void* context)
+{
+	for (int tile = nextTile(queues, numThreads, thread); tile >= 0; tile = nextTile(queues, numThreads, thread))
+	{
+		renderTile(tile, thread, context);
+	}
+}
+
+void runTilesWorkStealing(int numTiles, int numThreads, TileFunction renderTile, void* context)
+{
+	if (numThreads < 1) numThreads = 1;
+
+	// deal the tiles out in contiguous shares, so each worker starts on its own area of the image
+	std::vector<WorkerQueue> queues(numThreads);
+	for (int i = 0; i < numThreads; ++i)
+	{
+		queues[i].begin = (int)((long long)numTiles * i / numThreads);
+		queues[i].end = (int)((long long)numTiles * (i + 1) / numThreads);
+	}
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numThreads; ++i)
+	{
+		threads.push_back(std::thread(worker, queues.data(), numThreads, i, renderTile, context));
+	}
+
+	worker(queues.data(), numThreads, 0, renderTile, context);
+
+	for (size_t i = 0; i < threads.size(); ++i)
+	{
+		threads[i].join();
+	}
+}
@@ -0,0 +1,15 @@
+#ifndef __TILE_SCHEDULER_H
+#define __TILE_SCHEDULER_H
+
+// called for each tile, with the index of the worker thread rendering it (so per-thread data can be used without locking)
+typedef void (*TileFunction)(int tile, int thread, void* context);
+
+// order tiles along a Z-order (Morton) curve so consecutive tiles are close together in the image
+// order[i] is the row-major index (tileY * tilesX + tileX) of the i-th tile to render
+void mortonTileOrder(int tilesX, int tilesY, int* order);
+
+// run renderTile on every tile 0..numTiles-1 using numThreads worker threads (the calling thread is one of them)
+// each worker starts with a contiguous share of the tiles and, once it runs out, steals half of what's left of another worker's share
+void runTilesWorkStealing(int numTiles, int numThreads, TileFunction renderTile, void* context);
+
+#endif // __TILE_SCHEDULER_H
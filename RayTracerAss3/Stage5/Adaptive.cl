@@ -0,0 +1,62 @@
+﻿// adaptive anti-aliasing (selected with -adaptive)
+// adaptiveBase renders every pixel with a cheap grid of samples, then adaptiveRefine renders the full grid
+// only for the pixels whose neighbourhood in the cheap image has more contrast than the threshold
+
+// render every pixel of the image with a baseLevel x baseLevel grid of samples
+__kernel void adaptiveBase(WAVEFRONT_SCENE_PARAMS, int width, int height, int baseLevel, __global int* base)
+{
+	Scene scene = bindScene(WAVEFRONT_SCENE_ARGS);
+
+	int ix = get_global_id(0);
+	int iy = get_global_id(1);
+
+	base[iy * width + ix] = convertToPixel(renderSamples(&scene, ix - (width / 2), iy - (height / 2), width, baseLevel), scene.exposure);
+}
+
+// largest difference of any channel between the pixels of the 3x3 neighbourhood around x, y (the same as neighbourhoodContrast on the host)
+int neighbourhoodContrast(__global const int* image, int width, int height, int x, int y)
+{
+	// neighbourhood is cut short at the edges of the image
+	int top = max(y - 1, 0), bottom = min(y + 1, height - 1);
+	int left = max(x - 1, 0), right = min(x + 1, width - 1);
+
+	uchar4 lowest = (uchar4)(255, 255, 255, 255), highest = (uchar4)(0, 0, 0, 0);
+	for (int ny = top; ny <= bottom; ++ny)
+	{
+		for (int nx = left; nx <= right; ++nx)
+		{
+			uchar4 pixel = as_uchar4(image[ny * width + nx]);
+			lowest = min(lowest, pixel);
+			highest = max(highest, pixel);
+		}
+	}
+
+	uchar4 contrast = highest - lowest;
+	return max(max(contrast.x, contrast.y), contrast.z);
+}
+
+// render the full grid of samples for the tile's pixels with more than threshold contrast around them in the cheap image, and copy the rest from it
+// refinedPixels counts the pixels rendered
+__kernel void adaptiveRefine(WAVEFRONT_SCENE_PARAMS, int width, int height, int aaLevel, int threshold,
+	__global const int* base, __global int* out, __global int* refinedPixels)
+{
+	Scene scene = bindScene(WAVEFRONT_SCENE_ARGS);
+
+#ifdef AA_LEVEL
+	aaLevel = AA_LEVEL;
+#endif
+
+	// tiles are launched with a global offset, like func
+	int ix = get_global_id(0);
+	int iy = get_global_id(1);
+	int pixel = iy * width + ix;
+
+	if (neighbourhoodContrast(base, width, height, ix, iy) <= threshold)
+	{
+		out[pixel] = base[pixel];
+		return;
+	}
+
+	out[pixel] = convertToPixel(renderSamples(&scene, ix - (width / 2), iy - (height / 2), width, aaLevel), scene.exposure);
+	atomic_inc(refinedPixels);
+}
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "Adaptive.h"
+#include "ImageIO.h"
+
+int adaptiveBaseLevel(int aaLevel)
+{
+	return aaLevel >= 4 ? 2 : 1;
+}
+
+int neighbourhoodContrast(const unsigned int* image, int width, int height, int x, int y)
+{
+	int contrast = 0;
+
+	// neighbourhood is cut short at the edges of the image
+	int top = y > 0 ? y - 1 : y, bottom = y < height - 1 ? y + 1 : y;
+	int left = x > 0 ? x - 1 : x, right = x < width - 1 ? x + 1 : x;
+
+	for (int shift = 0; shift < 24; shift += 8)
+	{
+		int lowest = 255, highest = 0;
+		for (int ny = top; ny <= bottom; ++ny)
+		{
+			for (int nx = left; nx <= right; ++nx)
+			{
+				int channel = (image[ny * width + nx] >> shift) & 0xFF;
+				if (channel < lowest) lowest = channel;
+				if (channel > highest) highest = channel;
+			}
+		}
+
+		if (highest - lowest > contrast) contrast = highest - lowest;
+	}
+
+	return contrast;
+}
+
+void printSamplesSaved(unsigned long long samplesRendered, unsigned int refinedPixels, int width, int height, int aaLevel)
+{
+	unsigned long long uniformSamples = (unsigned long long)width * height * aaLevel * aaLevel;
+	long long saved = (long long)uniformSamples - (long long)samplesRendered;
+
+	printf("adaptive sampling: %u of %d pixels refined (%.2f%%), %llu samples against %llu uniform, %lld saved (%.2f%%)\n",
+		refinedPixels, width * height, 100.0 * refinedPixels / (width * height),
+		samplesRendered, uniformSamples, saved, 100.0 * saved / uniformSamples);
+}
+
+bool printReferenceError(const unsigned int* image, int width, int height, const char* referenceFilename)
+{
+	unsigned int* reference = NULL;
+	int referenceWidth, referenceHeight;
+	if (!read_bmp(referenceFilename, reference, referenceWidth, referenceHeight)) return false;
+
+	if (referenceWidth != width || referenceHeight != height)
+	{
+		printf("reference %s is %dx%d, not %dx%d\n", referenceFilename, referenceWidth, referenceHeight, width, height);
+		delete[] reference;
+		return false;
+	}
+
+	unsigned long long sumAbsolute = 0;
+	for (int i = 0; i < width * height; ++i)
+	{
+		for (int shift = 0; shift < 24; shift += 8)
+		{
+			sumAbsolute += abs((int)((image[i] >> shift) & 0xFF) - (int)((reference[i] >> shift) & 0xFF));
+		}
+	}
+	delete[] reference;
+
+	printf("mae against %s: %.4f\n", referenceFilename, sumAbsolute / (3.0 * width * height));
+	return true;
+}
+
+// create a kernel from the program, exiting if it can't be found
+static cl_kernel createKernel(cl_program program, const char* name)
+{
+	cl_int err;
+	cl_kernel kernel = clCreateKernel(program, name, &err);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't create the %s kernel = %d\n", name, err);
+		exit(1);
+	}
+
+	return kernel;
+}
+
+// set a kernel argument, exiting if it can't be set
+static void setArg(cl_kernel kernel, cl_uint index, size_t size, const void* value)
+{
+	cl_int err = clSetKernelArg(kernel, index, size, value);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't set the adaptive kernel(%d) argument = %d\n", index, err);
+		exit(1);
+	}
+}
+
+void createAdaptive(Adaptive& adaptive, cl_context context, cl_program program, const cl_mem sceneBuffers[NUM_SCENE_BUFFERS], cl_mem outBuffer,
+	int width, int height, int aaLevel, int contrastThreshold)
+{
+	cl_int err;
+	int baseLevel = adaptiveBaseLevel(aaLevel);
+
+	adaptive.width = width;
+	adaptive.height = height;
+
+	adaptive.baseKernel = createKernel(program, "adaptiveBase");
+	adaptive.refineKernel = createKernel(program, "adaptiveRefine");
+
+	adaptive.baseBuffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(int) * width * height, NULL, &err);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't create the adaptive base buffer -> %d\n", err);
+		exit(1);
+	}
+	adaptive.refinedBuffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(int), NULL, &err);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't create the adaptive refined buffer -> %d\n", err);
+		exit(1);
+	}
+
+	for (int i = 0; i < NUM_SCENE_BUFFERS; ++i)
+	{
+		setArg(adaptive.baseKernel, i, sizeof(cl_mem), &sceneBuffers[i]);
+		setArg(adaptive.refineKernel, i, sizeof(cl_mem), &sceneBuffers[i]);
+	}
+
+	setArg(adaptive.baseKernel, NUM_SCENE_BUFFERS + 0, sizeof(int), &width);
+	setArg(adaptive.baseKernel, NUM_SCENE_BUFFERS + 1, sizeof(int), &height);
+	setArg(adaptive.baseKernel, NUM_SCENE_BUFFERS + 2, sizeof(int), &baseLevel);
+	setArg(adaptive.baseKernel, NUM_SCENE_BUFFERS + 3, sizeof(cl_mem), &adaptive.baseBuffer);
+
+	setArg(adaptive.refineKernel, NUM_SCENE_BUFFERS + 0, sizeof(int), &width);
+	setArg(adaptive.refineKernel, NUM_SCENE_BUFFERS + 1, sizeof(int), &height);
+	setArg(adaptive.refineKernel, NUM_SCENE_BUFFERS + 2, sizeof(int), &aaLevel);
+	setArg(adaptive.refineKernel, NUM_SCENE_BUFFERS + 3, sizeof(int), &contrastThreshold);
+	setArg(adaptive.refineKernel, NUM_SCENE_BUFFERS + 4, sizeof(cl_mem), &adaptive.baseBuffer);
+	setArg(adaptive.refineKernel, NUM_SCENE_BUFFERS + 5, sizeof(cl_mem), &outBuffer);
+	setArg(adaptive.refineKernel, NUM_SCENE_BUFFERS + 6, sizeof(cl_mem), &adaptive.refinedBuffer);
+}
+
+void renderBaseAdaptive(Adaptive& adaptive, cl_command_queue queue, cl_event* finished)
+{
+	// the cheap pass is a fraction of the cost of a tile of the full grid, so the whole image is one launch
+	static const int zero = 0;
+	clEnqueueWriteBuffer(queue, adaptive.refinedBuffer, CL_FALSE, 0, sizeof(int), &zero, 0, NULL, NULL);
+
+	size_t size[] = { (size_t)adaptive.width, (size_t)adaptive.height };
+	cl_int err = clEnqueueNDRangeKernel(queue, adaptive.baseKernel, 2, NULL, size, NULL, 0, NULL, finished);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't enqueue the adaptive base kernel execution command = %d\n", err);
+		exit(1);
+	}
+}
+
+void refineTileAdaptive(Adaptive& adaptive, cl_command_queue queue, const size_t tileOffset[2], const size_t tileSize[2], cl_event* finished)
+{
+	cl_int err = clEnqueueNDRangeKernel(queue, adaptive.refineKernel, 2, tileOffset, tileSize, NULL, 0, NULL, finished);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't enqueue the adaptive refine kernel execution command = %d\n", err);
+		exit(1);
+	}
+}
+
+unsigned int getRefinedPixels(Adaptive& adaptive, cl_command_queue queue)
+{
+	unsigned int refinedPixels = 0;
+	cl_int err = clEnqueueReadBuffer(queue, adaptive.refinedBuffer, CL_TRUE, 0, sizeof(refinedPixels), &refinedPixels, 0, NULL, NULL);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't read the adaptive refined count = %d\n", err);
+		exit(1);
+	}
+
+	return refinedPixels;
+}
+
+void releaseAdaptive(Adaptive& adaptive)
+{
+	clReleaseKernel(adaptive.baseKernel);
+	clReleaseKernel(adaptive.refineKernel);
+
+	clReleaseMemObject(adaptive.baseBuffer);
+	clReleaseMemObject(adaptive.refinedBuffer);
+}
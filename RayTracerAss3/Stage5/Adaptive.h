@@ -0,0 +1,50 @@
+#ifndef __ADAPTIVE_H
+#define __ADAPTIVE_H
+
+#include "LoadCL.h"
+#include "Wavefront.h"
+
+// adaptive anti-aliasing renders every pixel with a cheap grid of samples first,
+// then renders the full grid again only for pixels whose neighbourhood in the cheap image has enough contrast
+
+// samples along each axis of the cheap pass (2x2 for grids of 4x4 and up, otherwise a single sample)
+int adaptiveBaseLevel(int aaLevel);
+
+// largest difference (in 0-255 levels) of any channel between the pixels of the 3x3 neighbourhood around x, y
+int neighbourhoodContrast(const unsigned int* image, int width, int height, int x, int y);
+
+// print how many samples were rendered against a uniform render of the same size and grid
+void printSamplesSaved(unsigned long long samplesRendered, unsigned int refinedPixels, int width, int height, int aaLevel);
+
+// print the mean absolute error (over the colour channels, in 0-255 levels) against a reference image, returning false if it can't be compared
+bool printReferenceError(const unsigned int* image, int width, int height, const char* referenceFilename);
+
+// kernels and buffers of the device's adaptive renderer
+typedef struct Adaptive
+{
+	cl_kernel baseKernel;
+	cl_kernel refineKernel;
+
+	cl_mem baseBuffer;			// the cheap image
+	cl_mem refinedBuffer;		// count of pixels refined
+
+	int width, height;
+} Adaptive;
+
+// create the adaptive kernels (from the already built program) and the cheap image, refined tiles are written to outBuffer
+void createAdaptive(Adaptive& adaptive, cl_context context, cl_program program, const cl_mem sceneBuffers[NUM_SCENE_BUFFERS], cl_mem outBuffer,
+	int width, int height, int aaLevel, int contrastThreshold);
+
+// render the cheap image (every tile refined after it waits for it, as the queue is in order), finished is set to the kernel's event if it isn't NULL
+void renderBaseAdaptive(Adaptive& adaptive, cl_command_queue queue, cl_event* finished);
+
+// refine a tile of the image into the output buffer, finished is set to the kernel's event
+void refineTileAdaptive(Adaptive& adaptive, cl_command_queue queue, const size_t tileOffset[2], const size_t tileSize[2], cl_event* finished);
+
+// number of pixels refined since the cheap image was last rendered (waits for the queue to finish)
+unsigned int getRefinedPixels(Adaptive& adaptive, cl_command_queue queue);
+
+// release the adaptive kernels and buffers
+void releaseAdaptive(Adaptive& adaptive);
+
+#endif // __ADAPTIVE_H
@@ -0,0 +1,142 @@
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Animation.h"
+#include "Constants.h"
+#include "ImageIO.h"
+#include "SceneReader.h"
+
+// what's been read of the keyframe file so far
+typedef struct KeyframeParser
+{
+	std::vector<Keyframe>* keyframes;
+	Keyframe keyframe;				// the keyframe being read (starting as the one before it, so anything it leaves out is kept)
+	std::string name;				// its section's name
+} KeyframeParser;
+
+static bool beginKeyframe(const std::string& name, int line, void* context)
+{
+	KeyframeParser& parser = *(KeyframeParser*)context;
+	std::string expected = "Keyframe" + std::to_string(parser.keyframes->size());
+	if (name != expected)
+	{
+		fprintf(stderr, "Malformed keyframe file: found %s where %s was expected (line %d).\n", name.c_str(), expected.c_str(), line);
+		return false;
+	}
+
+	// the frame has to be given, the camera is kept from the last keyframe for anything that isn't
+	parser.name = name;
+	parser.keyframe.frame = -1;
+	return true;
+}
+
+static bool setKeyframeVariable(const std::string& name, const std::string& value, int line, void* context)
+{
+	KeyframeParser& parser = *(KeyframeParser*)context;
+	Keyframe& keyframe = parser.keyframe;
+	const char* v = value.c_str();
+	bool valid = true;
+	if (name == "Frame") keyframe.frame = atoi(v);
+	else if (name == "Camera.Position") valid = parseTriple(v, &keyframe.cameraPosition.x, &keyframe.cameraPosition.y, &keyframe.cameraPosition.z);
+	else if (name == "Camera.Rotation") keyframe.cameraRotation = float(atof(v));
+	else if (name == "Camera.FieldOfView") keyframe.cameraFieldOfView = float(atof(v));
+	else valid = false;
+
+	if (!valid) fprintf(stderr, "Malformed keyframe file: %s.%s isn't a keyframe variable or has the wrong value (line %d).\n", parser.name.c_str(), name.c_str(), line);
+	return valid;
+}
+
+static bool endKeyframe(void* context)
+{
+	KeyframeParser& parser = *(KeyframeParser*)context;
+	std::vector<Keyframe>& keyframes = *parser.keyframes;
+	const Keyframe& keyframe = parser.keyframe;
+	if (keyframe.frame < 0 || (!keyframes.empty() && keyframe.frame <= keyframes.back().frame))
+	{
+		fprintf(stderr, "Malformed keyframe file: %s needs a Frame after the keyframe before it.\n", parser.name.c_str());
+		return false;
+	}
+	if (keyframe.cameraFieldOfView <= 0.0f || keyframe.cameraFieldOfView >= 189.0f)
+	{
+		fprintf(stderr, "Malformed keyframe file: Out of range FOV in %s.\n", parser.name.c_str());
+		return false;
+	}
+
+	keyframes.push_back(keyframe);
+	return true;
+}
+
+bool readKeyframes(const char* filename, const Scene& scene, std::vector<Keyframe>& keyframes)
+{
+	// the first keyframe starts from the scene's camera
+	KeyframeParser parser;
+	parser.keyframes = &keyframes;
+	parser.keyframe.frame = 0;
+	parser.keyframe.cameraPosition = scene.cameraPosition;
+	parser.keyframe.cameraRotation = -scene.cameraRotation / PIOVER180;
+	parser.keyframe.cameraFieldOfView = scene.cameraFieldOfView;
+
+	SectionHandler handler = { beginKeyframe, setKeyframeVariable, endKeyframe, &parser };
+	if (!readSections(filename, "keyframe", handler)) return false;
+
+	if (keyframes.empty())
+	{
+		fprintf(stderr, "Malformed keyframe file: No Keyframe0 section.\n");
+		return false;
+	}
+	return true;
+}
+
+static float lerp(float a, float b, float t)
+{
+	return a + (b - a) * t;
+}
+
+void setFrameCamera(const std::vector<Keyframe>& keyframes, int frame, Scene& scene)
+{
+	// the keyframes either side of the frame (both the first or last one when it's outside them)
+	size_t next = 0;
+	while (next < keyframes.size() && keyframes[next].frame <= frame) ++next;
+	const Keyframe& a = keyframes[next == 0 ? 0 : next - 1];
+	const Keyframe& b = keyframes[next == keyframes.size() ? keyframes.size() - 1 : next];
+
+	float t = b.frame == a.frame ? 0.0f : float(frame - a.frame) / float(b.frame - a.frame);
+	scene.cameraPosition.x = lerp(a.cameraPosition.x, b.cameraPosition.x, t);
+	scene.cameraPosition.y = lerp(a.cameraPosition.y, b.cameraPosition.y, t);
+	scene.cameraPosition.z = lerp(a.cameraPosition.z, b.cameraPosition.z, t);
+	scene.cameraRotation = -lerp(a.cameraRotation, b.cameraRotation, t) * PIOVER180;
+	scene.cameraFieldOfView = lerp(a.cameraFieldOfView, b.cameraFieldOfView, t);
+}
+
+std::string frameFilename(const char* outputFilename, int frame)
+{
+	std::string name(outputFilename);
+	size_t dot = name.find_last_of('.');
+	size_t slash = name.find_last_of("\\/");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) dot = name.size();
+
+	char number[32];
+	sprintf(number, "_%04d", frame);
+	return name.substr(0, dot) + number + name.substr(dot);
+}
+
+static void writeFrameImage(std::string filename, const unsigned int* image, int width, int height)
+{
+	write_bmp(filename.c_str(), (unsigned int*)image, width, height, width);
+}
+
+void writeFrame(FrameWriter& writer, const std::string& filename, const unsigned int* image, int width, int height)
+{
+	finishFrameWriter(writer);
+	writer.thread = std::thread(writeFrameImage, filename, image, width, height);
+}
+
+void finishFrameWriter(FrameWriter& writer)
+{
+	if (writer.thread.joinable()) writer.thread.join();
+}
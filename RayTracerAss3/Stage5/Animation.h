@@ -0,0 +1,50 @@
+#ifndef __ANIMATION_H
+#define __ANIMATION_H
+
+#include <string>
+#include <thread>
+#include <vector>
+#include "Scene.h"
+
+// the camera at a frame of the animation, given the same way as in a scene file (the rotation in degrees)
+typedef struct Keyframe
+{
+	int frame;
+	Point cameraPosition;
+	float cameraRotation;
+	float cameraFieldOfView;
+} Keyframe;
+
+// read the keyframes of a camera path, which is written like a scene file
+//   Keyframe0
+//   {
+//       Frame = 0;
+//       Camera.Position = 0.0, 0.0, -200.0;
+//       Camera.Rotation = 0.0;
+//       Camera.FieldOfView = 90.0;
+//   }
+// with a section for each keyframe (Keyframe0, Keyframe1, ... in frame order), where anything a keyframe leaves out
+// is kept from the one before it (or the scene's own camera for the first)
+bool readKeyframes(const char* filename, const Scene& scene, std::vector<Keyframe>& keyframes);
+
+// set the scene's camera for a frame, moving in a straight line between the keyframes either side of it
+// (frames before the first keyframe or after the last one hold its camera)
+void setFrameCamera(const std::vector<Keyframe>& keyframes, int frame, Scene& scene);
+
+// filename of a frame: the output filename with the frame number before its extension (Outputs/fly.bmp -> Outputs/fly_0007.bmp)
+std::string frameFilename(const char* outputFilename, int frame);
+
+// writes each frame's image on a thread of its own while the next frame renders
+// (one write at a time, so the image handed to it can be rendered into again once the next write has started)
+typedef struct FrameWriter
+{
+	std::thread thread;				// the write in progress (if any)
+} FrameWriter;
+
+// wait for the last frame's write to finish, then start writing image to filename (image has to stay untouched until the next call)
+void writeFrame(FrameWriter& writer, const std::string& filename, const unsigned int* image, int width, int height);
+
+// wait for the last frame's write to finish
+void finishFrameWriter(FrameWriter& writer);
+
+#endif // __ANIMATION_H
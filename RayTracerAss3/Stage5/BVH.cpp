@@ -0,0 +1,312 @@
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
+#include "BVH.h"
+
+// number of buckets centroids are sorted into when looking for the best split
+static const int BVH_NUM_BINS = 16;
+
+// nodes with this many primitives (or less) become leaves when splitting them isn't worth it
+static const unsigned int BVH_MAX_LEAF_SIZE = 4;
+
+// relative cost of visiting a node compared to intersecting a primitive
+static const float BVH_TRAVERSAL_COST = 1.0f;
+static const float BVH_INTERSECTION_COST = 1.0f;
+
+// amount (relative to the size of the coordinates) the primitive bounds are grown by, so that
+// rounding in the intersection functions never puts a hit outside of its node's box
+static const float BVH_BOUNDS_PADDING = 1e-4f;
+
+// axis aligned box used while building the hierarchy
+typedef struct Bounds
+{
+	float min[3], max[3];
+} Bounds;
+
+// per primitive information used while building the hierarchy
+typedef struct BuildPrimitive
+{
+	Bounds bounds;
+	float centroid[3];
+	unsigned int reference;
+} BuildPrimitive;
+
+
+// create an inside out box, so that growing it by anything gives that thing's bounds
+static Bounds emptyBounds()
+{
+	Bounds b = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+	return b;
+}
+
+// grow the box to contain another box
+static void growBounds(Bounds& b, const Bounds& other)
+{
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		b.min[axis] = std::min(b.min[axis], other.min[axis]);
+		b.max[axis] = std::max(b.max[axis], other.max[axis]);
+	}
+}
+
+// grow the box to contain a point
+static void growBounds(Bounds& b, const float p[3])
+{
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		b.min[axis] = std::min(b.min[axis], p[axis]);
+		b.max[axis] = std::max(b.max[axis], p[axis]);
+	}
+}
+
+// surface area of the box (zero for empty boxes)
+static float surfaceArea(const Bounds& b)
+{
+	float dx = b.max[0] - b.min[0], dy = b.max[1] - b.min[1], dz = b.max[2] - b.min[2];
+
+	if (dx < 0.0f || dy < 0.0f || dz < 0.0f) return 0.0f;
+
+	return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+// pad the box to allow for rounding in the intersection functions
+static void padBounds(Bounds& b)
+{
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float pad = BVH_BOUNDS_PADDING * (1.0f + std::max(fabsf(b.min[axis]), fabsf(b.max[axis])));
+		b.min[axis] -= pad;
+		b.max[axis] += pad;
+	}
+}
+
+// bounds of a sphere
+static Bounds sphereBounds(const Sphere& s)
+{
+	float radius = fabsf(s.size);
+	Bounds b = { { s.pos.x - radius, s.pos.y - radius, s.pos.z - radius }, { s.pos.x + radius, s.pos.y + radius, s.pos.z + radius } };
+
+	padBounds(b);
+	return b;
+}
+
+// bounds of a (capped) cylinder, i.e. the bounds of the two end discs
+// see: https://iquilezles.org/articles/diskbbox/
+static Bounds cylinderBounds(const Cylinder& c)
+{
+	Vector ca = c.p2 - c.p1;
+	float caca = ca.dot();
+	float radius = fabsf(c.size);
+	float axis[3] = { ca.x, ca.y, ca.z };
+	float p1[3] = { c.p1.x, c.p1.y, c.p1.z };
+	float p2[3] = { c.p2.x, c.p2.y, c.p2.z };
+
+	Bounds b;
+	for (int i = 0; i < 3; ++i)
+	{
+		// extent of the end discs along this axis
+		float extent = caca > 0.0f ? radius * sqrtf(std::max(0.0f, 1.0f - axis[i] * axis[i] / caca)) : radius;
+
+		b.min[i] = std::min(p1[i], p2[i]) - extent;
+		b.max[i] = std::max(p1[i], p2[i]) + extent;
+	}
+
+	padBounds(b);
+	return b;
+}
+
+// recursively build the node (and its children) containing the given range of primitives
+static void buildNode(std::vector<BVHNode>& nodes, std::vector<BuildPrimitive>& prims, unsigned int nodeIndex, unsigned int first, unsigned int count, int depth)
+{
+	// bounds of the primitives, and of their centroids (which are used to choose splits)
+	Bounds bounds = emptyBounds(), centroidBounds = emptyBounds();
+	for (unsigned int i = first; i < first + count; ++i)
+	{
+		growBounds(bounds, prims[i].bounds);
+		growBounds(centroidBounds, prims[i].centroid);
+	}
+
+	BVHNode& node = nodes[nodeIndex];
+	node.boundsMin.x = bounds.min[0]; node.boundsMin.y = bounds.min[1]; node.boundsMin.z = bounds.min[2]; node.boundsMin.empty = 0.0f;
+	node.boundsMax.x = bounds.max[0]; node.boundsMax.y = bounds.max[1]; node.boundsMax.z = bounds.max[2]; node.boundsMax.empty = 0.0f;
+	node.leftFirst = first;
+	node.primCount = count;
+
+	// can't (or shouldn't) go any further
+	if (count <= 1 || depth >= BVH_MAX_DEPTH - 1) return;
+
+	// find the cheapest split according to the surface area heuristic, testing bin boundaries along each axis
+	float bestCost = FLT_MAX;
+	int bestAxis = -1, bestSplit = -1;
+	float parentArea = surfaceArea(bounds);
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+		if (extent <= 0.0f) continue;
+
+		Bounds binBounds[BVH_NUM_BINS];
+		unsigned int binCount[BVH_NUM_BINS] = { 0 };
+		for (int b = 0; b < BVH_NUM_BINS; ++b) binBounds[b] = emptyBounds();
+
+		float scale = BVH_NUM_BINS / extent;
+		for (unsigned int i = first; i < first + count; ++i)
+		{
+			int b = std::min(BVH_NUM_BINS - 1, int((prims[i].centroid[axis] - centroidBounds.min[axis]) * scale));
+			binCount[b]++;
+			growBounds(binBounds[b], prims[i].bounds);
+		}
+
+		// sweep from the right to get the area and count of everything right of each split
+		float rightArea[BVH_NUM_BINS];
+		unsigned int rightCount[BVH_NUM_BINS];
+		Bounds sweep = emptyBounds();
+		unsigned int sweepCount = 0;
+		for (int b = BVH_NUM_BINS - 1; b > 0; --b)
+		{
+			growBounds(sweep, binBounds[b]);
+			sweepCount += binCount[b];
+			rightArea[b] = surfaceArea(sweep);
+			rightCount[b] = sweepCount;
+		}
+
+		// then sweep from the left, evaluating each split as we go
+		sweep = emptyBounds();
+		sweepCount = 0;
+		for (int b = 1; b < BVH_NUM_BINS; ++b)
+		{
+			growBounds(sweep, binBounds[b - 1]);
+			sweepCount += binCount[b - 1];
+
+			if (sweepCount == 0 || rightCount[b] == 0) continue;
+
+			float cost = BVH_TRAVERSAL_COST + BVH_INTERSECTION_COST * (surfaceArea(sweep) * sweepCount + rightArea[b] * rightCount[b]) / parentArea;
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b;
+			}
+		}
+	}
+
+	unsigned int mid;
+	if (bestAxis == -1)
+	{
+		// all the centroids are in the same place, so just halve the list if it's too big for a leaf
+		if (count <= BVH_MAX_LEAF_SIZE) return;
+		mid = first + count / 2;
+	}
+	else
+	{
+		// stop if intersecting everything here is cheaper than splitting
+		if (bestCost >= BVH_INTERSECTION_COST * count && count <= BVH_MAX_LEAF_SIZE) return;
+
+		float scale = BVH_NUM_BINS / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+		float minCentroid = centroidBounds.min[bestAxis];
+		BuildPrimitive* middle = std::partition(&prims[first], &prims[first] + count, [=](const BuildPrimitive& p)
+		{
+			return std::min(BVH_NUM_BINS - 1, int((p.centroid[bestAxis] - minCentroid) * scale)) < bestSplit;
+		});
+		mid = (unsigned int)(middle - &prims[0]);
+	}
+
+	// children are always allocated next to each other, so only the left one's index needs storing
+	// (note: this invalidates the node reference above)
+	unsigned int leftIndex = (unsigned int)nodes.size();
+	nodes.resize(nodes.size() + 2);
+	nodes[nodeIndex].leftFirst = leftIndex;
+	nodes[nodeIndex].primCount = 0;
+
+	buildNode(nodes, prims, leftIndex, first, mid - first, depth + 1);
+	buildNode(nodes, prims, leftIndex + 1, mid, first + count - mid, depth + 1);
+}
+
+// build a surface area heuristic BVH over the scene's spheres and cylinders
+// planes are infinite, so they are left out of the hierarchy and tested separately
+void buildBVH(Scene& scene)
+{
+	unsigned int numPrimitives = scene.numSpheres + scene.numCylinders;
+
+	scene.numBVHNodes = 0;
+	scene.bvhContainer = NULL;
+	scene.bvhPrimitiveContainer = NULL;
+
+	if (numPrimitives == 0) return;
+
+	std::vector<BuildPrimitive> prims(numPrimitives);
+	for (unsigned int i = 0; i < numPrimitives; ++i)
+	{
+		BuildPrimitive& prim = prims[i];
+		if (i < scene.numSpheres)
+		{
+			prim.bounds = sphereBounds(scene.sphereContainer[i]);
+			prim.reference = i;
+		}
+		else
+		{
+			prim.bounds = cylinderBounds(scene.cylinderContainer[i - scene.numSpheres]);
+			prim.reference = (i - scene.numSpheres) | BVH_CYLINDER_FLAG;
+		}
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			prim.centroid[axis] = 0.5f * (prim.bounds.min[axis] + prim.bounds.max[axis]);
+		}
+	}
+
+	std::vector<BVHNode> nodes(1);
+	nodes.reserve(2 * numPrimitives);
+	buildNode(nodes, prims, 0, 0, numPrimitives, 0);
+
+	scene.numBVHNodes = (unsigned int)nodes.size();
+	scene.bvhContainer = new BVHNode[nodes.size()];
+	std::copy(nodes.begin(), nodes.end(), scene.bvhContainer);
+
+	scene.bvhPrimitiveContainer = new unsigned int[numPrimitives];
+	for (unsigned int i = 0; i < numPrimitives; ++i)
+	{
+		scene.bvhPrimitiveContainer[i] = prims[i].reference;
+	}
+}
+
+// box of a node as it's stored
+static Bounds nodeBounds(const BVHNode& node)
+{
+	Bounds b = { { node.boundsMin.x, node.boundsMin.y, node.boundsMin.z }, { node.boundsMax.x, node.boundsMax.y, node.boundsMax.z } };
+	return b;
+}
+
+void refitBVH(Scene& scene, std::vector<bool>& changed)
+{
+	// children always come after their parent, so going backwards fits every child before the node containing it
+	for (unsigned int n = scene.numBVHNodes; n-- > 0;)
+	{
+		BVHNode& node = scene.bvhContainer[n];
+
+		Bounds bounds = emptyBounds();
+		if (node.primCount > 0)
+		{
+			for (unsigned int i = node.leftFirst; i < node.leftFirst + node.primCount; ++i)
+			{
+				unsigned int reference = scene.bvhPrimitiveContainer[i];
+				if (reference & BVH_CYLINDER_FLAG) growBounds(bounds, cylinderBounds(scene.cylinderContainer[reference & ~BVH_CYLINDER_FLAG]));
+				else growBounds(bounds, sphereBounds(scene.sphereContainer[reference]));
+			}
+		}
+		else
+		{
+			growBounds(bounds, nodeBounds(scene.bvhContainer[node.leftFirst]));
+			growBounds(bounds, nodeBounds(scene.bvhContainer[node.leftFirst + 1]));
+		}
+
+		Bounds old = nodeBounds(node);
+		if (memcmp(&old, &bounds, sizeof(Bounds)) == 0) continue;
+
+		node.boundsMin.x = bounds.min[0]; node.boundsMin.y = bounds.min[1]; node.boundsMin.z = bounds.min[2];
+		node.boundsMax.x = bounds.max[0]; node.boundsMax.y = bounds.max[1]; node.boundsMax.z = bounds.max[2];
+		changed[n] = true;
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef __BVH_H
+#define __BVH_H
+
+#include <vector>
+#include "Scene.h"
+
+// primitive references stored in the hierarchy are sphere indices, unless this bit is set (then they're cylinder indices)
+const unsigned int BVH_CYLINDER_FLAG = 0x80000000;
+
+// maximum depth of the hierarchy (also the size of the traversal stack, so must match BVH_STACK_SIZE in Intersection.cl)
+const int BVH_MAX_DEPTH = 32;
+
+// a single node of the bounding volume hierarchy
+// laid out to match the BVHNode struct in Classes.cl
+typedef struct BVHNode
+{
+	Point boundsMin;			// minimum corner of the node's bounding box
+	Point boundsMax;			// maximum corner of the node's bounding box
+	unsigned int leftFirst;		// index of the left child (right child follows it), or first primitive reference for leaves
+	unsigned int primCount;		// number of primitive references in a leaf (zero for interior nodes)
+} BVHNode;
+
+// build a surface area heuristic BVH over the scene's spheres and cylinders
+// planes are infinite, so they are left out of the hierarchy and tested separately
+void buildBVH(Scene& scene);
+
+// fit the hierarchy's boxes to where the spheres and cylinders are now (after some have moved or changed size), keeping its shape
+// much cheaper than building it again, though it gets slower to traverse the further things move from where it was built
+// sets changed[node] for each node whose box changed (changed needs an entry per node)
+void refitBVH(Scene& scene, std::vector<bool>& changed);
+
+#endif // __BVH_H
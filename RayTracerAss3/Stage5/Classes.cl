@@ -57,6 +57,15 @@ typedef struct Cylinder
 	unsigned int materialId;	// material id
 } Cylinder;
 
+// node of the bounding volume hierarchy over the spheres and cylinders
+typedef struct BVHNode
+{
+	float3 boundsMin;			// minimum corner of the node's bounding box
+	float3 boundsMax;			// maximum corner of the node's bounding box
+	unsigned int leftFirst;		// index of the left child (right child follows it), or first primitive reference for leaves
+	unsigned int primCount;		// number of primitive references in a leaf (zero for interior nodes)
+} BVHNode;
+
 typedef struct Intersection
 {
 	enum PrimitiveType objectType;	// type of object intersected with
@@ -77,6 +86,25 @@ typedef struct Intersection
 	};
 } Intersection;
 
+// node of the hierarchy over the lights (only built for -manyLights)
+typedef struct LightNode
+{
+	float3 boundsMin;			// minimum corner of the box around the node's lights
+	float3 boundsMax;			// maximum corner of the box around the node's lights
+	float intensity;			// total intensity of the node's lights (summed over the colour channels)
+	unsigned int leftFirst;		// index of the left child (right child follows it), or the light for leaves
+	unsigned int isLeaf;		// whether the node is a single light
+} LightNode;
+
+// work done for a pixel, counted in -heatmap builds (see HEATMAP_COUNT)
+typedef struct HeatmapCounts
+{
+	unsigned int primitiveTests;	// intersection tests of view rays against planes, spheres and cylinders
+	unsigned int shadowRays;		// rays cast towards lights
+	unsigned int shadowTests;		// occlusion tests of shadow rays against planes, spheres and cylinders
+	unsigned int bounces;			// surfaces hit by view rays
+} HeatmapCounts;
+
 typedef struct Scene
 {
 	float3 cameraPosition;					// camera location
@@ -91,6 +119,8 @@ typedef struct Scene
 	unsigned int numSpheres;
 	unsigned int numPlanes;
 	unsigned int numCylinders;
+	unsigned int numBVHNodes;
+	unsigned int numLightNodes;
 
 	// scene objects
 	__global Material* materialContainer;
@@ -98,4 +128,67 @@ typedef struct Scene
 	__global Sphere* sphereContainer;
 	__global Plane* planeContainer;
 	__global Cylinder* cylinderContainer;
+
+	// bounding volume hierarchy over the spheres and cylinders
+	__global BVHNode* bvhContainer;
+	__global unsigned int* bvhPrimitiveContainer;
+
+	// intersection data for the spheres and cylinders, in the order the hierarchy references them
+	__global float4* primitiveShapeContainer;
+	__global float4* primitiveAxisContainer;
+	__global float* primitiveRadiusTermContainer;
+
+	// hierarchy over the lights for sampling them with -manyLights
+	__global LightNode* lightTreeContainer;
+
+	// counters of the pixel being rendered (only set by func in -heatmap builds)
+	HeatmapCounts* heatmapCounts;
 } Scene;
+
+// scene specialisation
+// the host builds the program with these defined from the loaded scene (see getSceneBuildOptions),
+// so loops get constant bounds and paths the scene never takes compile out; left undefined, everything is kept
+#ifdef SCENE_NUM_PLANES
+#define NUM_PLANES(scene) SCENE_NUM_PLANES
+#else
+#define NUM_PLANES(scene) ((scene)->numPlanes)
+#endif
+
+#ifdef SCENE_NUM_LIGHTS
+#define NUM_LIGHTS(scene) SCENE_NUM_LIGHTS
+#else
+#define NUM_LIGHTS(scene) ((scene)->numLights)
+#endif
+
+#ifdef SCENE_HAS_BVH
+#define HAS_BVH(scene) SCENE_HAS_BVH
+#else
+#define HAS_BVH(scene) ((scene)->numBVHNodes > 0)
+#endif
+
+// heatmap counting (the host defines HEATMAP for -heatmap), compiles to nothing otherwise
+// the wavefront kernels leave the counters unset, so they're skipped
+#ifdef HEATMAP
+#define HEATMAP_COUNT(scene, counter, amount) do { if ((scene)->heatmapCounts != 0) (scene)->heatmapCounts->counter += (amount); } while (0)
+#else
+#define HEATMAP_COUNT(scene, counter, amount)
+#endif
+
+#ifndef SCENE_USES_GOURAUD
+#define SCENE_USES_GOURAUD 1
+#endif
+#ifndef SCENE_USES_CHECKERBOARD
+#define SCENE_USES_CHECKERBOARD 1
+#endif
+#ifndef SCENE_USES_CIRCLES
+#define SCENE_USES_CIRCLES 1
+#endif
+#ifndef SCENE_USES_WOOD
+#define SCENE_USES_WOOD 1
+#endif
+#ifndef SCENE_USES_REFLECTION
+#define SCENE_USES_REFLECTION 1
+#endif
+#ifndef SCENE_USES_REFRACTION
+#define SCENE_USES_REFRACTION 1
+#endif
@@ -7,8 +7,17 @@
 
 #include <algorithm>
 
-// maximum size of image
-const int MAX_WIDTH = 2048, MAX_HEIGHT = 2048;
+// maximum number of tiles being rendered or read back at once
+const int MAX_TILES_IN_FLIGHT = 4;
+
+// rows of tiles a streamed render (-stream) keeps on the device and host at once (one being written out while the next renders)
+const int STREAM_TILE_ROWS = 2;
+
+// maximum number of samples the wavefront renderer follows at once (tiles with more are split into batches of pixels)
+const int WAVEFRONT_MAX_PATHS = 1 << 18;
+
+// room in the wavefront renderer's shadow ray queue for each path (lighting is done without the queue when it's full)
+const int WAVEFRONT_SHADOW_RAYS_PER_PATH = 4;
 
 // math constants
 const float PI = 3.14159265358979323846f;
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Devices.h"
+
+// a string property of a device
+static std::string deviceString(cl_device_id device, cl_device_info param)
+{
+	char value[1024] = "";
+	clGetDeviceInfo(device, param, sizeof(value) - 1, value, NULL);
+	return std::string(value);
+}
+
+static const char* deviceTypeName(cl_device_type type)
+{
+	if (type & CL_DEVICE_TYPE_GPU) return "GPU";
+	if (type & CL_DEVICE_TYPE_CPU) return "CPU";
+	return "other";
+}
+
+std::vector<RenderTarget> findDevices()
+{
+	std::vector<RenderTarget> devices;
+
+	cl_uint numPlatforms = 0;
+	if (clGetPlatformIDs(0, NULL, &numPlatforms) != CL_SUCCESS || numPlatforms == 0) return devices;
+
+	std::vector<cl_platform_id> platforms(numPlatforms);
+	clGetPlatformIDs(numPlatforms, &platforms[0], NULL);
+
+	for (cl_uint p = 0; p < numPlatforms; ++p)
+	{
+		char platformName[1024] = "";
+		clGetPlatformInfo(platforms[p], CL_PLATFORM_NAME, sizeof(platformName) - 1, platformName, NULL);
+
+		// platforms without any devices return an error rather than none
+		cl_uint numDevices = 0;
+		if (clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, 0, NULL, &numDevices) != CL_SUCCESS || numDevices == 0) continue;
+
+		std::vector<cl_device_id> ids(numDevices);
+		clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, numDevices, &ids[0], NULL);
+
+		for (cl_uint d = 0; d < numDevices; ++d)
+		{
+			RenderTarget target;
+			target.device = ids[d];
+			target.type = 0;
+			target.computeUnits = 1;
+			clGetDeviceInfo(ids[d], CL_DEVICE_TYPE, sizeof(cl_device_type), &target.type, NULL);
+			clGetDeviceInfo(ids[d], CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &target.computeUnits, NULL);
+			target.name = deviceString(ids[d], CL_DEVICE_NAME);
+			target.platformName = platformName;
+			target.subDevice = false;
+			devices.push_back(target);
+		}
+	}
+
+	return devices;
+}
+
+void printDevices(const std::vector<RenderTarget>& devices)
+{
+	if (devices.empty()) printf("no OpenCL devices found\n");
+	for (size_t i = 0; i < devices.size(); ++i)
+	{
+		printf("device %d: %s (%s, %u compute units) on %s\n", (int)i, devices[i].name.c_str(), deviceTypeName(devices[i].type),
+			devices[i].computeUnits, devices[i].platformName.c_str());
+	}
+}
+
+// create the sub-devices properties describes, returning how many were made (0 if the device can't be split that way)
+static cl_uint createSubDevices(cl_device_id device, const cl_device_partition_property* properties, std::vector<cl_device_id>& ids)
+{
+	cl_uint numParts = 0;
+	if (clCreateSubDevices(device, properties, 0, NULL, &numParts) != CL_SUCCESS || numParts == 0) return 0;
+
+	ids.resize(numParts);
+	if (clCreateSubDevices(device, properties, numParts, &ids[0], NULL) != CL_SUCCESS) return 0;
+	return numParts;
+}
+
+// split a device into exactly parts sub-devices, sharing its compute units out as evenly as they go
+// (by counts, so the first computeUnits % parts get one more, or in equal parts with any left over dropped if the device can only split equally)
+static bool splitDevice(const RenderTarget& target, int parts, std::vector<RenderTarget>& selected)
+{
+	cl_uint unitsPerPart = target.computeUnits / parts;
+	if (unitsPerPart == 0)
+	{
+		printf("%s only has %u compute units, so it can't be split into %d sub-devices\n", target.name.c_str(), target.computeUnits, parts);
+		return false;
+	}
+
+	std::vector<cl_device_partition_property> properties;
+	properties.push_back(CL_DEVICE_PARTITION_BY_COUNTS);
+	for (int i = 0; i < parts; ++i) properties.push_back((cl_device_partition_property)(unitsPerPart + (i < (int)(target.computeUnits % parts) ? 1 : 0)));
+	properties.push_back(CL_DEVICE_PARTITION_BY_COUNTS_LIST_END);
+	properties.push_back(0);
+
+	std::vector<cl_device_id> ids;
+	cl_uint numParts = createSubDevices(target.device, &properties[0], ids);
+	bool byCounts = numParts == (cl_uint)parts;
+	if (!byCounts)
+	{
+		for (cl_uint i = 0; i < numParts; ++i) clReleaseDevice(ids[i]);
+
+		// equal parts of unitsPerPart make computeUnits / unitsPerPart sub-devices, which can be more than asked for
+		cl_device_partition_property equally[] = { CL_DEVICE_PARTITION_EQUALLY, (cl_device_partition_property)unitsPerPart, 0 };
+		numParts = createSubDevices(target.device, equally, ids);
+		if (numParts < (cl_uint)parts)
+		{
+			for (cl_uint i = 0; i < numParts; ++i) clReleaseDevice(ids[i]);
+			printf("%s can't be split into %d sub-devices\n", target.name.c_str(), parts);
+			return false;
+		}
+		for (cl_uint i = parts; i < numParts; ++i) clReleaseDevice(ids[i]);
+	}
+
+	for (int i = 0; i < parts; ++i)
+	{
+		RenderTarget part = target;
+		part.device = ids[i];
+		part.computeUnits = byCounts ? (cl_uint)properties[i + 1] : unitsPerPart;
+		part.name = target.name + " [" + std::to_string(i) + "]";
+		part.subDevice = true;
+		selected.push_back(part);
+	}
+	return true;
+}
+
+bool selectDevices(const std::vector<RenderTarget>& devices, const char* spec, int subDevices, std::vector<RenderTarget>& selected)
+{
+	if (devices.empty())
+	{
+		printf("Couldn't find any devices\n");
+		return false;
+	}
+
+	std::vector<int> picked;
+	if (spec == NULL)
+	{
+		// a GPU if there is one, but any device will do
+		int first = 0;
+		for (size_t i = 0; i < devices.size(); ++i)
+		{
+			if (devices[i].type & CL_DEVICE_TYPE_GPU)
+			{
+				first = (int)i;
+				break;
+			}
+		}
+		picked.push_back(first);
+	}
+	else if (strcmp(spec, "all") == 0)
+	{
+		for (size_t i = 0; i < devices.size(); ++i) picked.push_back((int)i);
+	}
+	else
+	{
+		const char* next = spec;
+		while (*next != '\0')
+		{
+			char* end;
+			long index = strtol(next, &end, 10);
+			if (end == next || index < 0 || index >= (long)devices.size() || (*end != ',' && *end != '\0'))
+			{
+				printf("-device %s doesn't name a device (there are %d, see -listDevices)\n", spec, (int)devices.size());
+				return false;
+			}
+			picked.push_back((int)index);
+			next = *end == ',' ? end + 1 : end;
+		}
+	}
+
+	for (size_t i = 0; i < picked.size(); ++i)
+	{
+		if (subDevices > 1)
+		{
+			if (!splitDevice(devices[picked[i]], subDevices, selected)) return false;
+		}
+		else
+		{
+			selected.push_back(devices[picked[i]]);
+		}
+	}
+	return true;
+}
+
+void releaseDevices(std::vector<RenderTarget>& selected)
+{
+	for (size_t i = 0; i < selected.size(); ++i)
+	{
+		if (selected[i].subDevice) clReleaseDevice(selected[i].device);
+	}
+	selected.clear();
+}
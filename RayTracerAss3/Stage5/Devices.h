@@ -0,0 +1,34 @@
+#ifndef __DEVICES_H
+#define __DEVICES_H
+
+#include <string>
+#include <vector>
+#include "LoadCL.h"
+
+// an OpenCL device found on one of the platforms (or a part of one made by -subDevices)
+typedef struct RenderTarget
+{
+	cl_device_id device;
+	cl_device_type type;
+	cl_uint computeUnits;
+	std::string name;
+	std::string platformName;
+	bool subDevice;				// made by clCreateSubDevices, so it has to be released
+} RenderTarget;
+
+// every device on every platform, in platform order (the indices -device selects by)
+std::vector<RenderTarget> findDevices();
+
+// print the devices with their indices
+void printDevices(const std::vector<RenderTarget>& devices);
+
+// pick devices by spec: "all", or a comma separated list of indices into devices, NULL for the first GPU (or the first device if there's no GPU)
+// with subDevices > 1 each one picked is split into that many parts, sharing its compute units as evenly as they go
+// (which are rendered to instead of the device)
+// returns false (having printed why) if the spec names a device that doesn't exist or a device can't be split
+bool selectDevices(const std::vector<RenderTarget>& devices, const char* spec, int subDevices, std::vector<RenderTarget>& selected);
+
+// release the sub-devices among the selected devices
+void releaseDevices(std::vector<RenderTarget>& selected);
+
+#endif // __DEVICES_H
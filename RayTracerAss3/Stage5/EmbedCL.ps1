@@ -0,0 +1,45 @@
+# embeds the OpenCL sources in the executable (run as a pre-build step)
+# Raytrace.cl is written to OutFile as a char array with its #includes expanded, so the renderer doesn't need the .cl files at runtime
+# the header is only rewritten when the sources change, so unchanged sources don't force a recompile
+param(
+	[string]$SourceDir,		# directory the #include paths are relative to (RayTracerAss3)
+	[string]$OutFile		# header to generate
+)
+
+function Expand-Source([string]$path)
+{
+	$output = New-Object System.Text.StringBuilder
+	foreach ($line in [System.IO.File]::ReadAllLines($path))
+	{
+		if ($line -match '^\s*#include\s+"([^"]+)"')
+		{
+			$include = $Matches[1]
+			[void]$output.Append((Expand-Source (Join-Path $SourceDir $include)))
+		}
+		else
+		{
+			[void]$output.Append($line).Append("`n")
+		}
+	}
+	return $output.ToString()
+}
+
+$source = Expand-Source (Join-Path $SourceDir "Stage5/Raytrace.cl")
+$bytes = [System.Text.Encoding]::UTF8.GetBytes($source)
+
+$header = New-Object System.Text.StringBuilder
+[void]$header.Append("// generated by EmbedCL.ps1 from Stage5/Raytrace.cl, do not edit`n")
+[void]$header.Append("static const char embeddedRaytraceCL[] = {`n")
+for ($i = 0; $i -lt $bytes.Length; $i += 16)
+{
+	$end = [Math]::Min($i + 16, $bytes.Length) - 1
+	[void]$header.Append("`t").Append((($bytes[$i..$end] | ForEach-Object { "0x{0:x2}," -f $_ }) -join "")).Append("`n")
+}
+[void]$header.Append("`t0x00`n};`n")
+$text = $header.ToString()
+
+if (!(Test-Path $OutFile) -or ([System.IO.File]::ReadAllText($OutFile) -ne $text))
+{
+	New-Item -ItemType Directory -Force -Path (Split-Path -Parent $OutFile) | Out-Null
+	[System.IO.File]::WriteAllText($OutFile, $text)
+}
@@ -0,0 +1,68 @@
+#pragma warning(disable: 4996)
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "Heatmap.h"
+#include "ImageIO.h"
+
+static const char* counterNames[NUM_HEATMAP_COUNTERS] = { "primitive tests", "shadow rays", "shadow tests", "bounces" };
+static const char* counterFileNames[NUM_HEATMAP_COUNTERS] = { "primitives", "shadowrays", "shadowtests", "bounces" };
+
+// colours the ramp goes through from no work (black) to the busiest pixel (white)
+static const int NUM_RAMP_COLOURS = 5;
+static const unsigned char rampColours[NUM_RAMP_COLOURS][3] = { { 0, 0, 0 }, { 0, 0, 255 }, { 255, 0, 0 }, { 255, 255, 0 }, { 255, 255, 255 } };
+
+// colour of a point (0 to 1) along the ramp, as a pixel in the format write_bmp expects
+static unsigned int rampColour(float position)
+{
+	float scaled = position * (NUM_RAMP_COLOURS - 1);
+	int index = (int)scaled;
+	if (index >= NUM_RAMP_COLOURS - 1) index = NUM_RAMP_COLOURS - 2;
+	float blend = scaled - index;
+
+	unsigned int channels[3];
+	for (int c = 0; c < 3; ++c)
+	{
+		channels[c] = (unsigned int)(rampColours[index][c] + (rampColours[index + 1][c] - rampColours[index][c]) * blend + 0.5f);
+	}
+
+	return channels[2] << 16 | channels[1] << 8 | channels[0];
+}
+
+void writeHeatmaps(const char* outputFilename, const cl_uint4* counts, int width, int height, int samples)
+{
+	int numPixels = width * height;
+	double numSamples = (double)numPixels * samples * samples;
+
+	// heatmaps go beside the output image
+	std::string stem(outputFilename);
+	size_t extension = stem.rfind(".bmp");
+	if (extension != std::string::npos && extension == stem.size() - 4) stem.erase(extension);
+
+	unsigned int* image = new unsigned int[numPixels];
+
+	printf("heatmap counts (%dx%d, %d sample(s) per pixel):\n", width, height, samples * samples);
+	for (int counter = 0; counter < NUM_HEATMAP_COUNTERS; ++counter)
+	{
+		unsigned long long total = 0;
+		unsigned int busiest = 0;
+		for (int i = 0; i < numPixels; ++i)
+		{
+			total += counts[i].s[counter];
+			if (counts[i].s[counter] > busiest) busiest = counts[i].s[counter];
+		}
+
+		for (int i = 0; i < numPixels; ++i)
+		{
+			image[i] = rampColour(busiest > 0 ? (float)counts[i].s[counter] / busiest : 0.0f);
+		}
+
+		std::string filename = stem + "_heatmap_" + counterFileNames[counter] + ".bmp";
+		write_bmp(filename.c_str(), image, width, height, width);
+
+		printf("  %-16s total %llu, per pixel %.2f, per sample %.2f, busiest pixel %u -> %s\n",
+			counterNames[counter], total, (double)total / numPixels, total / numSamples, busiest, filename.c_str());
+	}
+
+	delete[] image;
+}
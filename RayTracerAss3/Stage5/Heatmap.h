@@ -0,0 +1,13 @@
+#ifndef __HEATMAP_H
+#define __HEATMAP_H
+
+#include "LoadCL.h"
+
+// counters the kernel keeps for each pixel in -heatmap builds, in the order it writes them (must match HeatmapCounts in Classes.cl)
+enum HeatmapCounter { HEATMAP_PRIMITIVE_TESTS, HEATMAP_SHADOW_RAYS, HEATMAP_SHADOW_TESTS, HEATMAP_BOUNCES, NUM_HEATMAP_COUNTERS };
+
+// print the scene-wide total, per pixel and per sample average, and busiest pixel of each counter,
+// and write each one as a false-colour image beside the output (<output>_heatmap_<counter>.bmp), scaled so the busiest pixel is white
+void writeHeatmaps(const char* outputFilename, const cl_uint4* counts, int width, int height, int samples);
+
+#endif // __HEATMAP_H
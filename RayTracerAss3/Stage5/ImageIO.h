@@ -3,10 +3,16 @@
 #ifndef __IMAGE_IO_H
 #define __IMAGE_IO_H
 
+#include <fstream>
+
 // image file writing functions
-//bool read_bmp(const char *name, Texture& t);
+bool read_bmp(const char *name, unsigned int*& buffer, int& width, int& height);	// allocates buffer (delete[] it when done)
 void write_bmp(const char *name, unsigned int *screen, int width, int height, int stride);
 void write_tga(const char *name, unsigned int *screen, int width, int height, int stride);
 void write_ppm(const char *name, unsigned int *screen, int width, int height, int stride);
 
+// write_bmp in pieces, for images written as they're rendered: the header, then rows bottom up (as many at a time as wanted)
+void write_bmp_header(std::ofstream& imageFile, int width, int height);
+void write_bmp_rows(std::ofstream& imageFile, const unsigned int* buffer, int width, int rows, int stride);
+
 #endif //__IMAGE_IO_H
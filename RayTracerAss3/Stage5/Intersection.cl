@@ -1,4 +1,10 @@
-﻿float3 normalise(float3 x)
+﻿// primitive references in the hierarchy are sphere indices unless this bit is set (see BVH.h)
+__constant unsigned int BVH_CYLINDER_FLAG = 0x80000000;
+
+// size of the hierarchy traversal stack (must be at least BVH_MAX_DEPTH in BVH.h)
+#define BVH_STACK_SIZE 32
+
+float3 normalise(float3 x)
 {
 	return x * rsqrt(dot(x, x));
 }
@@ -7,8 +13,11 @@ bool isCylinderIntersected(__global Cylinder* cy, const Ray* r, float* t, float3
 {
 	// vector between start and end of the cylinder (cylinder axis, i.e. ca)
 	float3 ca = cy->p2 - cy->p1;
-	// vector between ray origin and start of the cylinder
-	float3 oc = r->start - cy->p1;
+	// the terms below lose too much precision when the ray starts far from the cylinder, so they're worked out from the point of the ray
+	// closest to the start of the cylinder instead (tStart along the ray), with the distances they give measured from there
+	float tStart = dot(cy->p1 - r->start, r->dir);
+	// vector between that point and start of the cylinder
+	float3 oc = r->start + r->dir * tStart - cy->p1;
 	// cache some dot-products 
 	float caca = dot(ca, ca);
 	float card = dot(ca, r->dir);
@@ -38,9 +47,9 @@ bool isCylinderIntersected(__global Cylinder* cy, const Ray* r, float* t, float3
 	if (y > 0 && y < caca)
 	{
 		// check to see if the collision point on the cylinder body is closer than the time parameter
-		if (tBody > EPSILON && tBody < *t)
+		if (tStart + tBody > EPSILON && tStart + tBody < *t)
 		{
-			*t = tBody;
+			*t = tStart + tBody;
 			*normal = (oc + (r->dir * tBody - ca * y / caca)) / cy->size;
 			return true;
 		}
@@ -49,14 +58,15 @@ bool isCylinderIntersected(__global Cylinder* cy, const Ray* r, float* t, float3
 	// calculate point of intersection on plane containing cap
 	float tCaps = (((y < 0.0f) ? 0.0f : caca) - caoc) / card;
 
-	float valToAbs = b + a * tCaps;
-	// check intersection point is within the radius of the cap
-	if (fabs(b + a * tCaps) < h)
+	// check intersection point is within the radius of the cap (measured from the cap's centre, as b + a * tCaps loses too much
+	// precision far along the ray or along the axis, letting hits well outside the cap through)
+	float3 capOffset = oc + r->dir * tCaps - ((y < 0.0f) ? 0.0f : 1.0f) * ca;
+	if (dot(capOffset, capOffset) < cy->size * cy->size)
 	{
 		// check to see if the collision point on the cylinder cap is closer than the time parameter
-		if (tCaps > EPSILON && tCaps < *t)
+		if (tStart + tCaps > EPSILON && tStart + tCaps < *t)
 		{
-			*t = tCaps;
+			*t = tStart + tCaps;
 			*normal = ca * rsqrt(caca) * sign(y);
 			return true;
 		}
@@ -114,26 +124,205 @@ bool isSphereIntersected(__global Sphere* s, const Ray* r, float* t)
 	return false;
 }
 
-bool objectIntersection(const Scene* scene, const Ray* viewRay, Intersection* intersect)
+// versions of the sphere and cylinder tests that read the compiled scene (see SceneCompiler.h) instead of the objects
+// the shape is a sphere's centre and radius squared, or a cylinder's first end and radius
+// the axis is a cylinder's axis and its length squared, and the radius term is its radius squared times its length squared
+
+bool isSphereIntersectedCompiled(const float4 shape, const Ray* r, float* t)
 {
-	// set default distance to be a long long way away
-	float t = MAX_RAY_DISTANCE;
+	float3 dist = shape.xyz - r->start;
+	float B = dot(r->dir, dist);
+	float D = B * B - dot(dist, dist) + shape.w;
 
-	// no intersection found by default
-	intersect->objectType = NONE;
+	if (D < 0.0f) return false;
+
+	// calculate both intersection times(/distances)
+	float t0 = B - sqrt(D);
+	float t1 = B + sqrt(D);
 
-	// search for sphere collisions, storing closest one found
-	for (unsigned int i = 0; i < scene->numSpheres; ++i)
+	// check to see if either of the two sphere collision points are closer than time parameter
+	if ((t0 > EPSILON) && (t0 < *t))
+	{
+		*t = t0;
+		return true;
+	}
+	else if ((t1 > EPSILON) && (t1 < *t))
 	{
-		if (isSphereIntersected(&scene->sphereContainer[i], viewRay, &t))
+		*t = t1;
+		return true;
+	}
+
+	return false;
+}
+
+bool isCylinderIntersectedCompiled(const float4 shape, const float4 axis, const float radiusTerm, const Ray* r, float* t, float3* normal)
+{
+	float3 ca = axis.xyz;
+	float caca = axis.w;
+	float tStart = dot(shape.xyz - r->start, r->dir);
+	float3 oc = r->start + r->dir * tStart - shape.xyz;
+	float card = dot(ca, r->dir);
+	float caoc = dot(ca, oc);
+
+	// calculate values for coefficients of line-cylinder equation
+	float a = caca - card * card;
+	float b = caca * dot(oc, r->dir) - caoc * card;
+	float c = caca * dot(oc, oc) - caoc * caoc - radiusTerm;
+
+	// first half of distance calculation (distance squared)
+	float h = b * b - a * c;
+
+	// if ray doesn't intersect with infinite cylinder, exit
+	if (h < 0.0f) return false;
+
+	// second half of distance calculation (distance)
+	h = sqrt(h);
+
+	// calculate point of intersection (on infinite cylinder)
+	float tBody = (-b - h) / a;
+
+	// calculate distance along cylinder
+	float y = caoc + tBody * card;
+
+	// check intersection point is on the length of the cylinder
+	if (y > 0 && y < caca)
+	{
+		if (tStart + tBody > EPSILON && tStart + tBody < *t)
 		{
-			intersect->objectType = SPHERE;
-			intersect->sphere = &scene->sphereContainer[i];
+			*t = tStart + tBody;
+			*normal = (oc + (r->dir * tBody - ca * y / caca)) / shape.w;
+			return true;
 		}
 	}
 
-	// search for plane collisions, storing closest one found
-	for (unsigned int i = 0; i < scene->numPlanes; ++i)
+	// calculate point of intersection on plane containing cap
+	float tCaps = (((y < 0.0f) ? 0.0f : caca) - caoc) / card;
+
+	// check intersection point is within the radius of the cap (from the cap's centre, for the same reason as isCylinderIntersected)
+	float3 capOffset = oc + r->dir * tCaps - ((y < 0.0f) ? 0.0f : 1.0f) * ca;
+	if (dot(capOffset, capOffset) < shape.w * shape.w)
+	{
+		if (tStart + tCaps > EPSILON && tStart + tCaps < *t)
+		{
+			*t = tStart + tCaps;
+			*normal = ca * rsqrt(caca) * sign(y);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// occlusion-only versions of the intersection tests (used for shadow rays)
+// these only report whether there's a collision before time t, so they skip calculating anything a hit would need
+
+bool isSphereOccluding(const float4 shape, const Ray* r, const float t)
+{
+	float3 dist = shape.xyz - r->start;
+	float B = dot(r->dir, dist);
+	float D = B * B - dot(dist, dist) + shape.w;
+
+	if (D < 0.0f) return false;
+
+	// either of the two sphere collision points will do
+	float sqrtD = sqrt(D);
+	float t0 = B - sqrtD;
+	float t1 = B + sqrtD;
+
+	return (t0 > EPSILON && t0 < t) || (t1 > EPSILON && t1 < t);
+}
+
+bool isPlaneOccluding(__global const Plane* p, const Ray* r, const float t)
+{
+	float angle = dot(r->dir, p->normal);
+
+	if (angle == 0.0f) return false;
+
+	float t0 = dot((p->pos - r->start), p->normal) / angle;
+
+	return t0 > EPSILON && t0 < t;
+}
+
+bool isCylinderOccluding(const float4 shape, const float4 axis, const float radiusTerm, const Ray* r, const float t)
+{
+	float3 ca = axis.xyz;
+	float caca = axis.w;
+	float tStart = dot(shape.xyz - r->start, r->dir);
+	float3 oc = r->start + r->dir * tStart - shape.xyz;
+	float card = dot(ca, r->dir);
+	float caoc = dot(ca, oc);
+
+	float a = caca - card * card;
+	float b = caca * dot(oc, r->dir) - caoc * card;
+	float c = caca * dot(oc, oc) - caoc * caoc - radiusTerm;
+
+	float h = b * b - a * c;
+
+	if (h < 0.0f) return false;
+
+	h = sqrt(h);
+
+	// collision with the body of the cylinder
+	float tBody = (-b - h) / a;
+	float y = caoc + tBody * card;
+
+	if (y > 0 && y < caca && tStart + tBody > EPSILON && tStart + tBody < t) return true;
+
+	// collision with the cap
+	float tCaps = (((y < 0.0f) ? 0.0f : caca) - caoc) / card;
+
+	float3 capOffset = oc + r->dir * tCaps - ((y < 0.0f) ? 0.0f : 1.0f) * ca;
+
+	return dot(capOffset, capOffset) < shape.w * shape.w && tStart + tCaps > EPSILON && tStart + tCaps < t;
+}
+
+// test to see if the ray hits the node's bounding box before time t (equivalent to distance)
+// stores the distance to where the ray enters the box if it does
+bool isBoxIntersected(__global const BVHNode* node, const Ray* r, const float3 invDir, const float t, float* tNear)
+{
+	// distances to each of the box's slabs
+	float3 t0 = (node->boundsMin - r->start) * invDir;
+	float3 t1 = (node->boundsMax - r->start) * invDir;
+	float3 tSmall = fmin(t0, t1);
+	float3 tBig = fmax(t0, t1);
+
+	// the ray is inside the box between the last slab entered and the first slab exited
+	*tNear = max(max(tSmall.x, tSmall.y), tSmall.z);
+	float tFar = min(min(tBig.x, tBig.y), tBig.z);
+
+	return tFar >= *tNear && tFar >= 0.0f && *tNear <= t;
+}
+
+// whether a hit at the same distance as the closest one so far replaces it
+// the brute-force loops test spheres, then planes, then cylinders, each in index order, and only replace a hit with a closer one,
+// so the hierarchy (which finds them in any order) keeps whichever of the tied hits they would have found first
+bool isTiedHitKept(const Scene* scene, const Intersection* intersect, const enum PrimitiveType type, const unsigned int index)
+{
+	if (type != intersect->objectType) return intersect->objectType != NONE && type < intersect->objectType;
+
+	switch (type)
+	{
+	case SPHERE:
+		return index < (unsigned int)(intersect->sphere - scene->sphereContainer);
+	case CYLINDER:
+		return index < (unsigned int)(intersect->cylinder - scene->cylinderContainer);
+	default:
+		return false;
+	}
+}
+
+bool objectIntersection(const Scene* scene, const Ray* viewRay, Intersection* intersect)
+{
+	// set default distance to be a long long way away
+	float t = MAX_RAY_DISTANCE;
+
+	// no intersection found by default
+	intersect->objectType = NONE;
+
+	// search for plane collisions first (they're infinite so aren't in the hierarchy), storing closest one found
+	// (spheres and cylinders at the same distance as a plane still replace it below where the brute-force loops would have kept them)
+	HEATMAP_COUNT(scene, primitiveTests, NUM_PLANES(scene));
+	for (unsigned int i = 0; i < NUM_PLANES(scene); ++i)
 	{
 		if (isPlaneIntersected(&scene->planeContainer[i], viewRay, &t))
 		{
@@ -142,15 +331,92 @@ bool objectIntersection(const Scene* scene, const Ray* viewRay, Intersection* in
 		}
 	}
 
-	// search for cylinder collisions, storing closest one found (and the normal at that point)
-	float3 normal;
-	for (unsigned int i = 0; i < scene->numCylinders; ++i)
+	// search the hierarchy for sphere and cylinder collisions, storing closest one found (and the normal for cylinders)
+	if (HAS_BVH(scene))
 	{
-		if (isCylinderIntersected(&scene->cylinderContainer[i], viewRay, &t, &normal))
+		float3 invDir = 1.0f / viewRay->dir;
+		float3 normal;
+
+		// nodes still to be visited (and the distance to their boxes)
+		unsigned int stack[BVH_STACK_SIZE];
+		float stackDist[BVH_STACK_SIZE];
+		int stackSize = 0;
+
+		unsigned int nodeIndex = 0;
+		float tNear;
+		bool visit = isBoxIntersected(&scene->bvhContainer[0], viewRay, invDir, t, &tNear);
+
+		while (visit)
 		{
-			intersect->objectType = CYLINDER;
-			intersect->normal = normal;
-			intersect->cylinder = &scene->cylinderContainer[i];
+			__global const BVHNode* node = &scene->bvhContainer[nodeIndex];
+
+			if (node->primCount > 0)
+			{
+				// leaf, so test all of its primitives (the compiled scene is stored in the same order, so only hits need the reference)
+				HEATMAP_COUNT(scene, primitiveTests, node->primCount);
+				for (unsigned int i = node->leftFirst; i < node->leftFirst + node->primCount; ++i)
+				{
+					unsigned int primitive = scene->bvhPrimitiveContainer[i];
+
+					// hits at the closest distance so far are found too, so ties can go the same way as the brute-force loops
+					float tHit = nextafter(t, INFINITY);
+
+					if (primitive & BVH_CYLINDER_FLAG)
+					{
+						unsigned int index = primitive & ~BVH_CYLINDER_FLAG;
+						if (isCylinderIntersectedCompiled(scene->primitiveShapeContainer[i], scene->primitiveAxisContainer[i], scene->primitiveRadiusTermContainer[i], viewRay, &tHit, &normal) &&
+							(tHit < t || isTiedHitKept(scene, intersect, CYLINDER, index)))
+						{
+							t = tHit;
+							intersect->objectType = CYLINDER;
+							intersect->normal = normal;
+							intersect->cylinder = &scene->cylinderContainer[index];
+						}
+					}
+					else if (isSphereIntersectedCompiled(scene->primitiveShapeContainer[i], viewRay, &tHit) &&
+						(tHit < t || isTiedHitKept(scene, intersect, SPHERE, primitive)))
+					{
+						t = tHit;
+						intersect->objectType = SPHERE;
+						intersect->sphere = &scene->sphereContainer[primitive];
+					}
+				}
+			}
+			else
+			{
+				// interior, so visit the nearest child that's hit first and come back to the other one later
+				float tLeft, tRight;
+				bool hitLeft = isBoxIntersected(&scene->bvhContainer[node->leftFirst], viewRay, invDir, t, &tLeft);
+				bool hitRight = isBoxIntersected(&scene->bvhContainer[node->leftFirst + 1], viewRay, invDir, t, &tRight);
+
+				if (hitLeft && hitRight)
+				{
+					bool leftFirst = tLeft <= tRight;
+					stack[stackSize] = leftFirst ? node->leftFirst + 1 : node->leftFirst;
+					stackDist[stackSize] = leftFirst ? tRight : tLeft;
+					stackSize++;
+					nodeIndex = leftFirst ? node->leftFirst : node->leftFirst + 1;
+					continue;
+				}
+				else if (hitLeft || hitRight)
+				{
+					nodeIndex = hitLeft ? node->leftFirst : node->leftFirst + 1;
+					continue;
+				}
+			}
+
+			// pop the next node off the stack, skipping any that are now further away than the closest collision
+			visit = false;
+			while (stackSize > 0)
+			{
+				stackSize--;
+				if (stackDist[stackSize] <= t)
+				{
+					nodeIndex = stack[stackSize];
+					visit = true;
+					break;
+				}
+			}
 		}
 	}
 
@@ -2,6 +2,9 @@
 	Ray tracing tutorial of http://www.codermind.com/articles/Raytracer-in-C++-Introduction-What-is-ray-tracing.html
 	It is free to use for educational purpose and cannot be redistributed outside of the tutorial pages. */
 
+#include <algorithm>
+#include <cmath>
+
 #include "Intersection.h"
 
 // test to see if collision between ray and a plane happens before time t (equivalent to distance)
@@ -78,8 +81,12 @@ bool isCylinderIntersected(const Cylinder* cy, const Ray* r, float* t, Vector* n
 	// vector between start and end of the cylinder (cylinder axis, i.e. ca)
 	Vector ca = cy->p2 - cy->p1;
 
-	// vector between ray origin and start of the cylinder
-	Vector oc = r->start - cy->p1;
+	// the terms below lose too much precision when the ray starts far from the cylinder, so they're worked out from the point of the ray
+	// closest to the start of the cylinder instead (tStart along the ray), with the distances they give measured from there
+	float tStart = (cy->p1 - r->start) * r->dir;
+
+	// vector between that point and start of the cylinder
+	Vector oc = r->start + r->dir * tStart - cy->p1;
 
 	// cache some dot-products 
 	float caca = ca * ca;
@@ -110,9 +117,9 @@ bool isCylinderIntersected(const Cylinder* cy, const Ray* r, float* t, Vector* n
 	if (y > 0 && y < caca)
 	{
 		// check to see if the collision point on the cylinder body is closer than the time parameter
-		if (tBody > EPSILON && tBody < *t)
+		if (tStart + tBody > EPSILON && tStart + tBody < *t)
 		{
-			*t = tBody;
+			*t = tStart + tBody;
 			*normal = (oc + (r->dir * tBody - ca * y / caca)) / cy->size;
 			return true;
 		}
@@ -121,13 +128,15 @@ bool isCylinderIntersected(const Cylinder* cy, const Ray* r, float* t, Vector* n
 	// calculate point of intersection on plane containing cap
 	float tCaps = (((y < 0.0f) ? 0.0f : caca) - caoc) / card;
 
-	// check intersection point is within the radius of the cap
-	if (abs(b + a * tCaps) < h)
+	// check intersection point is within the radius of the cap (measured from the cap's centre, as b + a * tCaps loses too much
+	// precision far along the ray or along the axis, letting hits well outside the cap through)
+	Vector capOffset = oc + r->dir * tCaps - ca * ((y < 0.0f) ? 0.0f : 1.0f);
+	if (capOffset * capOffset < cy->size * cy->size)
 	{
 		// check to see if the collision point on the cylinder cap is closer than the time parameter
-		if (tCaps > EPSILON && tCaps < *t)
+		if (tStart + tCaps > EPSILON && tStart + tCaps < *t)
 		{
-			*t = tCaps;
+			*t = tStart + tCaps;
 			*normal = ca * invsqrtf(caca) * sign(y);
 			return true;
 		}
@@ -137,6 +146,74 @@ bool isCylinderIntersected(const Cylinder* cy, const Ray* r, float* t, Vector* n
 }
 
 
+// test to see if collision between ray and a sphere happens before time t (equivalent to distance)
+// same as isSphereIntersected, but only answers yes or no, so either collision point will do
+bool isSphereOccluding(const Sphere* s, const Ray* r, const float t)
+{
+	Vector dist = s->pos - r->start;
+	float B = r->dir * dist;
+	float D = B * B - dist * dist + s->size * s->size;
+
+	if (D < 0.0f) return false;
+
+	float sqrtD = sqrtf(D);
+	float t0 = B - sqrtD;
+	float t1 = B + sqrtD;
+
+	return (t0 > EPSILON && t0 < t) || (t1 > EPSILON && t1 < t);
+}
+
+
+// test to see if collision between ray and a plane happens before time t (equivalent to distance)
+// same as isPlaneIntersected, but only answers yes or no
+bool isPlaneOccluding(const Plane* p, const Ray* r, const float t)
+{
+	float angle = r->dir * p->normal;
+
+	if (angle == 0.0f) return false;
+
+	float t0 = ((p->pos - r->start) * p->normal) / angle;
+
+	return t0 > EPSILON && t0 < t;
+}
+
+
+// test to see if collision between ray and a cylinder happens before time t (equivalent to distance)
+// same as isCylinderIntersected, but only answers yes or no, so the normal is never calculated
+bool isCylinderOccluding(const Cylinder* cy, const Ray* r, const float t)
+{
+	Vector ca = cy->p2 - cy->p1;
+	float tStart = (cy->p1 - r->start) * r->dir;
+	Vector oc = r->start + r->dir * tStart - cy->p1;
+	float caca = ca * ca;
+	float card = ca * r->dir;
+	float caoc = ca * oc;
+
+	float a = caca - card * card;
+	float b = caca * (oc * r->dir) - caoc * card;
+	float c = caca * (oc * oc) - caoc * caoc - cy->size * cy->size * caca;
+
+	float h = b * b - a * c;
+
+	if (h < 0.0f) return false;
+
+	h = sqrt(h);
+
+	// collision with the body of the cylinder
+	float tBody = (-b - h) / a;
+	float y = caoc + tBody * card;
+
+	if (y > 0 && y < caca && tStart + tBody > EPSILON && tStart + tBody < t) return true;
+
+	// collision with the cap
+	float tCaps = (((y < 0.0f) ? 0.0f : caca) - caoc) / card;
+
+	Vector capOffset = oc + r->dir * tCaps - ca * ((y < 0.0f) ? 0.0f : 1.0f);
+
+	return capOffset * capOffset < cy->size * cy->size && tStart + tCaps > EPSILON && tStart + tCaps < t;
+}
+
+
 // calculate collision normal, viewProjection, object's material, and test to see if inside collision object
 void calculateIntersectionResponse(const Scene* scene, const Ray* viewRay, Intersection* intersect)
 {
@@ -170,6 +247,125 @@ void calculateIntersectionResponse(const Scene* scene, const Ray* viewRay, Inter
 }
 
 
+bool isBoxIntersected(const BVHNode* node, const Ray* r, const Vector& invDir, const float t, float* tNear)
+{
+	// distances to each of the box's slabs
+	float tx0 = (node->boundsMin.x - r->start.x) * invDir.x, tx1 = (node->boundsMax.x - r->start.x) * invDir.x;
+	float ty0 = (node->boundsMin.y - r->start.y) * invDir.y, ty1 = (node->boundsMax.y - r->start.y) * invDir.y;
+	float tz0 = (node->boundsMin.z - r->start.z) * invDir.z, tz1 = (node->boundsMax.z - r->start.z) * invDir.z;
+
+	// the ray is inside the box between the last slab entered and the first slab exited
+	*tNear = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::min(tz0, tz1));
+	float tFar = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::max(tz0, tz1));
+
+	return tFar >= *tNear && tFar >= 0.0f && *tNear <= t;
+}
+
+// whether a hit at the same distance as the closest one so far replaces it
+// the brute-force loops test spheres, then planes, then cylinders, each in index order, and only replace a hit with a closer one,
+// so the hierarchy (which finds them in any order) keeps whichever of the tied hits they would have found first
+static bool isTiedHitKept(const Scene* scene, const Intersection* intersect, Intersection::PrimitiveType type, unsigned int index)
+{
+	if (type != intersect->objectType) return intersect->objectType != Intersection::PrimitiveType::NONE && type < intersect->objectType;
+
+	switch (type)
+	{
+	case Intersection::PrimitiveType::SPHERE:
+		return index < (unsigned int)(intersect->sphere - scene->sphereContainer);
+	case Intersection::PrimitiveType::CYLINDER:
+		return index < (unsigned int)(intersect->cylinder - scene->cylinderContainer);
+	default:
+		return false;
+	}
+}
+
+// search the hierarchy for the closest sphere or cylinder hit before time t, updating t and the intersection (the same walk as the kernel's)
+static void hierarchyIntersection(const Scene* scene, const Ray* viewRay, Intersection* intersect, float* t)
+{
+	Vector invDir = { 1.0f / viewRay->dir.x, 1.0f / viewRay->dir.y, 1.0f / viewRay->dir.z };
+	Vector normal;
+
+	// nodes still to be visited (and the distance to their boxes)
+	unsigned int stack[BVH_MAX_DEPTH];
+	float stackDist[BVH_MAX_DEPTH];
+	int stackSize = 0;
+
+	unsigned int nodeIndex = 0;
+	float tNear;
+	bool visit = isBoxIntersected(&scene->bvhContainer[0], viewRay, invDir, *t, &tNear);
+
+	while (visit)
+	{
+		const BVHNode* node = &scene->bvhContainer[nodeIndex];
+
+		if (node->primCount > 0)
+		{
+			for (unsigned int i = node->leftFirst; i < node->leftFirst + node->primCount; ++i)
+			{
+				unsigned int primitive = scene->bvhPrimitiveContainer[i];
+
+				// hits at the closest distance so far are found too, so ties can go the same way as the brute-force loops
+				float tHit = std::nextafter(*t, INFINITY);
+
+				if (primitive & BVH_CYLINDER_FLAG)
+				{
+					unsigned int index = primitive & ~BVH_CYLINDER_FLAG;
+					if (isCylinderIntersected(&scene->cylinderContainer[index], viewRay, &tHit, &normal) &&
+						(tHit < *t || isTiedHitKept(scene, intersect, Intersection::PrimitiveType::CYLINDER, index)))
+					{
+						*t = tHit;
+						intersect->objectType = Intersection::PrimitiveType::CYLINDER;
+						intersect->normal = normal;
+						intersect->cylinder = &scene->cylinderContainer[index];
+					}
+				}
+				else if (isSphereIntersected(&scene->sphereContainer[primitive], viewRay, &tHit) &&
+					(tHit < *t || isTiedHitKept(scene, intersect, Intersection::PrimitiveType::SPHERE, primitive)))
+				{
+					*t = tHit;
+					intersect->objectType = Intersection::PrimitiveType::SPHERE;
+					intersect->sphere = &scene->sphereContainer[primitive];
+				}
+			}
+		}
+		else
+		{
+			// interior, so visit the nearest child that's hit first and come back to the other one later
+			float tLeft, tRight;
+			bool hitLeft = isBoxIntersected(&scene->bvhContainer[node->leftFirst], viewRay, invDir, *t, &tLeft);
+			bool hitRight = isBoxIntersected(&scene->bvhContainer[node->leftFirst + 1], viewRay, invDir, *t, &tRight);
+
+			if (hitLeft && hitRight)
+			{
+				bool leftFirst = tLeft <= tRight;
+				stack[stackSize] = leftFirst ? node->leftFirst + 1 : node->leftFirst;
+				stackDist[stackSize] = leftFirst ? tRight : tLeft;
+				stackSize++;
+				nodeIndex = leftFirst ? node->leftFirst : node->leftFirst + 1;
+				continue;
+			}
+			else if (hitLeft || hitRight)
+			{
+				nodeIndex = hitLeft ? node->leftFirst : node->leftFirst + 1;
+				continue;
+			}
+		}
+
+		// pop the next node, skipping any that are further away than the closest hit found since they were pushed
+		visit = false;
+		while (stackSize > 0)
+		{
+			stackSize--;
+			if (stackDist[stackSize] <= *t)
+			{
+				nodeIndex = stack[stackSize];
+				visit = true;
+				break;
+			}
+		}
+	}
+}
+
 // test to see if collision between ray and any object in the scene
 // updates intersection structure if collision occurs
 bool objectIntersection(const Scene* scene, const Ray* viewRay, Intersection* intersect)
@@ -180,15 +376,18 @@ bool objectIntersection(const Scene* scene, const Ray* viewRay, Intersection* in
 	// no intersection found by default
 	intersect->objectType = Intersection::PrimitiveType::NONE;
 
-	// search for sphere collisions, storing closest one found
-    for (unsigned int i = 0; i < scene->numSpheres; ++i)
-    {
-        if (isSphereIntersected(&scene->sphereContainer[i], viewRay, &t))
-        {
-			intersect->objectType = Intersection::PrimitiveType::SPHERE;
-			intersect->sphere = &scene->sphereContainer[i];
-        }
-    }
+	// without a hierarchy, search for sphere collisions first (the same order as the kernel's brute-force loops), storing closest one found
+	if (scene->numBVHNodes == 0)
+	{
+		for (unsigned int i = 0; i < scene->numSpheres; ++i)
+		{
+			if (isSphereIntersected(&scene->sphereContainer[i], viewRay, &t))
+			{
+				intersect->objectType = Intersection::PrimitiveType::SPHERE;
+				intersect->sphere = &scene->sphereContainer[i];
+			}
+		}
+	}
 
 	// search for plane collisions, storing closest one found
 	for (unsigned int i = 0; i < scene->numPlanes; ++i)
@@ -200,15 +399,22 @@ bool objectIntersection(const Scene* scene, const Ray* viewRay, Intersection* in
 		}
 	}
 
-	// search for cylinder collisions, storing closest one found (and the normal at that point)
-	Vector normal;
-	for (unsigned int i = 0; i < scene->numCylinders; ++i)
+	// search the hierarchy for sphere and cylinder collisions (or the cylinders without one), storing closest one found (and the normal for cylinders)
+	if (scene->numBVHNodes > 0)
+	{
+		hierarchyIntersection(scene, viewRay, intersect, &t);
+	}
+	else
 	{
-		if (isCylinderIntersected(&scene->cylinderContainer[i], viewRay, &t, &normal))
+		Vector normal;
+		for (unsigned int i = 0; i < scene->numCylinders; ++i)
 		{
-			intersect->objectType = Intersection::PrimitiveType::CYLINDER;
-			intersect->normal = normal;
-			intersect->cylinder = &scene->cylinderContainer[i];
+			if (isCylinderIntersected(&scene->cylinderContainer[i], viewRay, &t, &normal))
+			{
+				intersect->objectType = Intersection::PrimitiveType::CYLINDER;
+				intersect->normal = normal;
+				intersect->cylinder = &scene->cylinderContainer[i];
+			}
 		}
 	}
 
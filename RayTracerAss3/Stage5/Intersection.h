@@ -7,6 +7,7 @@
 
 #include "Scene.h"
 #include "SceneObjects.h"
+#include "BVH.h"
 
 // all pertinant information about an intersection of a ray with an object
 typedef struct Intersection
@@ -43,6 +44,22 @@ bool isPlaneIntersected(const Plane* p, const Ray* r, float* t);
 // updates closest collision time (/distance) if collision occurs
 bool isCylinderIntersected(const Cylinder* c, const Ray* r, float* t, Vector* normal);
 
+// test to see if collision between ray and a sphere happens before time t (equivalent to distance)
+// occlusion-only, so nothing is updated (used for shadow rays)
+bool isSphereOccluding(const Sphere* s, const Ray* r, const float t);
+
+// test to see if collision between ray and a plane happens before time t (equivalent to distance)
+// occlusion-only, so nothing is updated (used for shadow rays)
+bool isPlaneOccluding(const Plane* p, const Ray* r, const float t);
+
+// test to see if collision between ray and a cylinder happens before time t (equivalent to distance)
+// occlusion-only, so nothing is updated (used for shadow rays)
+bool isCylinderOccluding(const Cylinder* cy, const Ray* r, const float t);
+
+// test to see if the ray hits the node's bounding box before time t (equivalent to distance)
+// stores the distance to where the ray enters the box if it does (invDir is 1 / the ray's direction)
+bool isBoxIntersected(const BVHNode* node, const Ray* r, const Vector& invDir, const float t, float* tNear);
+
 // calculate collision normal, viewProjection, object's material, and test to see if inside collision object
 void calculateIntersectionResponse(const Scene* scene, const Ray* viewRay, Intersection* intersect); 
 
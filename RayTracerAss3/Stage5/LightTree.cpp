@@ -0,0 +1,138 @@
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+
+#include "LightTree.h"
+
+// brightness of a light, used to weight the splits and the odds of picking a cluster
+static float lightIntensity(const Light& light)
+{
+	return std::max(0.0f, light.intensity.red) + std::max(0.0f, light.intensity.green) + std::max(0.0f, light.intensity.blue);
+}
+
+// position of a light along an axis
+static float lightAxis(const Light& light, int axis)
+{
+	return axis == 0 ? light.pos.x : axis == 1 ? light.pos.y : light.pos.z;
+}
+
+// recursively build the node (and its children) containing the given range of lights
+static void buildLightNode(std::vector<LightNode>& nodes, std::vector<unsigned int>& order, const Light* lights, unsigned int nodeIndex, unsigned int first, unsigned int count)
+{
+	float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	float intensity = 0.0f;
+	for (unsigned int i = first; i < first + count; ++i)
+	{
+		const Light& light = lights[order[i]];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			boundsMin[axis] = std::min(boundsMin[axis], lightAxis(light, axis));
+			boundsMax[axis] = std::max(boundsMax[axis], lightAxis(light, axis));
+		}
+		intensity += lightIntensity(light);
+	}
+
+	LightNode& node = nodes[nodeIndex];
+	node.boundsMin.x = boundsMin[0]; node.boundsMin.y = boundsMin[1]; node.boundsMin.z = boundsMin[2]; node.boundsMin.empty = 0.0f;
+	node.boundsMax.x = boundsMax[0]; node.boundsMax.y = boundsMax[1]; node.boundsMax.z = boundsMax[2]; node.boundsMax.empty = 0.0f;
+	node.intensity = intensity;
+
+	if (count == 1)
+	{
+		node.leftFirst = order[first];
+		node.isLeaf = 1;
+		return;
+	}
+
+	// sort along the longest axis, and split where half of the intensity is on each side (or half the lights if they're all dark)
+	int axis = 0;
+	for (int i = 1; i < 3; ++i)
+	{
+		if (boundsMax[i] - boundsMin[i] > boundsMax[axis] - boundsMin[axis]) axis = i;
+	}
+	std::sort(order.begin() + first, order.begin() + first + count, [=](unsigned int a, unsigned int b)
+	{
+		return lightAxis(lights[a], axis) < lightAxis(lights[b], axis);
+	});
+
+	unsigned int mid = first + count / 2;
+	if (intensity > 0.0f)
+	{
+		// the left side takes lights until it has half (each side keeps at least one)
+		float sum = 0.0f;
+		mid = first;
+		while (mid < first + count - 1 && (mid == first || sum < 0.5f * intensity))
+		{
+			sum += lightIntensity(lights[order[mid]]);
+			++mid;
+		}
+	}
+
+	// children are always allocated next to each other, so only the left one's index needs storing
+	// (note: this invalidates the node reference above)
+	unsigned int leftIndex = (unsigned int)nodes.size();
+	nodes.resize(nodes.size() + 2);
+	nodes[nodeIndex].leftFirst = leftIndex;
+	nodes[nodeIndex].isLeaf = 0;
+
+	buildLightNode(nodes, order, lights, leftIndex, first, mid - first);
+	buildLightNode(nodes, order, lights, leftIndex + 1, mid, first + count - mid);
+}
+
+void buildLightTree(Scene& scene)
+{
+	scene.numLightNodes = 0;
+	scene.lightTreeContainer = NULL;
+
+	if (scene.numLights == 0) return;
+
+	std::vector<unsigned int> order(scene.numLights);
+	for (unsigned int i = 0; i < scene.numLights; ++i) order[i] = i;
+
+	std::vector<LightNode> nodes(1);
+	nodes.reserve(2 * scene.numLights - 1);
+	buildLightNode(nodes, order, scene.lightContainer, 0, 0, scene.numLights);
+
+	scene.numLightNodes = (unsigned int)nodes.size();
+	scene.lightTreeContainer = new LightNode[nodes.size()];
+	std::copy(nodes.begin(), nodes.end(), scene.lightTreeContainer);
+}
+
+void refitLightTree(Scene& scene, std::vector<bool>& changed)
+{
+	// children always come after their parent, so going backwards fits every child before the node containing it
+	for (unsigned int n = scene.numLightNodes; n-- > 0;)
+	{
+		LightNode& node = scene.lightTreeContainer[n];
+
+		LightNode fitted = node;
+		if (node.isLeaf)
+		{
+			const Light& light = scene.lightContainer[node.leftFirst];
+			fitted.boundsMin = light.pos;
+			fitted.boundsMax = light.pos;
+			fitted.intensity = lightIntensity(light);
+		}
+		else
+		{
+			const LightNode& left = scene.lightTreeContainer[node.leftFirst];
+			const LightNode& right = scene.lightTreeContainer[node.leftFirst + 1];
+			fitted.boundsMin.x = std::min(left.boundsMin.x, right.boundsMin.x);
+			fitted.boundsMin.y = std::min(left.boundsMin.y, right.boundsMin.y);
+			fitted.boundsMin.z = std::min(left.boundsMin.z, right.boundsMin.z);
+			fitted.boundsMax.x = std::max(left.boundsMax.x, right.boundsMax.x);
+			fitted.boundsMax.y = std::max(left.boundsMax.y, right.boundsMax.y);
+			fitted.boundsMax.z = std::max(left.boundsMax.z, right.boundsMax.z);
+			fitted.intensity = left.intensity + right.intensity;
+		}
+		fitted.boundsMin.empty = 0.0f;
+		fitted.boundsMax.empty = 0.0f;
+
+		if (fitted.boundsMin.x == node.boundsMin.x && fitted.boundsMin.y == node.boundsMin.y && fitted.boundsMin.z == node.boundsMin.z &&
+			fitted.boundsMax.x == node.boundsMax.x && fitted.boundsMax.y == node.boundsMax.y && fitted.boundsMax.z == node.boundsMax.z &&
+			fitted.intensity == node.intensity) continue;
+
+		node = fitted;
+		changed[n] = true;
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef __LIGHT_TREE_H
+#define __LIGHT_TREE_H
+
+#include <vector>
+#include "Scene.h"
+
+// a single node of the hierarchy over the lights (used to pick lights to sample with -manyLights)
+// laid out to match the LightNode struct in Classes.cl
+typedef struct LightNode
+{
+	Point boundsMin;			// minimum corner of the box around the node's lights
+	Point boundsMax;			// maximum corner of the box around the node's lights
+	float intensity;			// total intensity of the node's lights (summed over the colour channels)
+	unsigned int leftFirst;		// index of the left child (right child follows it), or the light for leaves
+	unsigned int isLeaf;		// whether the node is a single light
+} LightNode;
+
+// build a binary hierarchy over the scene's lights, splitting each cluster along its longest axis where it has half of the intensity on each side
+void buildLightTree(Scene& scene);
+
+// fit the hierarchy's boxes and intensities to the lights as they are now (after some have moved or changed brightness), keeping its shape
+// sets changed[node] for each node that changed (changed needs an entry per node)
+void refitLightTree(Scene& scene, std::vector<bool>& changed);
+
+#endif // __LIGHT_TREE_H
@@ -5,18 +5,26 @@ float3 applyDiffuse(const Ray* lightRay, __global const Light* currentLight, con
 
 	switch (intersect->material->type)
 	{
+#if SCENE_USES_GOURAUD
 	case GOURAUD:
 		output = intersect->material->diffuse;
 		break;
+#endif
+#if SCENE_USES_CHECKERBOARD
 	case CHECKERBOARD:
 		output = applyCheckerboard(intersect);
 		break;
+#endif
+#if SCENE_USES_CIRCLES
 	case CIRCLES:
 		output = applyCircles(intersect);
 		break;
+#endif
+#if SCENE_USES_WOOD
 	case WOOD:
 		output = applyWood(intersect);
 		break;
+#endif
 	}
 
 	float lambert = dot(lightRay->dir, intersect->normal);
@@ -33,35 +41,70 @@ float3 applySpecular(const Ray* lightRay, __global const Light* currentLight, co
 	return blinn * intersect->material->specular * currentLight->intensity;
 }
 
+// test to see if light ray collides with any of the scene's objects
+// any collision closer than the light will do, so the hierarchy is searched in whatever order and stops at the first one
 bool isInShadow(const Scene* scene, const Ray* lightRay, const float lightDist)
 {
-	float t = lightDist;
+	HEATMAP_COUNT(scene, shadowRays, 1);
 
-	// search for sphere collision
-	for (unsigned int i = 0; i < scene->numSpheres; ++i)
+	// search for plane collision
+	for (unsigned int i = 0; i < NUM_PLANES(scene); ++i)
 	{
-		if (isSphereIntersected(&scene->sphereContainer[i], lightRay, &t))
+		HEATMAP_COUNT(scene, shadowTests, 1);
+		if (isPlaneOccluding(&scene->planeContainer[i], lightRay, lightDist))
 		{
 			return true;
 		}
 	}
 
-	// search for plane collision
-	for (unsigned int i = 0; i < scene->numPlanes; ++i)
+	if (!HAS_BVH(scene)) return false;
+
+	// search the hierarchy for sphere and cylinder collision
+	float3 invDir = 1.0f / lightRay->dir;
+	float tNear; // unused here, but it's necessary for the function to work
+
+	unsigned int stack[BVH_STACK_SIZE];
+	int stackSize = 0;
+
+	if (isBoxIntersected(&scene->bvhContainer[0], lightRay, invDir, lightDist, &tNear))
 	{
-		if (isPlaneIntersected(&scene->planeContainer[i], lightRay, &t))
-		{
-			return true;
-		}
+		stack[stackSize++] = 0;
 	}
 
-	// search for cylinder collision
-	float3 normal; // unused here, but it's necessary for the function to work
-	for (unsigned int i = 0; i < scene->numCylinders; ++i)
+	while (stackSize > 0)
 	{
-		if (isCylinderIntersected(&scene->cylinderContainer[i], lightRay, &t, &normal))
+		__global const BVHNode* node = &scene->bvhContainer[stack[--stackSize]];
+
+		if (node->primCount > 0)
 		{
-			return true;
+			for (unsigned int i = node->leftFirst; i < node->leftFirst + node->primCount; ++i)
+			{
+				unsigned int primitive = scene->bvhPrimitiveContainer[i];
+				HEATMAP_COUNT(scene, shadowTests, 1);
+
+				if (primitive & BVH_CYLINDER_FLAG)
+				{
+					if (isCylinderOccluding(scene->primitiveShapeContainer[i], scene->primitiveAxisContainer[i], scene->primitiveRadiusTermContainer[i], lightRay, lightDist))
+					{
+						return true;
+					}
+				}
+				else if (isSphereOccluding(scene->primitiveShapeContainer[i], lightRay, lightDist))
+				{
+					return true;
+				}
+			}
+		}
+		else
+		{
+			if (isBoxIntersected(&scene->bvhContainer[node->leftFirst], lightRay, invDir, lightDist, &tNear))
+			{
+				stack[stackSize++] = node->leftFirst;
+			}
+			if (isBoxIntersected(&scene->bvhContainer[node->leftFirst + 1], lightRay, invDir, lightDist, &tNear))
+			{
+				stack[stackSize++] = node->leftFirst + 1;
+			}
 		}
 	}
 
@@ -69,53 +112,145 @@ bool isInShadow(const Scene* scene, const Ray* lightRay, const float lightDist)
 	return false;
 }
 
-// apply diffuse and specular lighting contributions for all lights in scene taking shadowing into account
-float3 applyLighting(const Scene* scene, const Ray* viewRay, const Intersection* intersect)
+// diffuse and specular lighting from a single light, or black if it's behind the surface or shadowed
+float3 lightContribution(const Scene* scene, const Ray* viewRay, const Intersection* intersect, __global const Light* currentLight)
 {
-	// colour to return (starts as black)
 	float3 output = { 0.0f, 0.0f, 0.0f };
 
-	// same starting point for each light ray
+	// light ray direction need to equal the normalised vector in the direction of the current light
+	// as we need to reuse all the intermediate components for other calculations, 
+	// we calculate the normalised vector by hand instead of using the normalise function
 	Ray lightRay = { intersect->pos };
+	lightRay.dir = currentLight->pos - intersect->pos;
+	float angleBetweenLightAndNormal = dot(lightRay.dir, intersect->normal);
 
-	// loop through all the lights
-	for (unsigned int j = 0; j < scene->numLights; ++j)
+	// no light if it's behind the object (ie. both light and normal pointing in the same direction)
+	if (angleBetweenLightAndNormal <= 0.0f)
 	{
-		// get reference to current light
-		__global const Light* currentLight = &scene->lightContainer[j]; //no longer a pointer.
+		return output;
+	}
+
+	// distance to light from intersection point (and it's inverse)
+	float lightDist = sqrt(dot(lightRay.dir, lightRay.dir));
+	float invLightDist = 1.0f / lightDist;
 
-		// light ray direction need to equal the normalised vector in the direction of the current light
-		// as we need to reuse all the intermediate components for other calculations, 
-		// we calculate the normalised vector by hand instead of using the normalise function
-		lightRay.dir = currentLight->pos - intersect->pos;
-		float angleBetweenLightAndNormal = dot(lightRay.dir, intersect->normal);
+	// light ray projection
+	float lightProjection = invLightDist * angleBetweenLightAndNormal;
+
+	// normalise the light direction
+	lightRay.dir = lightRay.dir * invLightDist;
+
+	if (!isInShadow(scene, &lightRay, lightDist)) {
+		// add diffuse lighting from colour / texture
+		output += applyDiffuse(&lightRay, currentLight, intersect);
+
+		// add specular lighting
+		output += applySpecular(&lightRay, currentLight, lightProjection, viewRay, intersect);
+	}
+
+	return output;
+}
+
+#ifdef LIGHT_SAMPLES
+
+// hash a number to a well mixed one (used to pick lights without keeping any random state)
+uint hashLightSample(uint value)
+{
+	value = (value ^ 61u) ^ (value >> 16);
+	value *= 9u;
+	value = value ^ (value >> 4);
+	value *= 0x27d4eb2du;
+	value = value ^ (value >> 15);
+	return value;
+}
 
-		// skip this light if it's behind the object (ie. both light and normal pointing in the same direction)
-		if (angleBetweenLightAndNormal <= 0.0f)
+// how much a node of the light hierarchy is worth sampling from a point
+// lights don't fall off with distance in this renderer, so it's the node's intensity, or nothing if the whole box is behind the surface
+float lightNodeImportance(__global const LightNode* node, const Intersection* intersect)
+{
+	// corner of the box furthest along the normal
+	float3 furthest;
+	furthest.x = intersect->normal.x > 0.0f ? node->boundsMax.x : node->boundsMin.x;
+	furthest.y = intersect->normal.y > 0.0f ? node->boundsMax.y : node->boundsMin.y;
+	furthest.z = intersect->normal.z > 0.0f ? node->boundsMax.z : node->boundsMin.z;
+	return dot(furthest - intersect->pos, intersect->normal) > 0.0f ? node->intensity : 0.0f;
+}
+
+// apply lighting from LIGHT_SAMPLES lights picked by walking the light hierarchy, choosing each child in proportion to its importance
+// each light's contribution is divided by the chance of picking it, so the average is the same as lighting from every light
+float3 applyLighting(const Scene* scene, const Ray* viewRay, const Intersection* intersect)
+{
+	float3 output = { 0.0f, 0.0f, 0.0f };
+
+	if (NUM_LIGHTS(scene) == 0 || lightNodeImportance(&scene->lightTreeContainer[0], intersect) <= 0.0f)
+	{
+		return output;
+	}
+
+	// seeded from the intersection so that each point picks its own lights
+	uint seed = hashLightSample(as_uint(intersect->pos.x) ^ hashLightSample(as_uint(intersect->pos.y) ^ hashLightSample(as_uint(intersect->pos.z))));
+
+	for (uint k = 0; k < LIGHT_SAMPLES; ++k)
+	{
+		seed = hashLightSample(seed + k);
+		float pdf = 1.0f;
+
+		unsigned int nodeIndex = 0;
+		while (!scene->lightTreeContainer[nodeIndex].isLeaf)
 		{
-			continue;
-		}
+			unsigned int left = scene->lightTreeContainer[nodeIndex].leftFirst;
+			float leftImportance = lightNodeImportance(&scene->lightTreeContainer[left], intersect);
+			float rightImportance = lightNodeImportance(&scene->lightTreeContainer[left + 1], intersect);
 
-		// distance to light from intersection point (and it's inverse)
-		float lightDist = sqrt(dot(lightRay.dir, lightRay.dir));
-		//float lightDist = sqrt(lightRay.dir.dot());
-		float invLightDist = 1.0f / lightDist;
+			// the node's box reached in front of the surface but neither child's does, so none of its lights add anything
+			if (leftImportance + rightImportance <= 0.0f)
+			{
+				pdf = 0.0f;
+				break;
+			}
 
-		// light ray projection
-		float lightProjection = invLightDist * angleBetweenLightAndNormal;
+			float leftChance = leftImportance / (leftImportance + rightImportance);
 
-		// normalise the light direction
-		lightRay.dir = lightRay.dir * invLightDist;
+			// a fresh 24 bit random number for each step down the tree
+			seed = hashLightSample(seed);
+			float random = (seed >> 8) * (1.0f / 16777216.0f);
 
-		if (!isInShadow(scene, &lightRay, lightDist)) {
-			// add diffuse lighting from colour / texture
-			output += applyDiffuse(&lightRay, currentLight, intersect);
+			if (random < leftChance)
+			{
+				nodeIndex = left;
+				pdf *= leftChance;
+			}
+			else
+			{
+				nodeIndex = left + 1;
+				pdf *= 1.0f - leftChance;
+			}
+		}
 
-			// add specular lighting
-			output += applySpecular(&lightRay, currentLight, lightProjection, viewRay, intersect);
+		if (pdf > 0.0f)
+		{
+			output += lightContribution(scene, viewRay, intersect, &scene->lightContainer[scene->lightTreeContainer[nodeIndex].leftFirst]) / pdf;
 		}
+	}
+
+	return output * (1.0f / LIGHT_SAMPLES);
+}
+
+#else
+
+// apply diffuse and specular lighting contributions for all lights in scene taking shadowing into account
+float3 applyLighting(const Scene* scene, const Ray* viewRay, const Intersection* intersect)
+{
+	// colour to return (starts as black)
+	float3 output = { 0.0f, 0.0f, 0.0f };
 
+	// loop through all the lights
+	for (unsigned int j = 0; j < NUM_LIGHTS(scene); ++j)
+	{
+		output += lightContribution(scene, viewRay, intersect, &scene->lightContainer[j]);
 	}
 
 	return output;
 }
+
+#endif // LIGHT_SAMPLES
@@ -7,35 +7,87 @@ It is free to use for educational purpose and cannot be redistributed outside of
 #include "Intersection.h"
 #include "Texturing.h"
 
+// test to see if light ray collides with any of the spheres or cylinders in the hierarchy (the same walk as the kernel's)
+static bool isHierarchyOccluding(const Scene* scene, const Ray* lightRay, const float lightDist)
+{
+	Vector invDir = { 1.0f / lightRay->dir.x, 1.0f / lightRay->dir.y, 1.0f / lightRay->dir.z };
+	float tNear; // unused here, but it's necessary for the function to work
+
+	unsigned int stack[BVH_MAX_DEPTH];
+	int stackSize = 0;
+
+	if (isBoxIntersected(&scene->bvhContainer[0], lightRay, invDir, lightDist, &tNear))
+	{
+		stack[stackSize++] = 0;
+	}
+
+	while (stackSize > 0)
+	{
+		const BVHNode* node = &scene->bvhContainer[stack[--stackSize]];
+
+		if (node->primCount > 0)
+		{
+			for (unsigned int i = node->leftFirst; i < node->leftFirst + node->primCount; ++i)
+			{
+				unsigned int primitive = scene->bvhPrimitiveContainer[i];
+
+				if (primitive & BVH_CYLINDER_FLAG)
+				{
+					if (isCylinderOccluding(&scene->cylinderContainer[primitive & ~BVH_CYLINDER_FLAG], lightRay, lightDist))
+					{
+						return true;
+					}
+				}
+				else if (isSphereOccluding(&scene->sphereContainer[primitive], lightRay, lightDist))
+				{
+					return true;
+				}
+			}
+		}
+		else
+		{
+			if (isBoxIntersected(&scene->bvhContainer[node->leftFirst], lightRay, invDir, lightDist, &tNear))
+			{
+				stack[stackSize++] = node->leftFirst;
+			}
+			if (isBoxIntersected(&scene->bvhContainer[node->leftFirst + 1], lightRay, invDir, lightDist, &tNear))
+			{
+				stack[stackSize++] = node->leftFirst + 1;
+			}
+		}
+	}
+
+	return false;
+}
+
 // test to see if light ray collides with any of the scene's objects
 // short-circuits when first intersection discovered, because no matter what the object will be in shadow
 bool isInShadow(const Scene* scene, const Ray* lightRay, const float lightDist)
 {
-	float t = lightDist;
-
-	// search for sphere collision
-	for (unsigned int i = 0; i < scene->numSpheres; ++i)
+	// search for plane collision
+	for (unsigned int i = 0; i < scene->numPlanes; ++i)
 	{
-		if (isSphereIntersected(&scene->sphereContainer[i], lightRay, &t))
+		if (isPlaneOccluding(&scene->planeContainer[i], lightRay, lightDist))
 		{
 			return true;
 		}
 	}
 
-	// search for plane collision
-	for (unsigned int i = 0; i < scene->numPlanes; ++i)
+	if (scene->numBVHNodes > 0) return isHierarchyOccluding(scene, lightRay, lightDist);
+
+	// search for sphere collision
+	for (unsigned int i = 0; i < scene->numSpheres; ++i)
 	{
-		if (isPlaneIntersected(&scene->planeContainer[i], lightRay, &t))
+		if (isSphereOccluding(&scene->sphereContainer[i], lightRay, lightDist))
 		{
 			return true;
 		}
 	}
 
 	// search for cylinder collision
-	Vector normal; // unused here, but it's necessary for the function to work
 	for (unsigned int i = 0; i < scene->numCylinders; ++i)
 	{
-		if (isCylinderIntersected(&scene->cylinderContainer[i], lightRay, &t, &normal))
+		if (isCylinderOccluding(&scene->cylinderContainer[i], lightRay, lightDist))
 		{
 			return true;
 		}
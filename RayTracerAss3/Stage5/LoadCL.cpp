@@ -4,33 +4,181 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
 #include "LoadCL.h"
 
-cl_program clLoadSource(cl_context context, char* filename, cl_int* err)
+// programs already built this run, keyed on the same hash as the disk cache plus the context (a program only works in its own context)
+static std::map<unsigned long long, cl_program> programCache;
+
+// 64-bit FNV-1a, continuing from hash
+static unsigned long long hashBytes(unsigned long long hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+// add a string device property to the hash (a new driver can't load an old driver's binaries)
+static unsigned long long hashDeviceInfo(unsigned long long hash, cl_device_id device, cl_device_info param)
+{
+	char value[1024];
+	size_t size = 0;
+	if (clGetDeviceInfo(device, param, sizeof(value), value, &size) != CL_SUCCESS) size = 0;
+	return hashBytes(hash, value, size);
+}
+
+// read a whole file, returning NULL if it doesn't exist
+static unsigned char* readFile(const char* filename, size_t* size)
+{
+	FILE* file = fopen(filename, "rb");
+	if (file == NULL) return NULL;
+
+	fseek(file, 0, SEEK_END);
+	*size = ftell(file);
+	rewind(file);
+
+	unsigned char* data = (unsigned char*)malloc(*size);
+	if (data == NULL || fread(data, 1, *size, file) != *size)
+	{
+		free(data);
+		data = NULL;
+	}
+	fclose(file);
+
+	return data;
+}
+
+// try to create and build the program from a cached binary
+static cl_program loadCachedBinary(cl_context context, cl_device_id device, const char* filename, const char* options)
+{
+	size_t size;
+	unsigned char* binary = readFile(filename, &size);
+	if (binary == NULL) return NULL;
+
+	cl_int binaryStatus, err;
+	cl_program program = clCreateProgramWithBinary(context, 1, &device, &size, (const unsigned char**)&binary, &binaryStatus, &err);
+	free(binary);
+
+	if (err != CL_SUCCESS) return NULL;
+	if (binaryStatus != CL_SUCCESS)
+	{
+		clReleaseProgram(program);
+		return NULL;
+	}
+
+	// binaries still have to be built, but this skips compiling the source
+	if (clBuildProgram(program, 1, &device, options, NULL, NULL) != CL_SUCCESS)
+	{
+		clReleaseProgram(program);
+		return NULL;
+	}
+
+	return program;
+}
+
+// put a finished file in place of filename, replacing any that's there
+static bool replaceFile(const char* from, const char* filename)
+{
+#ifdef _WIN32
+	return MoveFileExA(from, filename, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(from, filename) == 0;
+#endif
+}
+
+// write the built program's binary to the cache (failing quietly, it just gets rebuilt next time)
+// it's written to a file of this process's own first and then renamed into place, so another run never reads half a binary
+static void saveCachedBinary(cl_program program, const char* filename)
 {
-	cl_program program;
-	FILE *program_handle;
-	char *program_buffer;
-	size_t program_size;
+	size_t size = 0;
+	if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &size, NULL) != CL_SUCCESS || size == 0) return;
 
-	program_handle = fopen(filename, "rb");
-	if (program_handle == NULL) {
-		printf("Couldn't find the program file\n");
-		exit(1);
+	unsigned char* binary = (unsigned char*)malloc(size);
+	if (binary == NULL) return;
+
+	if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(unsigned char*), &binary, NULL) == CL_SUCCESS)
+	{
+#ifdef _WIN32
+		unsigned long process = GetCurrentProcessId();
+#else
+		unsigned long process = (unsigned long)getpid();
+#endif
+		char temporary[1024];
+		snprintf(temporary, sizeof(temporary), "%s.%lu.tmp", filename, process);
+
+		FILE* file = fopen(temporary, "wb");
+		if (file != NULL)
+		{
+			bool written = fwrite(binary, 1, size, file) == size;
+			if (fclose(file) != 0 || !written || !replaceFile(temporary, filename)) remove(temporary);
+		}
 	}
-	fseek(program_handle, 0, SEEK_END);
-	program_size = ftell(program_handle);
-	rewind(program_handle);
-	program_buffer = (char*)malloc(program_size + 1);
-	if (program_buffer)
+	free(binary);
+}
+
+cl_program clBuildProgramCached(cl_context context, cl_device_id device, const char* source, const char* options, const char* cacheDir, ProgramOrigin* origin, cl_int* err)
+{
+	unsigned long long hash = 0xcbf29ce484222325ULL;
+	hash = hashBytes(hash, source, strlen(source) + 1);
+	hash = hashBytes(hash, options, strlen(options) + 1);
+	hash = hashDeviceInfo(hash, device, CL_DEVICE_NAME);
+	hash = hashDeviceInfo(hash, device, CL_DEVICE_VERSION);
+	hash = hashDeviceInfo(hash, device, CL_DRIVER_VERSION);
+
+	unsigned long long memoryKey = hashBytes(hash, &context, sizeof(context));
+	std::map<unsigned long long, cl_program>::iterator cached = programCache.find(memoryKey);
+	if (cached != programCache.end())
 	{
-		program_buffer[program_size] = '\0';
-		fread(program_buffer, sizeof(char), program_size, program_handle);
+		*origin = PROGRAM_FROM_MEMORY;
+		*err = CL_SUCCESS;
+		return cached->second;
+	}
+
+	char filename[1024] = "";
+	if (cacheDir != NULL)
+	{
+		sprintf(filename, "%sRaytrace_%016llx.clbin", cacheDir, hash);
+
+		cl_program program = loadCachedBinary(context, device, filename, options);
+		if (program != NULL)
+		{
+			programCache[memoryKey] = program;
+			*origin = PROGRAM_FROM_DISK_CACHE;
+			*err = CL_SUCCESS;
+			return program;
+		}
 	}
-	fclose(program_handle);
 
-	program = clCreateProgramWithSource(context, 1, (const char**)&program_buffer, &program_size, err);
-	free(program_buffer);
+	*origin = PROGRAM_FROM_SOURCE;
 
+	cl_program program = clCreateProgramWithSource(context, 1, &source, NULL, err);
+	if (*err != CL_SUCCESS) return NULL;
+
+	*err = clBuildProgram(program, 1, &device, options, NULL, NULL);
+	if (*err != CL_SUCCESS) return program;
+
+	if (cacheDir != NULL) saveCachedBinary(program, filename);
+
+	programCache[memoryKey] = program;
 	return program;
 }
+
+void clReleaseProgramCache()
+{
+	for (std::map<unsigned long long, cl_program>::iterator it = programCache.begin(); it != programCache.end(); ++it)
+		clReleaseProgram(it->second);
+	programCache.clear();
+}
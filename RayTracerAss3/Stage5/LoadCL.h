@@ -5,6 +5,16 @@
 #undef CL_VERSION_2_0
 #include <CL/cl.h>
 
-cl_program clLoadSource(cl_context context, char* filename, cl_int* err);
+// where clBuildProgramCached got a program from
+enum ProgramOrigin { PROGRAM_FROM_MEMORY, PROGRAM_FROM_DISK_CACHE, PROGRAM_FROM_SOURCE };
 
-#endif
\ No newline at end of file
+// build a program from source text with the given options
+// programs are reused from earlier calls this run on the same context, then from binaries cached on disk in cacheDir (NULL disables the disk cache),
+// both keyed on a hash of the source, options and device; a fresh build from source is written back to the disk cache
+// on a failed build err holds the error and the program is returned (uncached) so its build log can be read
+cl_program clBuildProgramCached(cl_context context, cl_device_id device, const char* source, const char* options, const char* cacheDir, ProgramOrigin* origin, cl_int* err);
+
+// release every program held by the build cache
+void clReleaseProgramCache();
+
+#endif
@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "MultiDevice.h"
+#include "Streamed.h"
+#include "BVH.h"
+#include "LightTree.h"
+#include "EmbeddedCL.h"
+
+// create a read only buffer holding a copy of data (size 0 gets a placeholder, as buffers can't be empty)
+static cl_mem createInputBuffer(cl_context context, size_t size, const void* data, const char* name)
+{
+	cl_float4 placeholder = {};
+	if (size == 0)
+	{
+		size = sizeof(placeholder);
+		data = &placeholder;
+	}
+
+	cl_int err;
+	cl_mem buffer = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, size, (void*)data, &err);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't create the %s buffer -> %d\n", name, err);
+		exit(1);
+	}
+	return buffer;
+}
+
+void createSceneBuffers(cl_context context, const Scene& scene, cl_mem sceneBuffers[NUM_SCENE_BUFFERS])
+{
+	size_t numPrimitives = scene.numSpheres + scene.numCylinders;
+	size_t numReferences = scene.numBVHNodes > 0 ? numPrimitives : 0;
+
+	sceneBuffers[0] = createInputBuffer(context, sizeof(Scene), &scene, "scene");
+	sceneBuffers[1] = createInputBuffer(context, sizeof(Material) * scene.numMaterials, scene.materialContainer, "material");
+	sceneBuffers[2] = createInputBuffer(context, sizeof(Light) * scene.numLights, scene.lightContainer, "light");
+	sceneBuffers[3] = createInputBuffer(context, sizeof(Sphere) * scene.numSpheres, scene.sphereContainer, "sphere");
+	sceneBuffers[4] = createInputBuffer(context, sizeof(Plane) * scene.numPlanes, scene.planeContainer, "plane");
+	sceneBuffers[5] = createInputBuffer(context, sizeof(Cylinder) * scene.numCylinders, scene.cylinderContainer, "cylinder");
+	sceneBuffers[6] = createInputBuffer(context, sizeof(BVHNode) * scene.numBVHNodes, scene.bvhContainer, "BVH node");
+	sceneBuffers[7] = createInputBuffer(context, sizeof(unsigned int) * numReferences, scene.bvhPrimitiveContainer, "BVH primitive");
+	sceneBuffers[8] = createInputBuffer(context, sizeof(cl_float4) * numPrimitives, scene.primitiveShapeContainer, "primitive shape");
+	sceneBuffers[9] = createInputBuffer(context, sizeof(cl_float4) * numPrimitives, scene.primitiveAxisContainer, "primitive axis");
+	sceneBuffers[10] = createInputBuffer(context, sizeof(float) * numPrimitives, scene.primitiveRadiusTermContainer, "primitive radius");
+	sceneBuffers[11] = createInputBuffer(context, sizeof(LightNode) * scene.numLightNodes, scene.lightTreeContainer, "light hierarchy");
+}
+
+static void setKernelArg(cl_kernel kernel, cl_uint index, size_t size, const void* value)
+{
+	cl_int err = clSetKernelArg(kernel, index, size, value);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't set the kernel(%u) argument = %d\n", index, err);
+		exit(1);
+	}
+}
+
+void createMultiDevice(MultiDevice& multi, const std::vector<RenderTarget>& targets, int hostThreads)
+{
+	HostWorker idle = { 0, 0, 0.0 };
+	multi.hostWorkers.assign(hostThreads, idle);
+
+	multi.devices.resize(targets.size());
+	for (size_t i = 0; i < targets.size(); ++i)
+	{
+		RenderDevice& device = multi.devices[i];
+		device.target = targets[i];
+		device.program = NULL;
+		device.kernel = NULL;
+		device.tiles = 0;
+		device.pixels = 0;
+		device.milliseconds = 0.0;
+
+		cl_int err;
+		device.context = clCreateContext(NULL, 1, &device.target.device, NULL, NULL, &err);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't create a context on %s\n", device.target.name.c_str());
+			exit(1);
+		}
+
+		device.queue = clCreateCommandQueue(device.context, device.target.device, 0, &err);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't create the command queue on %s\n", device.target.name.c_str());
+			exit(1);
+		}
+
+		// as with a single device, tiles are read back on their own queue so the copy overlaps rendering the next tile
+		device.readQueue = clCreateCommandQueue(device.context, device.target.device, 0, &err);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't create the read command queue on %s\n", device.target.name.c_str());
+			exit(1);
+		}
+	}
+}
+
+void buildMultiDevice(MultiDevice& multi, const char* options, const char* cacheDir)
+{
+	for (size_t i = 0; i < multi.devices.size(); ++i)
+	{
+		RenderDevice& device = multi.devices[i];
+
+		cl_int err;
+		ProgramOrigin programOrigin;
+		device.program = clBuildProgramCached(device.context, device.target.device, embeddedRaytraceCL, options, cacheDir, &programOrigin, &err);
+		if (device.program == NULL) {
+			printf("Couldn't load/create the program on %s\n", device.target.name.c_str());
+			exit(1);
+		}
+		if (err != CL_SUCCESS) {
+			size_t logSize;
+			clGetProgramBuildInfo(device.program, device.target.device, CL_PROGRAM_BUILD_LOG, 0, NULL, &logSize);
+			std::string log(logSize, '\0');
+			clGetProgramBuildInfo(device.program, device.target.device, CL_PROGRAM_BUILD_LOG, logSize, &log[0], NULL);
+			printf("%s: %s\n", device.target.name.c_str(), log.c_str());
+			exit(1);
+		}
+
+		device.kernel = clCreateKernel(device.program, "func", &err);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't create the kernel on %s\n", device.target.name.c_str());
+			exit(1);
+		}
+
+		printf("program build (%s): %s\n", device.target.name.c_str(),
+			programOrigin == PROGRAM_FROM_SOURCE ? "cold, compiled from source" : "warm, loaded cached binary");
+	}
+}
+
+void uploadMultiDevice(MultiDevice& multi, const Scene& scene, int width, int height, int aaLevel, int blockSize)
+{
+	multi.scene = &scene;
+	multi.width = width;
+	multi.height = height;
+	multi.aaLevel = aaLevel;
+	multi.blockSize = blockSize;
+
+	for (size_t i = 0; i < multi.devices.size(); ++i)
+	{
+		RenderDevice& device = multi.devices[i];
+		createSceneBuffers(device.context, scene, device.sceneBuffers);
+
+		// func writes each pixel at its row of the image less outFirstRow, so a tile buffer holds a tile's rows across the whole width
+		for (int slot = 0; slot < MAX_TILES_IN_FLIGHT; ++slot)
+		{
+			cl_int err;
+			device.tileBuffers[slot] = clCreateBuffer(device.context, CL_MEM_WRITE_ONLY, sizeof(int) * width * std::min(blockSize, height), NULL, &err);
+			if (err != CL_SUCCESS) {
+				printf("Couldn't create a tile buffer on %s -> %d\n", device.target.name.c_str(), err);
+				exit(1);
+			}
+		}
+
+		// func takes the scene first, then the image size and sample grid, then the rest of the scene buffers
+		setKernelArg(device.kernel, 0, sizeof(cl_mem), &device.sceneBuffers[0]);
+		setKernelArg(device.kernel, 1, sizeof(int), &width);
+		setKernelArg(device.kernel, 2, sizeof(int), &height);
+		setKernelArg(device.kernel, 3, sizeof(int), &aaLevel);
+		for (int j = 1; j < NUM_SCENE_BUFFERS; ++j) setKernelArg(device.kernel, j + 3, sizeof(cl_mem), &device.sceneBuffers[j]);
+	}
+}
+
+// take tiles from nextTile until there are none left, rendering each into a free tile buffer and reading it back into its place in buffer
+static void renderDeviceTiles(MultiDevice& multi, RenderDevice& device, std::atomic<int>& nextTile, unsigned int* buffer,
+	std::chrono::steady_clock::time_point start)
+{
+	cl_int err;
+
+	int tilesX = (multi.width + multi.blockSize - 1) / multi.blockSize;
+	int tilesY = (multi.height + multi.blockSize - 1) / multi.blockSize;
+	int numOfTiles = tilesX * tilesY;
+
+	// read back of each tile buffer in flight
+	cl_event readEvents[MAX_TILES_IN_FLIGHT];
+	int taken = 0;
+	long long pixels = 0;
+
+	for (;;) {
+		// a tile is only taken once there's a buffer free for it, so a busy device leaves it for one that's ready
+		int slot = taken % MAX_TILES_IN_FLIGHT;
+		if (taken >= MAX_TILES_IN_FLIGHT) {
+			clWaitForEvents(1, &readEvents[slot]);
+			clReleaseEvent(readEvents[slot]);
+		}
+
+		int j = nextTile.fetch_add(1);
+		if (j >= numOfTiles) {
+			// the slot's read was already waited for, so don't wait for it again below
+			if (taken >= MAX_TILES_IN_FLIGHT) readEvents[slot] = NULL;
+			break;
+		}
+
+		size_t tileX = (size_t)(j % tilesX) * multi.blockSize;
+		size_t tileY = (size_t)(j / tilesX) * multi.blockSize;
+		size_t workOffset[] = { tileX, tileY };
+		size_t workSize[] = { std::min((size_t)multi.blockSize, multi.width - tileX), std::min((size_t)multi.blockSize, multi.height - tileY) };
+
+		int outFirstRow = (int)tileY;
+		setKernelArg(device.kernel, FUNC_OUT_ARG, sizeof(cl_mem), &device.tileBuffers[slot]);
+		setKernelArg(device.kernel, FUNC_OUT_FIRST_ROW_ARG, sizeof(int), &outFirstRow);
+
+		cl_event kernelEvent;
+		err = clEnqueueNDRangeKernel(device.queue, device.kernel, 2, workOffset, workSize, NULL, 0, NULL, &kernelEvent);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't enqueue the kernel execution (%d) command on %s = %d\n", j, device.target.name.c_str(), err);
+			exit(1);
+		}
+		clFlush(device.queue);
+
+		// the tile is at the top of its buffer and at its own row of the image
+		size_t bufferOrigin[] = { tileX * sizeof(int), 0, 0 };
+		size_t hostOrigin[] = { tileX * sizeof(int), tileY, 0 };
+		size_t region[] = { workSize[0] * sizeof(int), workSize[1], 1 };
+		err = clEnqueueReadBufferRect(device.readQueue, device.tileBuffers[slot], CL_FALSE, bufferOrigin, hostOrigin, region,
+			sizeof(int) * multi.width, 0, sizeof(int) * multi.width, 0, buffer, 1, &kernelEvent, &readEvents[slot]);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't enqueue the read buffer (%d) command on %s = %d\n", j, device.target.name.c_str(), err);
+			exit(1);
+		}
+		clFlush(device.readQueue);
+		clReleaseEvent(kernelEvent);
+
+		++taken;
+		pixels += (long long)workSize[0] * workSize[1];
+	}
+
+	// wait for the last tiles to finish reading back
+	for (int j = std::max(0, taken - MAX_TILES_IN_FLIGHT); j < taken; j++) {
+		cl_event readEvent = readEvents[j % MAX_TILES_IN_FLIGHT];
+		if (readEvent == NULL) continue;
+		clWaitForEvents(1, &readEvent);
+		clReleaseEvent(readEvent);
+	}
+
+	device.tiles = taken;
+	device.pixels = pixels;
+	device.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// take tiles from nextTile until there are none left, rendering each straight into its place in buffer with the C++ traceRay
+static void renderHostTiles(MultiDevice& multi, HostWorker& worker, std::atomic<int>& nextTile, unsigned int* buffer,
+	std::chrono::steady_clock::time_point start)
+{
+	int tilesX = (multi.width + multi.blockSize - 1) / multi.blockSize;
+	int tilesY = (multi.height + multi.blockSize - 1) / multi.blockSize;
+	int numOfTiles = tilesX * tilesY;
+
+	worker.tiles = 0;
+	worker.pixels = 0;
+	for (int j = nextTile.fetch_add(1); j < numOfTiles; j = nextTile.fetch_add(1)) {
+		int tileX = (j % tilesX) * multi.blockSize;
+		int tileY = (j / tilesX) * multi.blockSize;
+		int tileWidth = std::min(multi.blockSize, multi.width - tileX);
+		int tileHeight = std::min(multi.blockSize, multi.height - tileY);
+
+		renderTileHost(multi.scene, multi.width, multi.height, multi.aaLevel, tileX, tileY, tileWidth, tileHeight, buffer);
+
+		worker.tiles++;
+		worker.pixels += (long long)tileWidth * tileHeight;
+	}
+
+	worker.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void renderMultiDevice(MultiDevice& multi, unsigned int* buffer)
+{
+	std::atomic<int> nextTile(0);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// each device is fed by its own host thread, and the host workers render beside them
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < multi.devices.size(); ++i)
+		threads.push_back(std::thread(renderDeviceTiles, std::ref(multi), std::ref(multi.devices[i]), std::ref(nextTile), buffer, start));
+	for (size_t i = 0; i < multi.hostWorkers.size(); ++i)
+		threads.push_back(std::thread(renderHostTiles, std::ref(multi), std::ref(multi.hostWorkers[i]), std::ref(nextTile), buffer, start));
+
+	for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+}
+
+// print one backend's share of the tiles, and its throughput over the time it was busy
+static void printShare(const char* name, int tiles, long long pixels, double milliseconds, int numOfTiles, int aaLevel)
+{
+	double samples = (double)pixels * aaLevel * aaLevel;
+	printf("%s: %d of %d tiles (%.1f%%), %.2f ms per tile, %.2f Msamples/s\n", name, tiles, numOfTiles,
+		numOfTiles > 0 ? 100.0 * tiles / numOfTiles : 0.0, tiles > 0 ? milliseconds / tiles : 0.0,
+		milliseconds > 0.0 ? samples / (milliseconds * 1000.0) : 0.0);
+}
+
+void printMultiDeviceShare(const MultiDevice& multi)
+{
+	int numOfTiles = 0;
+	for (size_t i = 0; i < multi.devices.size(); ++i) numOfTiles += multi.devices[i].tiles;
+	for (size_t i = 0; i < multi.hostWorkers.size(); ++i) numOfTiles += multi.hostWorkers[i].tiles;
+
+	for (size_t i = 0; i < multi.devices.size(); ++i)
+	{
+		const RenderDevice& device = multi.devices[i];
+		printShare(device.target.name.c_str(), device.tiles, device.pixels, device.milliseconds, numOfTiles, multi.aaLevel);
+	}
+
+	// the host workers count as one backend, busy until the last of them finished
+	if (!multi.hostWorkers.empty())
+	{
+		int tiles = 0;
+		long long pixels = 0;
+		double milliseconds = 0.0;
+		for (size_t i = 0; i < multi.hostWorkers.size(); ++i)
+		{
+			tiles += multi.hostWorkers[i].tiles;
+			pixels += multi.hostWorkers[i].pixels;
+			milliseconds = std::max(milliseconds, multi.hostWorkers[i].milliseconds);
+		}
+
+		std::string name = "host (" + std::to_string(multi.hostWorkers.size()) + " threads)";
+		printShare(name.c_str(), tiles, pixels, milliseconds, numOfTiles, multi.aaLevel);
+	}
+}
+
+void releaseMultiDevice(MultiDevice& multi)
+{
+	for (size_t i = 0; i < multi.devices.size(); ++i)
+	{
+		RenderDevice& device = multi.devices[i];
+		for (int j = 0; j < NUM_SCENE_BUFFERS; ++j) clReleaseMemObject(device.sceneBuffers[j]);
+		for (int slot = 0; slot < MAX_TILES_IN_FLIGHT; ++slot) clReleaseMemObject(device.tileBuffers[slot]);
+		clReleaseKernel(device.kernel);
+		clReleaseCommandQueue(device.queue);
+		clReleaseCommandQueue(device.readQueue);
+		clReleaseContext(device.context);
+	}
+	multi.devices.clear();
+	multi.hostWorkers.clear();
+}
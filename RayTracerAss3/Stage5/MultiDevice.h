@@ -0,0 +1,74 @@
+#ifndef __MULTIDEVICE_H
+#define __MULTIDEVICE_H
+
+#include <string>
+#include <vector>
+#include "LoadCL.h"
+#include "Devices.h"
+#include "Constants.h"
+#include "Wavefront.h"
+#include "Scene.h"
+
+// everything one device needs to render tiles with func (each device gets its own context, so nothing is shared between them)
+typedef struct RenderDevice
+{
+	RenderTarget target;
+
+	cl_context context;
+	cl_command_queue queue;
+	cl_command_queue readQueue;
+	cl_program program;
+	cl_kernel kernel;
+
+	cl_mem sceneBuffers[NUM_SCENE_BUFFERS];
+	cl_mem tileBuffers[MAX_TILES_IN_FLIGHT];	// rows of the image a tile covers (one per tile in flight)
+
+	int tiles;					// tiles rendered in the last run
+	long long pixels;			// pixels in those tiles
+	double milliseconds;		// from the start of the last run until this device's last tile was read back
+} RenderDevice;
+
+// a host thread rendering tiles with the C++ traceRay alongside the devices
+typedef struct HostWorker
+{
+	int tiles;					// tiles rendered in the last run
+	long long pixels;			// pixels in those tiles
+	double milliseconds;		// from the start of the last run until this thread finished its last tile
+} HostWorker;
+
+// the devices (and host threads) tiles are shared between
+typedef struct MultiDevice
+{
+	std::vector<RenderDevice> devices;
+	std::vector<HostWorker> hostWorkers;
+
+	const Scene* scene;
+	int width, height, aaLevel, blockSize;
+} MultiDevice;
+
+// create a context and queues on each target, and hostThreads host workers (0 for none)
+void createMultiDevice(MultiDevice& multi, const std::vector<RenderTarget>& targets, int hostThreads);
+
+// build func for each device (with the program cache, so identical devices after the first load the cached binary)
+void buildMultiDevice(MultiDevice& multi, const char* options, const char* cacheDir);
+
+// copy the scene to each device, make its tile buffers and set func's arguments (the host workers read scene itself, so it has to outlive them)
+void uploadMultiDevice(MultiDevice& multi, const Scene& scene, int width, int height, int aaLevel, int blockSize);
+
+// render the image into buffer (width * height), each device taking the next tile from a shared counter whenever it has a slot free
+// and each host worker whenever it's finished its last tile, so faster devices (and the host, if it's faster) take more of the tiles
+void renderMultiDevice(MultiDevice& multi, unsigned int* buffer);
+
+// print how many tiles each device (and the host workers together) took in the last run and how fast they got through them
+void printMultiDeviceShare(const MultiDevice& multi);
+
+// release every device's buffers, kernel, queues and context (the programs belong to the program cache)
+void releaseMultiDevice(MultiDevice& multi);
+
+// render a tile of the image on the host with the C++ traceRay (in Raytrace.cpp), into its place in image
+void renderTileHost(const Scene* scene, int width, int height, int aaLevel, int tileX, int tileY, int tileWidth, int tileHeight, unsigned int* image);
+
+// create the scene buffers (in the order the wavefront, adaptive and progressive kernels take them) on a context
+void createSceneBuffers(cl_context context, const Scene& scene, cl_mem sceneBuffers[NUM_SCENE_BUFFERS]);
+
+#endif // __MULTIDEVICE_H
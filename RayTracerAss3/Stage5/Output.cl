@@ -17,6 +17,7 @@ void OutputInfo(const Scene* scene)
 	printf("sizeof(Plane):    %d\n", sizeof(Plane));
 	printf("sizeof(Cylinder): %d\n", sizeof(Cylinder));
 	printf("sizeof(Material): %d\n", sizeof(Material));
+	printf("sizeof(BVHNode):  %d\n", sizeof(BVHNode));
 	printf("sizeof(Scene):    %d\n", sizeof(Scene));
 
 	printf("\n--- Scene:\n");;
@@ -74,6 +75,8 @@ void OutputInfo(const Scene* scene)
 		);
 	}
 
+	printf("\n--- BVH: %d nodes\n", scene->numBVHNodes);
+
 	printf("\n--- Lights (%d):\n", scene->numLights);
 	for (unsigned int i = 0; i < scene->numLights; ++i)
 	{
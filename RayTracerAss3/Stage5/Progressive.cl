@@ -0,0 +1,40 @@
+﻿// progressive rendering (selected with -progressive)
+// each pass adds one more sample of every pixel's grid to a running sum, which can be turned into an image after any pass
+
+// add one sample of each pixel's aaLevel x aaLevel grid to its sum (in xyz, with the number of samples in w)
+// the first pass starts the sums again
+__kernel void progressivePass(WAVEFRONT_SCENE_PARAMS, int width, int height, int aaLevel, int sample, int firstPass, __global float4* accumulation)
+{
+	Scene scene = bindScene(WAVEFRONT_SCENE_ARGS);
+
+#ifdef AA_LEVEL
+	aaLevel = AA_LEVEL;
+#endif
+
+	int ix = get_global_id(0);
+	int iy = get_global_id(1);
+	int pixel = iy * width + ix;
+
+	float4 sum = firstPass ? (float4)(0.0f, 0.0f, 0.0f, 0.0f) : accumulation[pixel];
+
+	// same sub-locations as func uses (grids that aren't a power of two can miss one)
+	float fragmentx, fragmenty;
+	if (getSample(ix - (width / 2), iy - (height / 2), sample, aaLevel, aaLevel, &fragmentx, &fragmenty))
+	{
+		// angle between each successive ray cast (per pixel, anti-aliasing uses a fraction of this)
+		const float dirStepSize = 1.0f / (0.5f * width / tan(PIOVER180 * 0.5f * scene.cameraFieldOfView));
+
+		sum += (float4)(traceRay(&scene, cameraRay(&scene, fragmentx, fragmenty, dirStepSize)), 1.0f);
+	}
+
+	accumulation[pixel] = sum;
+}
+
+// turn the sums into pixels (the average of each pixel's samples so far)
+__kernel void progressiveResolve(__global struct Scene* scenein, int width, __global const float4* accumulation, __global int* out)
+{
+	int pixel = get_global_id(1) * width + get_global_id(0);
+	float4 sum = accumulation[pixel];
+
+	out[pixel] = convertToPixel(sum.xyz / max(sum.w, 1.0f), scenein->exposure);
+}
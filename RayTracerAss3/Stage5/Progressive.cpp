@@ -0,0 +1,187 @@
+#pragma warning(disable: 4996)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include "Progressive.h"
+#include "ImageIO.h"
+
+// create a kernel from the program, exiting if it can't be found
+static cl_kernel createKernel(cl_program program, const char* name)
+{
+	cl_int err;
+	cl_kernel kernel = clCreateKernel(program, name, &err);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't create the %s kernel = %d\n", name, err);
+		exit(1);
+	}
+
+	return kernel;
+}
+
+// set a kernel argument, exiting if it can't be set
+static void setArg(cl_kernel kernel, cl_uint index, size_t size, const void* value)
+{
+	cl_int err = clSetKernelArg(kernel, index, size, value);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't set the progressive kernel(%d) argument = %d\n", index, err);
+		exit(1);
+	}
+}
+
+static int greatestCommonDivisor(int a, int b)
+{
+	while (b != 0)
+	{
+		int remainder = a % b;
+		a = b;
+		b = remainder;
+	}
+	return a;
+}
+
+// which sample of the grid a pass renders, ordered so that stopping after any pass leaves samples spread over the pixel
+static int passSample(int pass, int aaLevel)
+{
+	int numSamples = aaLevel * aaLevel;
+
+	if ((aaLevel & (aaLevel - 1)) == 0)
+	{
+		// powers of two alternate the pass's bits between the x and y positions, reversed so the first passes land far apart
+		int bits = 0;
+		while ((1 << bits) < aaLevel) ++bits;
+
+		int x = 0, y = 0;
+		for (int b = 0; b < bits; ++b)
+		{
+			x |= ((pass >> (2 * b)) & 1) << (bits - 1 - b);
+			y |= ((pass >> (2 * b + 1)) & 1) << (bits - 1 - b);
+		}
+		return x * aaLevel + y;
+	}
+
+	// anything else steps through the grid by a stride with no factors in common with its size (so every sample comes up once)
+	int stride = numSamples * 5 / 8 + 1;
+	while (greatestCommonDivisor(stride, numSamples) != 1) ++stride;
+	return (int)((long long)pass * stride % numSamples);
+}
+
+// milliseconds since a time
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void createProgressive(Progressive& progressive, cl_context context, cl_program program, const cl_mem sceneBuffers[NUM_SCENE_BUFFERS], cl_mem outBuffer,
+	int width, int height, int aaLevel)
+{
+	cl_int err;
+
+	progressive.width = width;
+	progressive.height = height;
+	progressive.aaLevel = aaLevel;
+
+	progressive.passKernel = createKernel(program, "progressivePass");
+	progressive.resolveKernel = createKernel(program, "progressiveResolve");
+
+	progressive.accumulationBuffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(cl_float4) * width * height, NULL, &err);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't create the progressive accumulation buffer -> %d\n", err);
+		exit(1);
+	}
+
+	// arguments that don't change between passes (the sample and whether it's the first pass are set for each one)
+	for (int i = 0; i < NUM_SCENE_BUFFERS; ++i)
+	{
+		setArg(progressive.passKernel, i, sizeof(cl_mem), &sceneBuffers[i]);
+	}
+	setArg(progressive.passKernel, NUM_SCENE_BUFFERS + 0, sizeof(int), &width);
+	setArg(progressive.passKernel, NUM_SCENE_BUFFERS + 1, sizeof(int), &height);
+	setArg(progressive.passKernel, NUM_SCENE_BUFFERS + 2, sizeof(int), &aaLevel);
+	setArg(progressive.passKernel, NUM_SCENE_BUFFERS + 5, sizeof(cl_mem), &progressive.accumulationBuffer);
+
+	setArg(progressive.resolveKernel, 0, sizeof(cl_mem), &sceneBuffers[0]);
+	setArg(progressive.resolveKernel, 1, sizeof(int), &width);
+	setArg(progressive.resolveKernel, 2, sizeof(cl_mem), &progressive.accumulationBuffer);
+	setArg(progressive.resolveKernel, 3, sizeof(cl_mem), &outBuffer);
+}
+
+int renderProgressive(Progressive& progressive, cl_command_queue queue, cl_mem outBuffer, const ProgressiveBudget& budget, unsigned int* image, Trace* trace, int run)
+{
+	cl_int err;
+	size_t size[] = { (size_t)progressive.width, (size_t)progressive.height };
+
+	// intermediate images go beside the output image
+	std::string stem(budget.intermediateFilename != NULL ? budget.intermediateFilename : "");
+	size_t extension = stem.rfind(".bmp");
+	if (extension != std::string::npos && extension == stem.size() - 4) stem.erase(extension);
+
+	int pass = 0;
+	double firstPassStart = millisecondsSince(budget.start);
+
+	while (pass < budget.targetSamples)
+	{
+		// going by the passes so far, stop if the next one wouldn't finish in time
+		if (budget.timeLimit > 0.0 && pass > 0)
+		{
+			double elapsed = millisecondsSince(budget.start);
+			double averagePass = (elapsed - firstPassStart) / pass;
+			if (elapsed + averagePass > budget.timeLimit) break;
+		}
+
+		int sample = passSample(pass, progressive.aaLevel);
+		int firstPass = pass == 0;
+		setArg(progressive.passKernel, NUM_SCENE_BUFFERS + 3, sizeof(int), &sample);
+		setArg(progressive.passKernel, NUM_SCENE_BUFFERS + 4, sizeof(int), &firstPass);
+
+		cl_event passEvent;
+		err = clEnqueueNDRangeKernel(queue, progressive.passKernel, 2, NULL, size, NULL, 0, NULL, &passEvent);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't enqueue the progressive pass (%d) command = %d\n", pass, err);
+			exit(1);
+		}
+		clFlush(queue);
+
+		if (trace != NULL) trace->deviceCommand("progressive pass", TRACK_KERNELS, passEvent, passEvent, run, pass, 0, 0);
+
+		// the time limit needs to know how long the pass took, otherwise passes queue up back to back
+		if (budget.timeLimit > 0.0) clWaitForEvents(1, &passEvent);
+		clReleaseEvent(passEvent);
+		++pass;
+
+		if (budget.intermediateEvery > 0 && pass % budget.intermediateEvery == 0 && pass < budget.targetSamples)
+		{
+			resolveProgressive(progressive, queue, NULL);
+			err = clEnqueueReadBuffer(queue, outBuffer, CL_TRUE, 0, sizeof(int) * progressive.width * progressive.height, image, 0, NULL, NULL);
+			if (err != CL_SUCCESS) {
+				printf("Couldn't read the intermediate image = %d\n", err);
+				exit(1);
+			}
+
+			char suffix[32];
+			sprintf(suffix, "_pass%04d.bmp", pass);
+			write_bmp((stem + suffix).c_str(), image, progressive.width, progressive.height, progressive.width);
+		}
+	}
+
+	clFinish(queue);
+	return pass;
+}
+
+void resolveProgressive(Progressive& progressive, cl_command_queue queue, cl_event* finished)
+{
+	size_t size[] = { (size_t)progressive.width, (size_t)progressive.height };
+	cl_int err = clEnqueueNDRangeKernel(queue, progressive.resolveKernel, 2, NULL, size, NULL, 0, NULL, finished);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't enqueue the progressive resolve command = %d\n", err);
+		exit(1);
+	}
+}
+
+void releaseProgressive(Progressive& progressive)
+{
+	clReleaseKernel(progressive.passKernel);
+	clReleaseKernel(progressive.resolveKernel);
+
+	clReleaseMemObject(progressive.accumulationBuffer);
+}
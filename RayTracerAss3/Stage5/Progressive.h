@@ -0,0 +1,46 @@
+#ifndef __PROGRESSIVE_H
+#define __PROGRESSIVE_H
+
+#include <chrono>
+#include "LoadCL.h"
+#include "Wavefront.h"
+#include "Trace.h"
+
+// kernels and buffers of the progressive renderer, which adds a sample of each pixel's grid to a running sum on the device a pass at a time
+typedef struct Progressive
+{
+	cl_kernel passKernel;
+	cl_kernel resolveKernel;
+
+	cl_mem accumulationBuffer;	// sum of each pixel's samples so far (and how many there were)
+
+	int width, height, aaLevel;
+} Progressive;
+
+// when to stop adding passes
+typedef struct ProgressiveBudget
+{
+	int targetSamples;										// samples per pixel to stop at (at most the whole grid)
+	double timeLimit;										// milliseconds after start to finish by (0 for no limit)
+	std::chrono::steady_clock::time_point start;
+
+	const char* intermediateFilename;						// the output image, intermediate images are written beside it
+	int intermediateEvery;									// passes between intermediate images (0 for none)
+} ProgressiveBudget;
+
+// create the progressive kernels (from the already built program) and the accumulation buffer, images are resolved into outBuffer
+void createProgressive(Progressive& progressive, cl_context context, cl_program program, const cl_mem sceneBuffers[NUM_SCENE_BUFFERS], cl_mem outBuffer,
+	int width, int height, int aaLevel);
+
+// render passes until the budget's target samples are reached or the next pass wouldn't finish within its time limit (at least one pass is always rendered)
+// each pass is added to the trace if it isn't NULL, and intermediate images are read back through image
+// returns the number of passes (samples per pixel) rendered
+int renderProgressive(Progressive& progressive, cl_command_queue queue, cl_mem outBuffer, const ProgressiveBudget& budget, unsigned int* image, Trace* trace, int run);
+
+// turn the sums so far into an image in the output buffer, finished is set to the kernel's event
+void resolveProgressive(Progressive& progressive, cl_command_queue queue, cl_event* finished);
+
+// release the progressive kernels and buffers
+void releaseProgressive(Progressive& progressive);
+
+#endif // __PROGRESSIVE_H
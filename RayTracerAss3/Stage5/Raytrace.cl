@@ -1,6 +1,8 @@
 ﻿//All instances of "color" or "point" have been replaced with float3. 
 __constant float EPSILON = 0.01f;
-__constant int MAX_RAYS_CAST = 10;
+#ifndef MAX_RAYS_CAST
+#define MAX_RAYS_CAST 10
+#endif
 __constant float DEFAULT_REFRACTIVE_INDEX = 1.0f;
 __constant const float MAX_RAY_DISTANCE = FLT_MAX;
 __constant float PIOVER180 = 0.017453292519943295769236907684886f;
@@ -13,8 +15,8 @@ __constant float PIOVER180 = 0.017453292519943295769236907684886f;
 
 Ray calculateReflection(const Ray* viewRay, const Intersection* intersect)
 {
-	// reflect the viewRay around the object's normal
-	Ray newRay = { intersect->pos, viewRay->dir - (intersect->normal * intersect->viewProjection * 2.0f) };
+	// reflect the viewRay around the object's normal (normalised again, as the intersection tests rely on unit directions)
+	Ray newRay = { intersect->pos, normalise(viewRay->dir - (intersect->normal * intersect->viewProjection * 2.0f)) };
 
 	return newRay;
 }
@@ -48,8 +50,8 @@ Ray calculateRefraction(const Ray* viewRay, const Intersection* intersect, float
 		fCosThetaT = (fSinThetaT * fSinThetaT >= 1.0f) ? 0.0f : sqrt(1 - fSinThetaT * fSinThetaT);
 	}
 
-	// Here we compute the transmitted ray with the formula of Snell-Descartes
-	Ray newRay = { intersect->pos, (viewRay->dir + intersect->normal * fCosThetaI) * refractiveRatio - (intersect->normal * fCosThetaT) };
+	// Here we compute the transmitted ray with the formula of Snell-Descartes (normalised, as it falls short of unit length at total internal reflection)
+	Ray newRay = { intersect->pos, normalise((viewRay->dir + intersect->normal * fCosThetaI) * refractiveRatio - (intersect->normal * fCosThetaT)) };
 
 	return newRay;
 }
@@ -67,17 +69,18 @@ float3 traceRay(const Scene* scene, Ray viewRay)
 		// check for intersections between the view ray and any of the objects in the scene
 		// exit the loop if no intersection found
 		if (!objectIntersection(scene, &viewRay, &intersect)) break;
+		HEATMAP_COUNT(scene, bounces, 1);
 
 		calculateIntersectionResponse(scene, &viewRay, &intersect);
 
 		if (!intersect.insideObject) output += coef * applyLighting(scene, &viewRay, &intersect);
 		
-		if (intersect.material->reflection) //unsure if works or too subtle
+		if (SCENE_USES_REFLECTION && intersect.material->reflection) //unsure if works or too subtle
 		{
 			viewRay = calculateReflection(&viewRay, &intersect);
 			coef *= intersect.material->reflection;
 		}
-		else if (intersect.material->refraction)
+		else if (SCENE_USES_REFRACTION && intersect.material->refraction)
 		{
 			viewRay = calculateRefraction(&viewRay, &intersect, &currentRefractiveIndex);
 			coef *= intersect.material->refraction;
@@ -99,6 +102,56 @@ float3 traceRay(const Scene* scene, Ray viewRay)
 }
 
 
+// convert a colour to a pixel (with exposure and saturation applied) in the format the BMP writer expects
+int convertToPixel(float3 output, float exposure)
+{
+	return (unsigned char)((min(1.0f - exp(output.z * exposure), 1.0f) * 255.0f)) << 16 | (unsigned char)((min(1.0f - exp(output.y * exposure), 1.0f) * 255.0f)) << 8 | (unsigned char)((min(1.0f - exp(output.x * exposure), 1.0f) * 255.0f));
+}
+
+// view ray through a position on the image plane (relative to the centre of the image, in pixels)
+Ray cameraRay(const Scene* scene, float fragmentx, float fragmenty, float dirStepSize)
+{
+	// direction of default forward facing ray
+	float3 dir = { fragmentx * dirStepSize, fragmenty * dirStepSize, 1.0f };
+
+	// rotated direction of ray
+	float3 rotatedDir = {
+		dir.x * cos(scene->cameraRotation) - dir.z * sin(scene->cameraRotation),
+		dir.y,
+		dir.x * sin(scene->cameraRotation) + dir.z * cos(scene->cameraRotation) };
+
+	// view ray starting from camera position and heading in rotated (normalised) direction
+	Ray viewRay = { scene->cameraPosition, normalise(rotatedDir) };
+
+	return viewRay;
+}
+
+// colour of a pixel (x and y are relative to the centre of the image) averaged over an aaLevel x aaLevel grid of samples
+float3 renderSamples(const Scene* scene, int ix2, int iy2, int width, int aaLevel)
+{
+	// angle between each successive ray cast (per pixel, anti-aliasing uses a fraction of this)
+	const float dirStepSize = 1.0f / (0.5f * width / tan(PIOVER180 * 0.5f * scene->cameraFieldOfView));
+
+	float3 output = { 0.0f, 0.0f, 0.0f };
+
+	// calculate multiple samples for each pixel
+	const float sampleStep = 1.0f / aaLevel, sampleRatio = 1.0f / (aaLevel * aaLevel);
+
+	// loop through all sub-locations within the pixel
+	for (float fragmentx = (float)ix2; fragmentx < ix2 + 1.0f; fragmentx += sampleStep)
+	{
+		for (float fragmenty = (float)iy2; fragmenty < iy2 + 1.0f; fragmenty += sampleStep)
+		{
+			Ray viewRay = cameraRay(scene, fragmentx, fragmenty, dirStepSize);
+
+			// follow ray and add proportional of the result to the final pixel colour
+			output += sampleRatio * traceRay(scene, viewRay);
+		}
+	}
+
+	return output;
+}
+
 //TODO: add an appropriate set of parameters to transfer the data
 	//MAY BE ABLE TO REMOVE WWIDTH AND HHEIGHT (we have get_global_size fo dat)
 __kernel void func(__global struct Scene* scenein, int width, int height, int aaLevel,
@@ -107,7 +160,18 @@ __kernel void func(__global struct Scene* scenein, int width, int height, int aa
 	__global Sphere* sphereContainerIn,
 	__global Plane* planeContainerIn,
 	__global Cylinder* cylinderContainerIn,
-	__global int* out, int blockSize, int pos) {
+	__global BVHNode* bvhContainerIn,
+	__global unsigned int* bvhPrimitiveContainerIn,
+	__global float4* primitiveShapeContainerIn,
+	__global float4* primitiveAxisContainerIn,
+	__global float* primitiveRadiusTermContainerIn,
+	__global LightNode* lightTreeContainerIn,
+	__global int* out,
+	int outFirstRow
+#ifdef HEATMAP
+	, __global uint4* heatmapOut
+#endif
+	) {
 
 	Scene scene = *scenein;
 	scene.materialContainer = materialContainerIn;
@@ -115,53 +179,48 @@ __kernel void func(__global struct Scene* scenein, int width, int height, int aa
 	scene.sphereContainer = sphereContainerIn;
 	scene.planeContainer = planeContainerIn;
 	scene.cylinderContainer = cylinderContainerIn;
-
+	scene.bvhContainer = bvhContainerIn;
+	scene.bvhPrimitiveContainer = bvhPrimitiveContainerIn;
+	scene.primitiveShapeContainer = primitiveShapeContainerIn;
+	scene.primitiveAxisContainer = primitiveAxisContainerIn;
+	scene.primitiveRadiusTermContainer = primitiveRadiusTermContainerIn;
+	scene.lightTreeContainer = lightTreeContainerIn;
+
+	// this pixel's counters start at zero (and the scene copy from the host holds a stale pointer otherwise)
+	HeatmapCounts heatmapCounts = { 0, 0, 0, 0 };
+	scene.heatmapCounts = &heatmapCounts;
+
+#ifdef AA_LEVEL
+	// specialised builds know the sample count, so the sampling loops have constant bounds
+	aaLevel = AA_LEVEL;
+#endif
+
+	// tiles are launched with a global offset, so these are already the pixel's position in the whole image
 	unsigned int ix = get_global_id(0);
 	unsigned int iy = get_global_id(1);
-	
-	// angle between each successive ray cast (per pixel, anti-aliasing uses a fraction of this)
-	const float dirStepSize = 1.0f / (0.5f * width / tan(PIOVER180 * 0.5f * scene.cameraFieldOfView));
-
-	// count of samples rendered
-	unsigned int samplesRendered = 0;
-
-	int ix2 = ix - (width / 2) + ((pos % (width / blockSize)) * blockSize);
-	int iy2 = iy - (height / 2) + ((pos / (height / blockSize)) * blockSize);
-
-	float3 output = { 0.0f, 0.0f, 0.0f };
-									
-	// calculate multiple samples for each pixel
-	const float sampleStep = 1.0f / aaLevel, sampleRatio = 1.0f / (aaLevel * aaLevel);
-
-	// loop through all sub-locations within the pixel
-	for (float fragmentx = (float)ix2; fragmentx < ix2 + 1.0f; fragmentx += sampleStep)
-	{
-		for (float fragmenty = (float)iy2; fragmenty < iy2 + 1.0f; fragmenty += sampleStep)
-		{
-			// direction of default forward facing ray
-			float3 dir = { fragmentx * dirStepSize, fragmenty * dirStepSize, 1.0f };
 
-			// rotated direction of ray
-			float3 rotatedDir = {
-				dir.x * cos(scene.cameraRotation) - dir.z * sin(scene.cameraRotation),
-				dir.y,
-				dir.x * sin(scene.cameraRotation) + dir.z * cos(scene.cameraRotation) };
+	int ix2 = ix - (width / 2);
+	int iy2 = iy - (height / 2);
 
-			// view ray starting from camera position and heading in rotated (normalised) direction
-			Ray viewRay = { scene.cameraPosition, normalise(rotatedDir) };
+	float3 output = renderSamples(&scene, ix2, iy2, width, aaLevel);
 
-			// follow ray and add proportional of the result to the final pixel colour
-			output += sampleRatio * traceRay(&scene, viewRay);
+	// out starts at row outFirstRow of the image (0 unless it only holds the rows of a tile, or a few rows of tiles for -stream)
+	out[((iy2 + (height / 2) - outFirstRow) * (width)+(ix2 + (width / 2)))] = convertToPixel(output, scene.exposure);
 
-			// count this sample
-			samplesRendered++;
-		}
-	}
-
-
-	out[((iy2 + (height / 2)) * (width)+(ix2 + (width / 2)))] = (unsigned char)((min(1.0f - exp(output.z * scene.exposure), 1.0f) * 255.0f)) << 16 | (unsigned char)((min(1.0f - exp(output.y * scene.exposure), 1.0f) * 255.0f)) << 8 | (unsigned char)((min(1.0f - exp(output.x * scene.exposure), 1.0f) * 255.0f));
+#ifdef HEATMAP
+	heatmapOut[iy * width + ix] = (uint4)(heatmapCounts.primitiveTests, heatmapCounts.shadowRays, heatmapCounts.shadowTests, heatmapCounts.bounces);
+#endif
 
 	//if (iy == 255 && ix == 255) {
 		//OutputInfo(&scene);
 	//}
-}
\ No newline at end of file
+}
+
+// split-kernel alternative to func (selected with -wavefront)
+#include "Stage5/Wavefront.cl"
+
+// two pass alternative to func that only renders the full sample grid where it's needed (selected with -adaptive)
+#include "Stage5/Adaptive.cl"
+
+// alternative to func that adds a sample to every pixel a pass at a time (selected with -progressive)
+#include "Stage5/Progressive.cl"
@@ -2,25 +2,39 @@
 Ray tracing tutorial of http://www.codermind.com/articles/Raytracer-in-C++-Introduction-What-is-ray-tracing.html
 It is free to use for educational purpose and cannot be redistributed outside of the tutorial pages. */
 
-#define TARGET_WINDOWS
-
 #pragma warning(disable: 4996)
 #include "Timer.h"
+#include "PhaseTimer.h"
 #include "Primitives.h"
 #include "Scene.h"
 #include "Lighting.h"
 #include "Intersection.h"
 #include "ImageIO.h"
 #include "LoadCL.h"
-
-unsigned int buffer[MAX_WIDTH * MAX_HEIGHT];
-unsigned int combBuffer[MAX_WIDTH * MAX_HEIGHT];
+#include "BVH.h"
+#include "SceneCompiler.h"
+#include "Wavefront.h"
+#include "Trace.h"
+#include "Heatmap.h"
+#include "Adaptive.h"
+#include "Progressive.h"
+#include "LightTree.h"
+#include "Streamed.h"
+#include "SceneBinary.h"
+#include "Devices.h"
+#include "MultiDevice.h"
+#include "Server.h"
+#include "Animation.h"
+#include "EmbeddedCL.h"
+
+// whole image on the host (sized by main, and not allocated at all for -stream)
+unsigned int* buffer = NULL;
 
 // reflect the ray from an object
 Ray calculateReflection(const Ray* viewRay, const Intersection* intersect)
 {
-	// reflect the viewRay around the object's normal
-	Ray newRay = { intersect->pos, viewRay->dir - (intersect->normal * intersect->viewProjection * 2.0f) };
+	// reflect the viewRay around the object's normal (normalised again, as the intersection tests rely on unit directions)
+	Ray newRay = { intersect->pos, normalise(viewRay->dir - (intersect->normal * intersect->viewProjection * 2.0f)) };
 
 	return newRay;
 }
@@ -55,8 +69,8 @@ Ray calculateRefraction(const Ray* viewRay, const Intersection* intersect, float
 		fCosThetaT = (fSinThetaT * fSinThetaT >= 1.0f) ? 0.0f : sqrtf(1 - fSinThetaT * fSinThetaT);
 	}
 
-	// Here we compute the transmitted ray with the formula of Snell-Descartes
-	Ray newRay = { intersect->pos, (viewRay->dir + intersect->normal * fCosThetaI) * refractiveRatio - (intersect->normal * fCosThetaT) };
+	// Here we compute the transmitted ray with the formula of Snell-Descartes (normalised, as it falls short of unit length at total internal reflection)
+	Ray newRay = { intersect->pos, normalise((viewRay->dir + intersect->normal * fCosThetaI) * refractiveRatio - (intersect->normal * fCosThetaT)) };
 
 	return newRay;
 }
@@ -112,6 +126,51 @@ Colour traceRay(const Scene* scene, Ray viewRay)
 	return output;
 }
 
+// colour of a pixel (x and y are relative to the centre of the image) averaged over an aaLevel x aaLevel grid of samples (the same grid as func's)
+unsigned int renderPixel(const Scene* scene, int x, int y, int width, int height, int aaLevel, float dirStepSize, bool testMode, unsigned int* samplesRendered)
+{
+	Colour output(0.0f, 0.0f, 0.0f);
+
+	// calculate multiple samples for each pixel
+	const float sampleStep = 1.0f / aaLevel, sampleRatio = 1.0f / (aaLevel * aaLevel);
+
+	// loop through all sub-locations within the pixel
+	for (float fragmentx = float(x); fragmentx < x + 1.0f; fragmentx += sampleStep)
+	{
+		for (float fragmenty = float(y); fragmenty < y + 1.0f; fragmenty += sampleStep)
+		{
+			// direction of default forward facing ray
+			Vector dir = { fragmentx * dirStepSize, fragmenty * dirStepSize, 1.0f };
+
+			// rotated direction of ray
+			Vector rotatedDir = {
+				dir.x * cosf(scene->cameraRotation) - dir.z * sinf(scene->cameraRotation),
+				dir.y,
+				dir.x * sinf(scene->cameraRotation) + dir.z * cosf(scene->cameraRotation) };
+
+			// view ray starting from camera position and heading in rotated (normalised) direction
+			Ray viewRay = { scene->cameraPosition, normalise(rotatedDir) };
+
+			// follow ray and add proportional of the result to the final pixel colour
+			output += sampleRatio * traceRay(scene, viewRay);
+
+			// count this sample
+			(*samplesRendered)++;
+		}
+	}
+
+	if (!testMode)
+	{
+		// saturated final colour value
+		return output.convertToPixel(scene->exposure);
+	}
+	else
+	{
+		// colour calculated from x,y coordinates
+		return Colour((x + width / 2) % 256 / 255.0f, 0, (y + height / 2) % 256 / 255.0f).convertToPixel();
+	}
+}
+
 // render scene at given width and height and anti-aliasing level
 int render(Scene* scene, const int width, const int height, const int aaLevel, bool testMode)
 {
@@ -129,50 +188,64 @@ int render(Scene* scene, const int width, const int height, const int aaLevel, b
 	{
 		for (int x = -width / 2; x < width / 2; ++x)
 		{
-			Colour output(0.0f, 0.0f, 0.0f);
+			// store final colour value in image buffer
+			*out++ = renderPixel(scene, x, y, width, height, aaLevel, dirStepSize, testMode, &samplesRendered);
+		}
+	}
+
+	return samplesRendered;
+}
 
-			// calculate multiple samples for each pixel
-			const float sampleStep = 1.0f / aaLevel, sampleRatio = 1.0f / (aaLevel * aaLevel);
+void renderTileHost(const Scene* scene, int width, int height, int aaLevel, int tileX, int tileY, int tileWidth, int tileHeight, unsigned int* image)
+{
+	// angle between each successive ray cast (per pixel, anti-aliasing uses a fraction of this)
+	const float dirStepSize = 1.0f / (0.5f * width / tanf(PIOVER180 * 0.5f * scene->cameraFieldOfView));
 
-			// loop through all sub-locations within the pixel
-			for (float fragmentx = float(x); fragmentx < x + 1.0f; fragmentx += sampleStep)
-			{
-				for (float fragmenty = float(y); fragmenty < y + 1.0f; fragmenty += sampleStep)
-				{
-					// direction of default forward facing ray
-					Vector dir = { fragmentx * dirStepSize, fragmenty * dirStepSize, 1.0f };
+	unsigned int samplesRendered = 0;
+	for (int y = tileY; y < tileY + tileHeight; ++y)
+	{
+		for (int x = tileX; x < tileX + tileWidth; ++x)
+		{
+			image[(size_t)y * width + x] = renderPixel(scene, x - width / 2, y - height / 2, width, height, aaLevel, dirStepSize, false, &samplesRendered);
+		}
+	}
+}
 
-					// rotated direction of ray
-					Vector rotatedDir = {
-						dir.x * cosf(scene->cameraRotation) - dir.z * sinf(scene->cameraRotation),
-						dir.y,
-						dir.x * sinf(scene->cameraRotation) + dir.z * cosf(scene->cameraRotation) };
+// render the frame on the host with the C++ traceRay, walking the hierarchy and then with the brute-force loops, and count the pixels that differ
+// (the hierarchy walk, down to which of two hits at the same distance it keeps, is the kernel's, so the two should only differ where a
+// primitive test reports a hit outside the primitive's box, which the hierarchy never reaches)
+// the brute-force image is written to outputFilename, so a device render can be compared with it too
+static bool checkHierarchy(Scene& scene, int width, int height, int aaLevel, const char* outputFilename)
+{
+	std::vector<unsigned int> hierarchyImage((size_t)width * height), bruteForceImage((size_t)width * height);
 
-					// view ray starting from camera position and heading in rotated (normalised) direction
-					Ray viewRay = { scene->cameraPosition, normalise(rotatedDir) };
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	renderTileHost(&scene, width, height, aaLevel, 0, 0, width, height, hierarchyImage.data());
+	std::chrono::steady_clock::time_point hierarchyEnd = std::chrono::steady_clock::now();
 
-					// follow ray and add proportional of the result to the final pixel colour
-					output += sampleRatio * traceRay(scene, viewRay);
+	unsigned int numBVHNodes = scene.numBVHNodes;
+	scene.numBVHNodes = 0;
+	renderTileHost(&scene, width, height, aaLevel, 0, 0, width, height, bruteForceImage.data());
+	scene.numBVHNodes = numBVHNodes;
+	std::chrono::steady_clock::time_point bruteForceEnd = std::chrono::steady_clock::now();
 
-					// count this sample
-					samplesRendered++;
-				}
-			}
+	write_bmp(outputFilename, bruteForceImage.data(), width, height, width);
 
-			if (!testMode)
-			{
-				// store saturated final colour value in image buffer
-				*out++ = output.convertToPixel(scene->exposure);
-			}
-			else
-			{
-				// store colour (calculated from x,y coordinates) in image buffer 
-				*out++ = Colour((x + width / 2) % 256 / 255.0f, 0, (y + height / 2) % 256 / 255.0f).convertToPixel();
-			}
+	int differingPixels = 0, maxError = 0;
+	for (size_t i = 0; i < hierarchyImage.size(); ++i)
+	{
+		if (hierarchyImage[i] == bruteForceImage[i]) continue;
+		differingPixels++;
+		for (int shift = 0; shift < 24; shift += 8)
+		{
+			maxError = std::max(maxError, abs((int)((hierarchyImage[i] >> shift) & 0xff) - (int)((bruteForceImage[i] >> shift) & 0xff)));
 		}
 	}
 
-	return samplesRendered;
+	printf("hierarchy %.0f ms, brute force %.0f ms\n", std::chrono::duration<double, std::milli>(hierarchyEnd - start).count(),
+		std::chrono::duration<double, std::milli>(bruteForceEnd - hierarchyEnd).count());
+	printf("%d of %d pixels differ from the brute-force loops (largest difference %d)\n", differingPixels, width * height, maxError);
+	return differingPixels == 0;
 }
 
 // output a bunch of info about the contents of the scene
@@ -194,6 +267,7 @@ void OutputInfo(const Scene* scene)
 	printf("sizeof(Plane):    %zd\n", sizeof(Plane));
 	printf("sizeof(Cylinder): %zd\n", sizeof(Cylinder));
 	printf("sizeof(Material): %zd\n", sizeof(Material));
+	printf("sizeof(BVHNode):  %zd\n", sizeof(BVHNode));
 	printf("sizeof(Scene):    %zd\n", sizeof(Scene));
 
 	printf("\n--- Scene:\n");;
@@ -251,6 +325,8 @@ void OutputInfo(const Scene* scene)
 		);
 	}
 
+	printf("\n--- BVH: %d nodes\n", scene->numBVHNodes);
+
 	printf("\n--- Lights (%d):\n", scene->numLights);
 	for (unsigned int i = 0; i < scene->numLights; ++i)
 	{
@@ -289,6 +365,9 @@ void OutputInfo(const Scene* scene)
 // read command line arguments, render, and write out BMP file
 int main(int argc, char* argv[])
 {
+	// the progressive renderer's time limit counts from here
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
 	int width = 1024;
 	int height = 1024;
 	int samples = 1;
@@ -301,6 +380,30 @@ int main(int argc, char* argv[])
 	const char* inputFilename = "Scenes/allmaterials.txt"; 
 
 	int blockSize = 256;
+	bool wavefrontMode = false;
+	bool specialiseProgram = true;
+	bool programCache = true;
+	const char* traceFilename = NULL;
+	bool heatmapMode = false;
+	bool adaptiveMode = false;
+	int contrastThreshold = 8;
+	const char* referenceFilename = NULL;
+	bool progressiveMode = false;
+	int targetSamples = 0;
+	double timeLimit = 0.0;
+	int intermediateEvery = 0;
+	int lightSamples = 0;
+	bool streamMode = false;
+	const char* convertFilename = NULL;
+	const char* deviceSpec = NULL;
+	int subDevices = 0;
+	int hostThreads = 0;
+	bool serveMode = false;
+	const char* socketPath = NULL;
+	const char* keyframeFilename = NULL;
+	int frames = 0;
+	bool checkBVH = false;
+	bool listDevices = false;
 
 	char outputFilenameBuffer[1000];
 	char* outputFilename = outputFilenameBuffer;
@@ -339,34 +442,365 @@ int main(int argc, char* argv[])
 		{
 			blockSize = atoi(argv[++i]);
 		}
+		else if (strcmp(argv[i], "-wavefront") == 0)
+		{
+			wavefrontMode = true;
+		}
+		else if (strcmp(argv[i], "-noSpecialise") == 0)
+		{
+			specialiseProgram = false;
+		}
+		else if (strcmp(argv[i], "-noProgramCache") == 0)
+		{
+			programCache = false;
+		}
+		else if (strcmp(argv[i], "-trace") == 0)
+		{
+			// write a timeline of the host phases and every tile's kernel and readback (Chrome trace JSON)
+			traceFilename = argv[++i];
+		}
+		else if (strcmp(argv[i], "-heatmap") == 0)
+		{
+			// count the intersection tests, shadow rays and bounces of each pixel and write them out as images
+			heatmapMode = true;
+		}
+		else if (strcmp(argv[i], "-adaptive") == 0)
+		{
+			// render the full grid of samples only where a cheap pass finds contrast
+			adaptiveMode = true;
+		}
+		else if (strcmp(argv[i], "-adaptiveThreshold") == 0)
+		{
+			// contrast (largest difference of a channel across a pixel's neighbours, 0-255) that gets a pixel refined
+			contrastThreshold = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-reference") == 0)
+		{
+			// report the error against another render (e.g. a uniform one) once finished
+			referenceFilename = argv[++i];
+		}
+		else if (strcmp(argv[i], "-progressive") == 0)
+		{
+			// add a sample of every pixel's grid a pass at a time, until -targetSamples or -timeLimit is reached
+			progressiveMode = true;
+		}
+		else if (strcmp(argv[i], "-targetSamples") == 0)
+		{
+			targetSamples = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-timeLimit") == 0)
+		{
+			// milliseconds from starting up to finishing the last pass
+			timeLimit = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-intermediate") == 0)
+		{
+			// write an image beside the output every n passes
+			intermediateEvery = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-manyLights") == 0)
+		{
+			// light each point from this many lights picked from a hierarchy over the lights, instead of all of them
+			lightSamples = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-stream") == 0)
+		{
+			// write rows of tiles to the output as they finish instead of keeping the whole image (for images too big to hold)
+			streamMode = true;
+		}
+		else if (strcmp(argv[i], "-convertScene") == 0)
+		{
+			// write the input scene (with its hierarchy and compiled streams) as a binary scene and stop
+			convertFilename = argv[++i];
+		}
+		else if (strcmp(argv[i], "-listDevices") == 0)
+		{
+			// print every OpenCL device (with the index -device picks it by) and stop
+			listDevices = true;
+		}
+		else if (strcmp(argv[i], "-device") == 0)
+		{
+			// "all" or a comma separated list of device indices, tiles are shared between the devices when there's more than one
+			deviceSpec = argv[++i];
+		}
+		else if (strcmp(argv[i], "-subDevices") == 0)
+		{
+			// split each device picked into this many parts and render to those instead (one CPU device becomes several)
+			subDevices = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-hostThreads") == 0)
+		{
+			// also render tiles on this many host threads with the C++ traceRay, taking them from the same queue as the devices
+			hostThreads = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-serve") == 0)
+		{
+			// keep running, rendering jobs (a line of JSON each, see Server.h) read from standard input
+			serveMode = true;
+		}
+		else if (strcmp(argv[i], "-serveSocket") == 0)
+		{
+			// as -serve, but the jobs come from clients of a UNIX socket at this path
+			serveMode = true;
+			socketPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-animation") == 0)
+		{
+			// render a frame for each step along the camera path in this keyframe file (see Animation.h), all in one process
+			keyframeFilename = argv[++i];
+		}
+		else if (strcmp(argv[i], "-frames") == 0)
+		{
+			// number of frames to render along the camera path (by default, up to and including the last keyframe)
+			frames = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-checkBVH") == 0)
+		{
+			// render on the host with and without the hierarchy, report how many pixels differ and stop (see checkHierarchy)
+			checkBVH = true;
+		}
 		else
 		{
 			fprintf(stderr, "unknown argument: %s\n", argv[i]);
 		}
 	}
 
+	// the renderers other than the megakernel can't be combined (and only the megakernel keeps heatmap counts)
+	if ((int)heatmapMode + (int)wavefrontMode + (int)adaptiveMode + (int)progressiveMode > 1)
+	{
+		printf("only one of -heatmap, -wavefront, -adaptive and -progressive can be used at once\n");
+		exit(1);
+	}
+
+	if (width <= 0 || height <= 0 || blockSize <= 0)
+	{
+		printf("the image size and block size must be positive\n");
+		exit(1);
+	}
+
+	// streaming only keeps a few rows of tiles, so it's only for the megakernel, and there's no whole image to compare
+	if (streamMode && (heatmapMode || wavefrontMode || adaptiveMode || progressiveMode || referenceFilename != NULL))
+	{
+		printf("-stream can't be used with -heatmap, -wavefront, -adaptive, -progressive or -reference\n");
+		exit(1);
+	}
+
+	// the time limit counts from starting up, so every run after the first would already be out of time
+	if (progressiveMode && timeLimit > 0.0 && times > 1)
+	{
+		printf("-timeLimit can't be used with -runs\n");
+		exit(1);
+	}
+
+	// the wavefront renderer (and the host's traceRay) sends a shadow ray to every light itself, so it can't sample them
+	if (lightSamples > 0 && (wavefrontMode || hostThreads > 0))
+	{
+		printf("-manyLights can't be used with -wavefront or -hostThreads\n");
+		exit(1);
+	}
+
+	// frames take the place of runs, each writing its own image (so there's no single image to stream, compare or count)
+	bool animationMode = keyframeFilename != NULL;
+	if (animationMode && (heatmapMode || progressiveMode || streamMode || referenceFilename != NULL || times != 1))
+	{
+		printf("-animation can't be used with -heatmap, -progressive, -stream, -reference or -runs\n");
+		exit(1);
+	}
+
+	// every device on every platform (a machine without a GPU renders on whatever device it has)
+	std::vector<RenderTarget> allDevices = findDevices();
+	if (listDevices)
+	{
+		printDevices(allDevices);
+		return 0;
+	}
+
+	// built programs are cached beside the executable, so a warm start skips compiling the kernel (the source is embedded at build time)
+	std::string cacheDir(argv[0]);
+	cacheDir = cacheDir.substr(0, cacheDir.find_last_of("\\/") + 1);
+
+	// the server renders with the megakernel on a single device, and each job names its own scene, size and output
+	if (serveMode)
+	{
+		if (heatmapMode || wavefrontMode || adaptiveMode || progressiveMode || streamMode || traceFilename != NULL || referenceFilename != NULL ||
+			lightSamples > 0 || hostThreads > 0 || convertFilename != NULL || animationMode)
+		{
+			printf("-serve can only be used with -device, -subDevices, -blockSize, -noSpecialise and -noProgramCache\n");
+			exit(1);
+		}
+
+		std::vector<RenderTarget> devices;
+		if (!selectDevices(allDevices, deviceSpec, subDevices, devices)) exit(1);
+		if (devices.size() > 1)
+		{
+			printf("-serve renders on a single device\n");
+			exit(1);
+		}
+
+		RenderServer server;
+		createServer(server, devices[0].device, specialiseProgram, programCache ? cacheDir.c_str() : NULL, blockSize);
+
+		// standard output carries the replies, so what the server is doing goes to standard error
+		fprintf(stderr, "serving on %s with %s\n", socketPath != NULL ? socketPath : "standard input", devices[0].name.c_str());
+		bool served = true;
+		if (socketPath != NULL) served = serveSocket(server, socketPath);
+		else serveStream(server, stdin, stdout);
+		fprintf(stderr, "served %d jobs\n", server.jobs);
+
+		releaseServer(server);
+		releaseDevices(devices);
+		clReleaseProgramCache();
+		return served ? 0 : 1;
+	}
+
+	// progressive passes each add one of the grid's samples, so it can't go past the whole grid
+	if (targetSamples <= 0 || targetSamples > samples * samples) targetSamples = samples * samples;
+
 	// nasty (and fragile) kludge to make an ok-ish default output filename (can be overriden with "-output" command line option)
 	sprintf(outputFilenameBuffer, "Outputs/%s_%dx%dx%d_%s.bmp", (strrchr(inputFilename, '/') + 1), width, height, samples, (strrchr(argv[0], '\\') + 1));
 
-	// read scene file
+	// time taken by each phase (scene parse, OpenCL setup, each run's rendering, ...)
+	PhaseTimer phases;
+
+	// timeline of the phases and device commands (only recorded with -trace)
+	Trace trace;
+	bool tracing = traceFilename != NULL;
+	if (tracing) phases.setCallback(tracePhase, &trace);
+
+	// read scene file (binary scenes already hold the hierarchy and compiled streams, so they're just mapped)
 	Scene scene;
-	if (!init(inputFilename, scene))
+	if (isBinaryScene(inputFilename))
+	{
+		if (!loadBinaryScene(inputFilename, scene))
+		{
+			fprintf(stderr, "Failure when reading the binary Scene file.\n");
+			return -1;
+		}
+	}
+	else
+	{
+		if (!init(inputFilename, scene))
+		{
+			fprintf(stderr, "Failure when reading the Scene file.\n");
+			return -1;
+		}
+
+		// build the acceleration structure over the spheres and cylinders
+		buildBVH(scene);
+
+		// flatten the spheres and cylinders into the streams the intersection tests read
+		compileScene(scene);
+	}
+
+	if (convertFilename != NULL)
+	{
+		if (!writeBinaryScene(convertFilename, scene))
+		{
+			fprintf(stderr, "Couldn't write the binary scene %s.\n", convertFilename);
+			return -1;
+		}
+		printf("%s converted to %s (%u spheres, %u planes, %u cylinders, %u hierarchy nodes)\n", inputFilename, convertFilename,
+			scene.numSpheres, scene.numPlanes, scene.numCylinders, scene.numBVHNodes);
+		return 0;
+	}
+
+	// the host lights every light rather than sampling them
+	if (checkBVH)
+	{
+		if (lightSamples > 0)
+		{
+			printf("-checkBVH can't be used with -manyLights\n");
+			exit(1);
+		}
+		return checkHierarchy(scene, width, height, samples, outputFilename) ? 0 : 1;
+	}
+
+	// cluster the lights so a few can be picked for each point in proportion to how much they're likely to add
+	if (lightSamples > 0)
+	{
+		buildLightTree(scene);
+		printf("light hierarchy: %u lights, %u nodes, %d light sample(s) per shading point\n", scene.numLights, scene.numLightNodes, lightSamples);
+	}
+
+	// the camera path (the scene's own camera fills in anything the first keyframe leaves out)
+	std::vector<Keyframe> keyframes;
+	if (animationMode)
+	{
+		if (!readKeyframes(keyframeFilename, scene, keyframes))
+		{
+			fprintf(stderr, "Failure when reading the keyframe file.\n");
+			return -1;
+		}
+		if (frames <= 0) frames = keyframes.back().frame + 1;
+		times = frames;
+	}
+	phases.endPhase("scene parse");
+
+	// the devices to render to, tiles are shared between them (and any host threads) when there's more than one
+	std::vector<RenderTarget> devices;
+	if (!selectDevices(allDevices, deviceSpec, subDevices, devices)) exit(1);
+	bool multiDeviceMode = devices.size() > 1 || hostThreads > 0;
+
+	// only the megakernel's tiles are shared between devices, and its readback goes straight into the whole image
+	if (multiDeviceMode && (heatmapMode || wavefrontMode || adaptiveMode || progressiveMode || streamMode || tracing || animationMode))
 	{
-		fprintf(stderr, "Failure when reading the Scene file.\n");
-		return -1;
+		printf("rendering to more than one device (or with -hostThreads) can't be used with -heatmap, -wavefront, -adaptive, -progressive, -stream, -trace or -animation\n");
+		exit(1);
 	}
 
-	Timer timer;		// create timer
+	// specialise the program for the scene so the kernel only contains the paths it needs (builds are shared by scenes with the same options)
+	std::string buildOptions = specialiseProgram ? getSceneBuildOptions(scene, samples) : std::string("-cl-std=CL1.2");
+	if (heatmapMode) buildOptions += " -DHEATMAP";
+	if (lightSamples > 0 && scene.numLightNodes > 0) buildOptions += " -DLIGHT_SAMPLES=" + std::to_string(lightSamples);
+
+	if (multiDeviceMode)
+	{
+		for (size_t i = 0; i < devices.size(); ++i) printf("device: %s\n", devices[i].name.c_str());
+		if (hostThreads > 0) printf("host: %d threads\n", hostThreads);
+
+		MultiDevice multi;
+		createMultiDevice(multi, devices, hostThreads);
+		phases.endPhase("opencl init");
+
+		buildMultiDevice(multi, buildOptions.c_str(), programCache ? cacheDir.c_str() : NULL);
+		phases.endPhase("program build");
+
+		uploadMultiDevice(multi, scene, width, height, samples, blockSize);
+		buffer = new unsigned int[(size_t)width * height];
+		phases.endPhase("buffer upload");
+
+		// every device renders and reads back its own tiles (and host threads render straight into the image), so kernel execution includes the readback
+		for (int i = 0; i < times; i++)
+		{
+			if (i > 0) phases.nextRun();
+			renderMultiDevice(multi, buffer);
+			phases.endPhase("kernel execution");
+		}
+
+		phases.restart();
+		write_bmp(outputFilename, buffer, width, height, width);
+		phases.endOneOffPhase("image write");
+
+		phases.print();
+		phases.printJSON();
+		printMultiDeviceShare(multi);
+		if (referenceFilename != NULL) printReferenceError(buffer, width, height, referenceFilename);
+
+		releaseMultiDevice(multi);
+		releaseDevices(devices);
+		delete[] buffer;
+		clReleaseProgramCache();
+		return 0;
+	}
 
 	// OpenCL setup code goes here
 	cl_int err;
-	cl_platform_id platform;
-	cl_device_id device;
+	cl_device_id device = devices[0].device;
 	cl_context context;
 	cl_command_queue queue;
+	cl_command_queue readQueue;
 	cl_program program;
 	cl_kernel kernel;
-	size_t workSize[] = { blockSize, blockSize };
 
 	cl_mem clBuffer1;
 	cl_mem clBuffer2;
@@ -375,19 +809,15 @@ int main(int argc, char* argv[])
 	cl_mem clBuffer5;
 	cl_mem clBuffer6;
 	cl_mem clBuffer7;
+	cl_mem clBuffer8;
+	cl_mem clBuffer9;
+	cl_mem clBuffer10;
+	cl_mem clBuffer11;
+	cl_mem clBuffer12;
+	cl_mem clBuffer13 = NULL;
+	cl_mem clBuffer14;
 
-	err = clGetPlatformIDs(1, &platform, NULL);
-	if (err != CL_SUCCESS)
-	{
-		printf("\nError calling clGetPlatformIDs. Error code: %d\n", err);
-		exit(1);
-	}
-
-	err = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 1, &device, NULL);
-	if (err != CL_SUCCESS) {
-		printf("Couldn't find any devices\n");
-		exit(1);
-	}
+	printf("device: %s\n", devices[0].name.c_str());
 
 	context = clCreateContext(NULL, 1, &device, NULL, NULL, &err);
 	if (err != CL_SUCCESS) {
@@ -395,19 +825,30 @@ int main(int argc, char* argv[])
 		exit(1);
 	}
 
-	queue = clCreateCommandQueue(context, device, 0, &err);
+	// timestamps of each command are only recorded when tracing, as profiling can slow the queue down
+	cl_command_queue_properties queueProperties = tracing ? CL_QUEUE_PROFILING_ENABLE : 0;
+
+	queue = clCreateCommandQueue(context, device, queueProperties, &err);
 	if (err != CL_SUCCESS) {
 		printf("Couldn't create the command queue\n");
 		exit(1);
 	}
 
-	program = clLoadSource(context, "Stage5/Raytrace.cl", &err);
+	// finished tiles are read back on their own queue, so the copy overlaps rendering the next tile
+	readQueue = clCreateCommandQueue(context, device, queueProperties, &err);
 	if (err != CL_SUCCESS) {
-		printf("Couldn't load/create the program\n");
+		printf("Couldn't create the read command queue\n");
 		exit(1);
 	}
+	if (tracing) trace.calibrate(queue);
+	phases.endPhase("opencl init");
 
-	err = clBuildProgram(program, 0, NULL, "-cl-std=CL1.2", NULL, NULL);
+	ProgramOrigin programOrigin;
+	program = clBuildProgramCached(context, device, embeddedRaytraceCL, buildOptions.c_str(), programCache ? cacheDir.c_str() : NULL, &programOrigin, &err);
+	if (program == NULL) {
+		printf("Couldn't load/create the program\n");
+		exit(1);
+	}
 	if (err != CL_SUCCESS) {
 		char* program_log;
 		size_t log_size;
@@ -426,6 +867,11 @@ int main(int argc, char* argv[])
 		printf("Couldn't create the kernel\n");
 		exit(1);
 	}
+	phases.endPhase("program build");
+
+	// cold starts compile the source, warm starts load the cached binary
+	printf("program build: %s\n", programOrigin == PROGRAM_FROM_SOURCE ? "cold, compiled from source" : "warm, loaded cached binary");
+	phases.restart();
 
 	clBuffer1 = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(Scene), &scene, &err);
 	if (err != CL_SUCCESS) {
@@ -480,12 +926,87 @@ int main(int argc, char* argv[])
 		clBuffer6 = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(int), &dummyInt3, &err);
 	}
 
-	clBuffer7 = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(int) * width * height, buffer, &err);
-	if (err != CL_SUCCESS) {
-		printf("Couldn't create a bufferIn7 object -> %d\n", err);
-		exit(1);
+	if (scene.numBVHNodes > 0) {
+		clBuffer8 = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(BVHNode) * scene.numBVHNodes, scene.bvhContainer, &err);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't create a bufferIn8 object -> %d\n", err);
+			exit(1);
+		}
+		clBuffer9 = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(unsigned int) * (scene.numSpheres + scene.numCylinders), scene.bvhPrimitiveContainer, &err);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't create a bufferIn9 object -> %d\n", err);
+			exit(1);
+		}
+	}
+	else {
+		int dummyInt4 = -1;
+		clBuffer8 = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(int), &dummyInt4, &err);
+		clBuffer9 = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(int), &dummyInt4, &err);
 	}
 
+	if (scene.numSpheres + scene.numCylinders > 0) {
+		clBuffer10 = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_float4) * (scene.numSpheres + scene.numCylinders), scene.primitiveShapeContainer, &err);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't create a bufferIn10 object -> %d\n", err);
+			exit(1);
+		}
+		clBuffer11 = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_float4) * (scene.numSpheres + scene.numCylinders), scene.primitiveAxisContainer, &err);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't create a bufferIn11 object -> %d\n", err);
+			exit(1);
+		}
+		clBuffer12 = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * (scene.numSpheres + scene.numCylinders), scene.primitiveRadiusTermContainer, &err);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't create a bufferIn12 object -> %d\n", err);
+			exit(1);
+		}
+	}
+	else {
+		cl_float4 dummyFloat4 = {};
+		clBuffer10 = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_float4), &dummyFloat4, &err);
+		clBuffer11 = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_float4), &dummyFloat4, &err);
+		clBuffer12 = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_float4), &dummyFloat4, &err);
+	}
+
+	if (scene.numLightNodes > 0) {
+		clBuffer14 = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(LightNode) * scene.numLightNodes, scene.lightTreeContainer, &err);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't create a bufferIn14 object -> %d\n", err);
+			exit(1);
+		}
+	}
+	else {
+		int dummyInt5 = -1;
+		clBuffer14 = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(int), &dummyInt5, &err);
+	}
+
+	// the megakernel renders each tile in flight into a buffer of its own, as a kernel can't write to a buffer (even a different part of it)
+	// while a read on the other queue is using it, func writes each pixel at its row of the image less outFirstRow, so a buffer is a tile's rows
+	// (the streamed renderer does the same for each row of tiles, and the others write straight into the whole image, so their tiles are
+	// read back on the in-order queue instead)
+	bool tileBuffersUsed = !wavefrontMode && !adaptiveMode && !progressiveMode && !streamMode;
+	cl_mem tileBuffers[MAX_TILES_IN_FLIGHT];
+	if (tileBuffersUsed) {
+		clBuffer7 = NULL;
+		for (int slot = 0; slot < MAX_TILES_IN_FLIGHT; ++slot) {
+			tileBuffers[slot] = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(int) * width * std::min(blockSize, height), NULL, &err);
+			if (err != CL_SUCCESS) {
+				printf("Couldn't create a tile buffer -> %d\n", err);
+				exit(1);
+			}
+		}
+	}
+	else if (streamMode) {
+		// the streamed renderer has a buffer for each row of tiles in its ring (see createStreamed)
+		clBuffer7 = NULL;
+	}
+	else {
+		clBuffer7 = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(int) * width * height, NULL, &err);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't create a bufferIn7 object -> %d\n", err);
+			exit(1);
+		}
+	}
 
 	err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &clBuffer1);
 	if (err != CL_SUCCESS) {
@@ -540,80 +1061,310 @@ int main(int argc, char* argv[])
 		exit(1);
 	}
 
-	err = clSetKernelArg(kernel, 9, sizeof(cl_mem), &clBuffer7);
+	err = clSetKernelArg(kernel, 9, sizeof(cl_mem), &clBuffer8);
 	if (err != CL_SUCCESS) {
-		printf("Couldn't set the kernel(9) argument\n");
+		printf("Couldn't set the kernel(9) argument = %d\n", err);
 		exit(1);
 	}
-	
-	err = clSetKernelArg(kernel, 10, sizeof(int), &blockSize);
+
+	err = clSetKernelArg(kernel, 10, sizeof(cl_mem), &clBuffer9);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't set the kernel(10) argument = %d\n", err);
+		exit(1);
+	}
+
+	err = clSetKernelArg(kernel, 11, sizeof(cl_mem), &clBuffer10);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't set the kernel(11) argument = %d\n", err);
+		exit(1);
+	}
+
+	err = clSetKernelArg(kernel, 12, sizeof(cl_mem), &clBuffer11);
 	if (err != CL_SUCCESS) {
-		printf("Couldn't set the kernel(10) argument\n");
+		printf("Couldn't set the kernel(12) argument = %d\n", err);
 		exit(1);
 	}
 
+	err = clSetKernelArg(kernel, 13, sizeof(cl_mem), &clBuffer12);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't set the kernel(13) argument = %d\n", err);
+		exit(1);
+	}
+
+	err = clSetKernelArg(kernel, 14, sizeof(cl_mem), &clBuffer14);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't set the kernel(14) argument = %d\n", err);
+		exit(1);
+	}
+
+	err = clSetKernelArg(kernel, 15, sizeof(cl_mem), tileBuffersUsed ? &tileBuffers[0] : &clBuffer7);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't set the kernel(15) argument\n");
+		exit(1);
+	}
+
+	// the output buffer starts at the top of the image unless it only holds some of its rows (set for each tile or streamed row of tiles)
+	int outFirstRow = 0;
+	err = clSetKernelArg(kernel, 16, sizeof(int), &outFirstRow);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't set the kernel(16) argument = %d\n", err);
+		exit(1);
+	}
+
+	// each pixel's counts (the heatmap build of func takes them as an extra argument)
+	if (heatmapMode) {
+		clBuffer13 = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_uint4) * width * height, NULL, &err);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't create a bufferIn13 object -> %d\n", err);
+			exit(1);
+		}
+
+		err = clSetKernelArg(kernel, 17, sizeof(cl_mem), &clBuffer13);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't set the kernel(17) argument = %d\n", err);
+			exit(1);
+		}
+	}
+
+	// scene buffers in the order the wavefront, adaptive and progressive kernels take them
+	cl_mem sceneBuffers[NUM_SCENE_BUFFERS] = { clBuffer1, clBuffer2, clBuffer3, clBuffer4, clBuffer5, clBuffer6, clBuffer8, clBuffer9, clBuffer10, clBuffer11, clBuffer12, clBuffer14 };
+
+	// split-kernel renderer (uses the same scene and output buffers as func)
+	Wavefront wavefront;
+	if (wavefrontMode) {
+		createWavefront(wavefront, context, program, sceneBuffers, clBuffer7, width, height, samples);
+	}
+
+	// two pass renderer (reads the same scene buffers and writes refined tiles to the same output buffer as func)
+	Adaptive adaptive;
+	if (adaptiveMode) {
+		createAdaptive(adaptive, context, program, sceneBuffers, clBuffer7, width, height, samples, contrastThreshold);
+	}
+
+	// sample-at-a-time renderer (resolves its sums into the same output buffer as func)
+	Progressive progressive;
+	int progressivePasses = 0;
+	if (progressiveMode) {
+		createProgressive(progressive, context, program, sceneBuffers, clBuffer7, width, height, samples);
+	}
+
+	// streamed renders only hold a ring of rows of tiles, everything else reads the whole image back
+	Streamed streamed;
+	if (streamMode) createStreamed(streamed, context, width, height, blockSize);
+	else buffer = new unsigned int[(size_t)width * height];
+
+	// animations read each frame back into one image while the other is written out, then swap them
+	unsigned int* writingImage = animationMode ? new unsigned int[(size_t)width * height] : NULL;
+	FrameWriter frameWriter;
+	Scene frameScene = scene;
+	phases.endPhase("buffer upload");
+
 	// display info about the current scene
 	//OutputInfo(&scene);
 
-	int numOfCycles = (width / blockSize) * (height / blockSize);
-	// first time and total time taken to render all runs (used to calculate average)
-	int firstTime = 0;
-	int totalTime = 0;
-	int samplesRendered = 0;
-	int pos = 0;
+	// number of tiles across and down (tiles on the right and bottom edges are cut short when the size isn't a multiple of blockSize)
+	int tilesX = (width + blockSize - 1) / blockSize;
+	int tilesY = (height + blockSize - 1) / blockSize;
+	int numOfTiles = tilesX * tilesY;
 
-	int xPos = 0;
-	int yPos = 0;
+	// read back of each tile in flight (reused once that tile has been copied into the buffer)
+	cl_event readEvents[MAX_TILES_IN_FLIGHT];
+
+	std::chrono::steady_clock::time_point framesStart = std::chrono::steady_clock::now();
 	for (int i = 0; i < times; i++)
 	{
-		if (i > 0) timer.start();
+		if (i > 0) phases.nextRun();
 
-		for (int j = 0; j < numOfCycles; j++) {
-			size_t workOffset[] = { 0, 0 };
-			size_t workSize[] = { blockSize, blockSize };
-			
-			err = clSetKernelArg(kernel, 11, sizeof(int), &pos);
+		// a frame only moves the camera, so only the scene header is written again (the queue is in order, so the last frame's
+		// tiles have finished with the header before it changes, and this frame's have to wait for it)
+		if (animationMode) {
+			setFrameCamera(keyframes, i, frameScene);
+			err = clEnqueueWriteBuffer(queue, clBuffer1, CL_FALSE, 0, sizeof(Scene), &frameScene, 0, NULL, NULL);
 			if (err != CL_SUCCESS) {
-				printf("Couldn't set the kernel(11) argument = %d\n", err);
+				printf("Couldn't write the camera of frame %d = %d\n", i, err);
 				exit(1);
 			}
-			err = clEnqueueNDRangeKernel(queue, kernel, 2, workOffset, workSize, NULL, 0, NULL, NULL);
-			if (err != CL_SUCCESS) {
-				printf("Couldn't enqueue the kernel execution (%d) command = %d\n", pos, err);
+			phases.endPhase("camera update");
+		}
+
+		// rows of tiles are written to the output as they're read back, so rendering and writing the image are one phase
+		if (streamMode) {
+			if (!renderStreamed(streamed, queue, readQueue, kernel, outputFilename, tracing ? &trace : NULL, i)) {
+				printf("Couldn't write the streamed image to %s\n", outputFilename);
 				exit(1);
 			}
+			phases.endPhase("streamed render");
+			continue;
+		}
+
+		// passes over the whole image rather than tiles, then the sums so far are read back as the image
+		if (progressiveMode) {
+			ProgressiveBudget budget = { targetSamples, timeLimit, startTime, outputFilename, intermediateEvery };
+			progressivePasses = renderProgressive(progressive, queue, clBuffer7, budget, buffer, tracing ? &trace : NULL, i);
+			phases.endPhase("kernel execution");
 
+			resolveProgressive(progressive, queue, NULL);
 			err = clEnqueueReadBuffer(queue, clBuffer7, CL_TRUE, 0, sizeof(int) * width * height, buffer, 0, NULL, NULL);
 			if (err != CL_SUCCESS) {
-				printf("Couldn't enqueue the read buffer (%d) command = %d\n", pos, err);
+				printf("Couldn't read the progressive image = %d\n", err);
 				exit(1);
 			}
+			phases.endPhase("readback");
+			continue;
+		}
+
+		// kernel of the last tile (the queue is in order, so every tile has been rendered once it finishes)
+		cl_event lastKernelEvent = NULL;
 
-			pos++;
+		// the cheap pass covers the whole image before any tile is refined
+		if (adaptiveMode) {
+			cl_event baseEvent;
+			renderBaseAdaptive(adaptive, queue, tracing ? &baseEvent : NULL);
+			if (tracing) {
+				trace.deviceCommand("adaptive base", TRACK_KERNELS, baseEvent, baseEvent, i, -1, 0, 0);
+				clReleaseEvent(baseEvent);
+			}
 		}
-		timer.end();																					// record end time
-		if (i > 0)
-		{
-			totalTime += timer.getMilliseconds();														// record total time taken
+
+		for (int j = 0; j < numOfTiles; j++) {
+			// wait for the tile that last used this slot to finish reading back
+			cl_event* readEvent = &readEvents[j % MAX_TILES_IN_FLIGHT];
+			if (j >= MAX_TILES_IN_FLIGHT) {
+				std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+				clWaitForEvents(1, readEvent);
+				clReleaseEvent(*readEvent);
+				if (tracing) trace.hostSpan("wait for readback", TRACK_HOST_WAITS, waitStart, std::chrono::steady_clock::now());
+			}
+
+			// position and size of this tile
+			size_t tileX = (j % tilesX) * blockSize;
+			size_t tileY = (j / tilesX) * blockSize;
+			size_t workOffset[] = { tileX, tileY };
+			size_t workSize[] = { std::min((size_t)blockSize, width - tileX), std::min((size_t)blockSize, height - tileY) };
+
+			// the tile goes at the top of its slot's buffer (which the slot's last read has finished with)
+			int slot = j % MAX_TILES_IN_FLIGHT;
+			if (tileBuffersUsed) {
+				int tileFirstRow = (int)tileY;
+				err = clSetKernelArg(kernel, FUNC_OUT_ARG, sizeof(cl_mem), &tileBuffers[slot]);
+				if (err == CL_SUCCESS) err = clSetKernelArg(kernel, FUNC_OUT_FIRST_ROW_ARG, sizeof(int), &tileFirstRow);
+				if (err != CL_SUCCESS) {
+					printf("Couldn't set the tile buffer (%d) arguments = %d\n", j, err);
+					exit(1);
+				}
+			}
+
+			// the wavefront renderer takes several commands per tile, the trace spans from the first to the last
+			cl_event kernelEvent, firstKernelEvent;
+			if (wavefrontMode) {
+				renderTileWavefront(wavefront, queue, (int)tileX, (int)tileY, (int)workSize[0], (int)workSize[1], tracing ? &firstKernelEvent : NULL, &kernelEvent);
+			}
+			else if (adaptiveMode) {
+				refineTileAdaptive(adaptive, queue, workOffset, workSize, &kernelEvent);
+			}
+			else {
+				err = clEnqueueNDRangeKernel(queue, kernel, 2, workOffset, workSize, NULL, 0, NULL, &kernelEvent);
+				if (err != CL_SUCCESS) {
+					printf("Couldn't enqueue the kernel execution (%d) command = %d\n", j, err);
+					exit(1);
+				}
+			}
+			clFlush(queue);
+
+			// read back just this tile's rectangle once the kernel has finished with it (into its own row of the image)
+			cl_command_queue tileReadQueue = tileBuffersUsed ? readQueue : queue;
+			size_t bufferOrigin[] = { tileX * sizeof(int), tileBuffersUsed ? 0 : tileY, 0 };
+			size_t hostOrigin[] = { tileX * sizeof(int), tileY, 0 };
+			size_t region[] = { workSize[0] * sizeof(int), workSize[1], 1 };
+			err = clEnqueueReadBufferRect(tileReadQueue, tileBuffersUsed ? tileBuffers[slot] : clBuffer7, CL_FALSE, bufferOrigin, hostOrigin, region,
+				sizeof(int) * width, 0, sizeof(int) * width, 0, buffer, 1, &kernelEvent, readEvent);
+			if (err != CL_SUCCESS) {
+				printf("Couldn't enqueue the read buffer (%d) command = %d\n", j, err);
+				exit(1);
+			}
+			clFlush(tileReadQueue);
+
+			if (tracing) {
+				trace.deviceCommand("tile kernel", TRACK_KERNELS, wavefrontMode ? firstKernelEvent : kernelEvent, kernelEvent, i, j, (int)tileX, (int)tileY);
+				trace.deviceCommand("tile readback", TRACK_READBACKS, *readEvent, *readEvent, i, j, (int)tileX, (int)tileY);
+				if (wavefrontMode) clReleaseEvent(firstKernelEvent);
+			}
+
+			if (j == numOfTiles - 1) lastKernelEvent = kernelEvent;
+			else clReleaseEvent(kernelEvent);
 		}
-		else
-		{
-			firstTime = timer.getMilliseconds();														// record first time taken
+
+		// reads overlap the rendering of later tiles, so kernel execution runs until the last tile is rendered and readback is what's left after it
+		clWaitForEvents(1, &lastKernelEvent);
+		clReleaseEvent(lastKernelEvent);
+		phases.endPhase("kernel execution");
+
+		// wait for the last tiles to finish reading back
+		for (int j = std::max(0, numOfTiles - MAX_TILES_IN_FLIGHT); j < numOfTiles; j++) {
+			std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+			clWaitForEvents(1, &readEvents[j % MAX_TILES_IN_FLIGHT]);
+			clReleaseEvent(readEvents[j % MAX_TILES_IN_FLIGHT]);
+			if (tracing) trace.hostSpan("wait for readback", TRACK_HOST_WAITS, waitStart, std::chrono::steady_clock::now());
+		}
+		phases.endPhase("readback");
+
+		// the frame is written out while the next one renders into the other image (this only waits if the last frame's write is still going)
+		if (animationMode) {
+			writeFrame(frameWriter, frameFilename(outputFilename, i), buffer, width, height);
+			std::swap(buffer, writingImage);
+			phases.endPhase("frame hand-off");
 		}
 	}
 
-	// output timing information (first run, times run and average)
-	if (times > 1)
-	{
-		printf("first run time: %dms, subsequent average time taken (%d run(s)): %.1fms\n", firstTime, times - 1, totalTime / (float)(times - 1));
+	// output BMP file (already written by streamed renders, and a frame at a time by animations)
+	if (animationMode) {
+		phases.restart();
+		finishFrameWriter(frameWriter);
+		phases.endOneOffPhase("image write");
+
+		double framesMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - framesStart).count();
+		printf("animation: %d frames from %d keyframes in %.1f ms (%.2f frames per second), written to %s ... %s\n", times, (int)keyframes.size(),
+			framesMilliseconds, times * 1000.0 / framesMilliseconds, frameFilename(outputFilename, 0).c_str(), frameFilename(outputFilename, times - 1).c_str());
 	}
-	else
-	{
-		printf("first run time: %dms, subsequent average time taken (%d run(s)): N/A\n", firstTime, times - 1);
+	else if (!streamMode) {
+		phases.restart();
+		write_bmp(outputFilename, buffer, width, height, width);
+		phases.endOneOffPhase("image write");
+	}
+
+	// output timing information (each phase of the first run and the average of the rest, then the same as JSON)
+	phases.print();
+	phases.printJSON();
+
+	if (tracing) {
+		if (trace.write(traceFilename)) printf("trace written to %s\n", traceFilename);
+		else printf("Couldn't write the trace to %s\n", traceFilename);
+	}
+
+	if (adaptiveMode) {
+		// the refined count is from the last run, each pixel has the cheap grid's samples and refined pixels the full grid's too
+		unsigned int refinedPixels = getRefinedPixels(adaptive, queue);
+		int baseLevel = adaptiveBaseLevel(samples);
+		unsigned long long samplesRendered = (unsigned long long)width * height * baseLevel * baseLevel + (unsigned long long)refinedPixels * samples * samples;
+		printSamplesSaved(samplesRendered, refinedPixels, width, height, samples);
+	}
+	if (progressiveMode) {
+		printf("progressive: %d of %d samples per pixel (%s)\n", progressivePasses, samples * samples,
+			progressivePasses < targetSamples ? "stopped by the time limit" : "target reached");
 	}
+	if (referenceFilename != NULL) printReferenceError(buffer, width, height, referenceFilename);
 
-	// output BMP file
-	write_bmp(outputFilename, buffer, width, height, width);
+	// the counts are from the last run (every run renders every pixel), read back once the timing is done with
+	if (heatmapMode) {
+		cl_uint4* counts = new cl_uint4[width * height];
+		err = clEnqueueReadBuffer(queue, clBuffer13, CL_TRUE, 0, sizeof(cl_uint4) * width * height, counts, 0, NULL, NULL);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't read the heatmap counts = %d\n", err);
+			exit(1);
+		}
+		writeHeatmaps(outputFilename, counts, width, height, samples);
+		delete[] counts;
+	}
 
 	//free openCl memory : ) 
 	clReleaseMemObject(clBuffer1);
@@ -622,9 +1373,27 @@ int main(int argc, char* argv[])
 	clReleaseMemObject(clBuffer4);
 	clReleaseMemObject(clBuffer5);
 	clReleaseMemObject(clBuffer6);
-	clReleaseMemObject(clBuffer7);
+	if (tileBuffersUsed) {
+		for (int slot = 0; slot < MAX_TILES_IN_FLIGHT; ++slot) clReleaseMemObject(tileBuffers[slot]);
+	}
+	else if (!streamMode) clReleaseMemObject(clBuffer7);
+	clReleaseMemObject(clBuffer8);
+	clReleaseMemObject(clBuffer9);
+	clReleaseMemObject(clBuffer10);
+	clReleaseMemObject(clBuffer11);
+	clReleaseMemObject(clBuffer12);
+	clReleaseMemObject(clBuffer14);
+	if (heatmapMode) clReleaseMemObject(clBuffer13);
+	if (wavefrontMode) releaseWavefront(wavefront);
+	if (adaptiveMode) releaseAdaptive(adaptive);
+	if (progressiveMode) releaseProgressive(progressive);
+	if (streamMode) releaseStreamed(streamed);
+	delete[] buffer;
+	delete[] writingImage;
 	clReleaseCommandQueue(queue);
-	clReleaseProgram(program);
+	clReleaseCommandQueue(readQueue);
 	clReleaseKernel(kernel);
+	clReleaseProgramCache();
 	clReleaseContext(context);
+	releaseDevices(devices);
 }
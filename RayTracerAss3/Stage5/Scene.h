@@ -9,6 +9,12 @@
 
 #include "SceneObjects.h"
 
+// acceleration structure node (see BVH.h)
+struct BVHNode;
+
+// light hierarchy node (see LightTree.h)
+struct LightNode;
+
 // description of a single static scene
 typedef struct Scene 
 {
@@ -26,6 +32,8 @@ typedef struct Scene
 	unsigned int numSpheres;
 	unsigned int numPlanes;
 	unsigned int numCylinders;
+	unsigned int numBVHNodes;
+	unsigned int numLightNodes;
 
 	// scene objects
 	Material* materialContainer;	
@@ -33,6 +41,21 @@ typedef struct Scene
 	Sphere* sphereContainer;
 	Plane* planeContainer;
 	Cylinder* cylinderContainer;
+
+	// bounding volume hierarchy over the spheres and cylinders (built by buildBVH)
+	BVHNode* bvhContainer;
+	unsigned int* bvhPrimitiveContainer;
+
+	// intersection data for the spheres and cylinders, in the order the hierarchy references them (built by compileScene)
+	cl_float4* primitiveShapeContainer;
+	cl_float4* primitiveAxisContainer;
+	float* primitiveRadiusTermContainer;
+
+	// hierarchy over the lights for sampling them with -manyLights (built by buildLightTree)
+	LightNode* lightTreeContainer;
+
+	// the kernel points this at the counters of the pixel it's rendering in -heatmap builds (unused on the host)
+	void* heatmapCounts;
 } Scene;
 
 bool init(const char* inputName, Scene& scene);
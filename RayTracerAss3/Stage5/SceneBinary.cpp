@@ -0,0 +1,337 @@
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <map>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "SceneBinary.h"
+#include "BVH.h"
+
+// "RTSB" read as a little endian int
+static const unsigned int BINARY_SCENE_MAGIC = 0x42535452;
+static const unsigned int BINARY_SCENE_VERSION = 1;
+
+// arrays start on a multiple of this (the map itself starts on a page, so Point's alignment holds)
+static const unsigned long long BINARY_SCENE_ALIGNMENT = 16;
+
+// arrays of a binary scene, in the order they're stored
+enum BinarySceneArray { ARRAY_MATERIALS, ARRAY_LIGHTS, ARRAY_SPHERES, ARRAY_PLANES, ARRAY_CYLINDERS,
+	ARRAY_BVH_NODES, ARRAY_BVH_PRIMITIVES, ARRAY_PRIMITIVE_SHAPES, ARRAY_PRIMITIVE_AXES, ARRAY_PRIMITIVE_RADIUS_TERMS, NUM_BINARY_SCENE_ARRAYS };
+
+// start of a binary scene
+typedef struct BinarySceneHeader
+{
+	unsigned int magic;
+	unsigned int version;
+
+	// size of each array's elements, so a file written with a different layout is turned away rather than misread
+	unsigned int elementSizes[NUM_BINARY_SCENE_ARRAYS];
+
+	Point cameraPosition;
+	float cameraRotation;
+	float cameraFieldOfView;
+	float exposure;
+	unsigned int skyboxMaterialId;
+
+	unsigned int numMaterials;
+	unsigned int numLights;
+	unsigned int numSpheres;
+	unsigned int numPlanes;
+	unsigned int numCylinders;
+	unsigned int numBVHNodes;
+
+	// where each array starts from the start of the file, and how many elements it has
+	unsigned long long offsets[NUM_BINARY_SCENE_ARRAYS];
+	unsigned long long counts[NUM_BINARY_SCENE_ARRAYS];
+
+	unsigned long long fileSize;
+} BinarySceneHeader;
+
+// element sizes of this build's layout
+static void getElementSizes(unsigned int elementSizes[NUM_BINARY_SCENE_ARRAYS])
+{
+	elementSizes[ARRAY_MATERIALS] = sizeof(Material);
+	elementSizes[ARRAY_LIGHTS] = sizeof(Light);
+	elementSizes[ARRAY_SPHERES] = sizeof(Sphere);
+	elementSizes[ARRAY_PLANES] = sizeof(Plane);
+	elementSizes[ARRAY_CYLINDERS] = sizeof(Cylinder);
+	elementSizes[ARRAY_BVH_NODES] = sizeof(BVHNode);
+	elementSizes[ARRAY_BVH_PRIMITIVES] = sizeof(unsigned int);
+	elementSizes[ARRAY_PRIMITIVE_SHAPES] = sizeof(cl_float4);
+	elementSizes[ARRAY_PRIMITIVE_AXES] = sizeof(cl_float4);
+	elementSizes[ARRAY_PRIMITIVE_RADIUS_TERMS] = sizeof(float);
+}
+
+bool isBinaryScene(const char* filename)
+{
+	FILE* file = fopen(filename, "rb");
+	if (file == NULL) return false;
+
+	unsigned int magic = 0;
+	bool binary = fread(&magic, sizeof(magic), 1, file) == 1 && magic == BINARY_SCENE_MAGIC;
+	fclose(file);
+
+	return binary;
+}
+
+bool writeBinaryScene(const char* filename, const Scene& scene)
+{
+	unsigned int numPrimitives = scene.numSpheres + scene.numCylinders;
+
+	const void* arrays[NUM_BINARY_SCENE_ARRAYS] = { scene.materialContainer, scene.lightContainer, scene.sphereContainer, scene.planeContainer, scene.cylinderContainer,
+		scene.bvhContainer, scene.bvhPrimitiveContainer, scene.primitiveShapeContainer, scene.primitiveAxisContainer, scene.primitiveRadiusTermContainer };
+
+	BinarySceneHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = BINARY_SCENE_MAGIC;
+	header.version = BINARY_SCENE_VERSION;
+	getElementSizes(header.elementSizes);
+
+	header.cameraPosition = scene.cameraPosition;
+	header.cameraRotation = scene.cameraRotation;
+	header.cameraFieldOfView = scene.cameraFieldOfView;
+	header.exposure = scene.exposure;
+	header.skyboxMaterialId = scene.skyboxMaterialId;
+
+	header.numMaterials = scene.numMaterials;
+	header.numLights = scene.numLights;
+	header.numSpheres = scene.numSpheres;
+	header.numPlanes = scene.numPlanes;
+	header.numCylinders = scene.numCylinders;
+	header.numBVHNodes = scene.numBVHNodes;
+
+	header.counts[ARRAY_MATERIALS] = scene.numMaterials;
+	header.counts[ARRAY_LIGHTS] = scene.numLights;
+	header.counts[ARRAY_SPHERES] = scene.numSpheres;
+	header.counts[ARRAY_PLANES] = scene.numPlanes;
+	header.counts[ARRAY_CYLINDERS] = scene.numCylinders;
+	header.counts[ARRAY_BVH_NODES] = scene.numBVHNodes;
+	header.counts[ARRAY_BVH_PRIMITIVES] = scene.numBVHNodes > 0 ? numPrimitives : 0;
+	header.counts[ARRAY_PRIMITIVE_SHAPES] = numPrimitives;
+	header.counts[ARRAY_PRIMITIVE_AXES] = numPrimitives;
+	header.counts[ARRAY_PRIMITIVE_RADIUS_TERMS] = numPrimitives;
+
+	// lay the arrays out one after the other, each starting on the alignment
+	unsigned long long offset = sizeof(BinarySceneHeader);
+	for (int i = 0; i < NUM_BINARY_SCENE_ARRAYS; ++i)
+	{
+		offset = (offset + BINARY_SCENE_ALIGNMENT - 1) / BINARY_SCENE_ALIGNMENT * BINARY_SCENE_ALIGNMENT;
+		header.offsets[i] = offset;
+		offset += header.counts[i] * header.elementSizes[i];
+	}
+	header.fileSize = offset;
+
+	FILE* file = fopen(filename, "wb");
+	if (file == NULL) return false;
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+	static const char padding[BINARY_SCENE_ALIGNMENT] = {};
+	unsigned long long position = sizeof(header);
+	for (int i = 0; i < NUM_BINARY_SCENE_ARRAYS && written; ++i)
+	{
+		if (header.offsets[i] > position) written = fwrite(padding, 1, (size_t)(header.offsets[i] - position), file) == header.offsets[i] - position;
+		size_t size = (size_t)(header.counts[i] * header.elementSizes[i]);
+		if (size > 0 && written) written = fwrite(arrays[i], 1, size, file) == size;
+		position = header.offsets[i] + size;
+	}
+
+	return fclose(file) == 0 && written;
+}
+
+// size of each binary scene's mapping, by where its materials start (so unloadBinaryScene can find it from the scene)
+static std::map<const void*, std::pair<const unsigned char*, unsigned long long> > mappings;
+
+// map a whole file read only, returning NULL if it can't be
+static const unsigned char* mapFile(const char* filename, unsigned long long* size)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) return NULL;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return NULL;
+	}
+
+	// the view keeps the file open once the handles are closed
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL) return NULL;
+
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (view == NULL) return NULL;
+
+	*size = (unsigned long long)fileSize.QuadPart;
+	return (const unsigned char*)view;
+#else
+	int file = open(filename, O_RDONLY);
+	if (file < 0) return NULL;
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size == 0) {
+		close(file);
+		return NULL;
+	}
+
+	// the mapping keeps the file open once it's closed
+	void* view = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (view == MAP_FAILED) return NULL;
+
+	*size = (unsigned long long)status.st_size;
+	return (const unsigned char*)view;
+#endif
+}
+
+static void unmapFile(const unsigned char* data, unsigned long long size)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+#else
+	munmap((void*)data, (size_t)size);
+#endif
+}
+
+bool loadBinaryScene(const char* filename, Scene& scene)
+{
+	unsigned long long size = 0;
+	const unsigned char* data = mapFile(filename, &size);
+	if (data == NULL)
+	{
+		fprintf(stderr, "Couldn't map the binary scene %s.\n", filename);
+		return false;
+	}
+
+	const BinarySceneHeader* header = (const BinarySceneHeader*)data;
+	if (size < sizeof(BinarySceneHeader) || header->magic != BINARY_SCENE_MAGIC || header->version != BINARY_SCENE_VERSION || header->fileSize > size)
+	{
+		fprintf(stderr, "Malformed binary scene file: %s isn't a version %u binary scene.\n", filename, BINARY_SCENE_VERSION);
+		unmapFile(data, size);
+		return false;
+	}
+
+	unsigned int elementSizes[NUM_BINARY_SCENE_ARRAYS];
+	getElementSizes(elementSizes);
+	for (int i = 0; i < NUM_BINARY_SCENE_ARRAYS; ++i)
+	{
+		if (header->elementSizes[i] != elementSizes[i] || header->offsets[i] % BINARY_SCENE_ALIGNMENT != 0 ||
+			header->offsets[i] > header->fileSize || header->counts[i] > (header->fileSize - header->offsets[i]) / elementSizes[i])
+		{
+			fprintf(stderr, "Malformed binary scene file: %s was written with a different layout (convert it again).\n", filename);
+			unmapFile(data, size);
+			return false;
+		}
+	}
+
+	// the scene's counts size the arrays everything else indexes, so they must be the counts the arrays were stored with
+	unsigned long long numPrimitives = (unsigned long long)header->numSpheres + header->numCylinders;
+	if (header->counts[ARRAY_MATERIALS] != header->numMaterials || header->counts[ARRAY_LIGHTS] != header->numLights ||
+		header->counts[ARRAY_SPHERES] != header->numSpheres || header->counts[ARRAY_PLANES] != header->numPlanes ||
+		header->counts[ARRAY_CYLINDERS] != header->numCylinders || header->counts[ARRAY_BVH_NODES] != header->numBVHNodes ||
+		header->counts[ARRAY_BVH_PRIMITIVES] != (header->numBVHNodes > 0 ? numPrimitives : 0) ||
+		header->counts[ARRAY_PRIMITIVE_SHAPES] != numPrimitives || header->counts[ARRAY_PRIMITIVE_AXES] != numPrimitives ||
+		header->counts[ARRAY_PRIMITIVE_RADIUS_TERMS] != numPrimitives)
+	{
+		fprintf(stderr, "Malformed binary scene file: %s has counts that don't match its arrays.\n", filename);
+		unmapFile(data, size);
+		return false;
+	}
+
+	// the same material checks as a scene file gets
+	const Sphere* spheres = (const Sphere*)(data + header->offsets[ARRAY_SPHERES]);
+	const Plane* planes = (const Plane*)(data + header->offsets[ARRAY_PLANES]);
+	const Cylinder* cylinders = (const Cylinder*)(data + header->offsets[ARRAY_CYLINDERS]);
+	const char* invalidObject = NULL;
+	unsigned int invalidIndex = 0;
+	for (unsigned int i = 0; i < header->numSpheres && invalidObject == NULL; ++i)
+	{
+		if (spheres[i].materialId >= header->numMaterials) invalidObject = "Sphere", invalidIndex = i;
+	}
+	for (unsigned int i = 0; i < header->numPlanes && invalidObject == NULL; ++i)
+	{
+		if (planes[i].materialId >= header->numMaterials) invalidObject = "Plane", invalidIndex = i;
+	}
+	for (unsigned int i = 0; i < header->numCylinders && invalidObject == NULL; ++i)
+	{
+		if (cylinders[i].materialId >= header->numMaterials) invalidObject = "Cylinder", invalidIndex = i;
+	}
+
+	if (header->skyboxMaterialId >= header->numMaterials)
+	{
+		fprintf(stderr, "Malformed binary scene file: Skybox Material Id not valid in %s.\n", filename);
+		unmapFile(data, size);
+		return false;
+	}
+
+	if (invalidObject != NULL)
+	{
+		fprintf(stderr, "Malformed binary scene file: %s Material Id not valid.\n", invalidObject);
+		fprintf(stderr, "Malformed binary scene file: %s %u in %s.\n", invalidObject, invalidIndex, filename);
+		unmapFile(data, size);
+		return false;
+	}
+
+	scene.cameraPosition = header->cameraPosition;
+	scene.cameraRotation = header->cameraRotation;
+	scene.cameraFieldOfView = header->cameraFieldOfView;
+	scene.exposure = header->exposure;
+	scene.skyboxMaterialId = header->skyboxMaterialId;
+
+	scene.numMaterials = header->numMaterials;
+	scene.numLights = header->numLights;
+	scene.numSpheres = header->numSpheres;
+	scene.numPlanes = header->numPlanes;
+	scene.numCylinders = header->numCylinders;
+	scene.numBVHNodes = header->numBVHNodes;
+
+	// the arrays are never written to once loaded, so they can point straight into the read only mapping
+	scene.materialContainer = (Material*)(data + header->offsets[ARRAY_MATERIALS]);
+	scene.lightContainer = (Light*)(data + header->offsets[ARRAY_LIGHTS]);
+	scene.sphereContainer = (Sphere*)(data + header->offsets[ARRAY_SPHERES]);
+	scene.planeContainer = (Plane*)(data + header->offsets[ARRAY_PLANES]);
+	scene.cylinderContainer = (Cylinder*)(data + header->offsets[ARRAY_CYLINDERS]);
+	scene.bvhContainer = scene.numBVHNodes > 0 ? (BVHNode*)(data + header->offsets[ARRAY_BVH_NODES]) : NULL;
+	scene.bvhPrimitiveContainer = scene.numBVHNodes > 0 ? (unsigned int*)(data + header->offsets[ARRAY_BVH_PRIMITIVES]) : NULL;
+	scene.primitiveShapeContainer = (cl_float4*)(data + header->offsets[ARRAY_PRIMITIVE_SHAPES]);
+	scene.primitiveAxisContainer = (cl_float4*)(data + header->offsets[ARRAY_PRIMITIVE_AXES]);
+	scene.primitiveRadiusTermContainer = (float*)(data + header->offsets[ARRAY_PRIMITIVE_RADIUS_TERMS]);
+
+	scene.numLightNodes = 0;
+	scene.lightTreeContainer = NULL;
+	scene.heatmapCounts = NULL;
+
+	mappings[scene.materialContainer] = std::make_pair(data, size);
+	return true;
+}
+
+void unloadBinaryScene(Scene& scene)
+{
+	std::map<const void*, std::pair<const unsigned char*, unsigned long long> >::iterator it = mappings.find(scene.materialContainer);
+	if (it == mappings.end()) return;
+
+	unmapFile(it->second.first, it->second.second);
+	mappings.erase(it);
+	scene.materialContainer = NULL;
+	scene.lightContainer = NULL;
+	scene.sphereContainer = NULL;
+	scene.planeContainer = NULL;
+	scene.cylinderContainer = NULL;
+	scene.bvhContainer = NULL;
+	scene.bvhPrimitiveContainer = NULL;
+	scene.primitiveShapeContainer = NULL;
+	scene.primitiveAxisContainer = NULL;
+	scene.primitiveRadiusTermContainer = NULL;
+}
@@ -0,0 +1,23 @@
+#ifndef __SCENE_BINARY_H
+#define __SCENE_BINARY_H
+
+#include "Scene.h"
+
+// binary scenes hold the scene's settings followed by every array exactly as it's uploaded to the device
+// (materials, lights, spheres, planes, cylinders, the hierarchy and the compiled streams), so loading one is just mapping the file
+// they're written by -convertScene from a text scene that's had buildBVH and compileScene run on it
+
+// whether a file starts with the binary scene header
+bool isBinaryScene(const char* filename);
+
+// write a scene (with its hierarchy and compiled streams) as a binary scene, returning false if the file can't be written
+bool writeBinaryScene(const char* filename, const Scene& scene);
+
+// map a binary scene and point the scene's arrays straight into it (the file stays mapped until unloadBinaryScene)
+// returns false if it can't be mapped or wasn't written by this build's layout
+bool loadBinaryScene(const char* filename, Scene& scene);
+
+// unmap a scene loaded by loadBinaryScene once nothing's using its arrays (they're left NULL)
+void unloadBinaryScene(Scene& scene);
+
+#endif // __SCENE_BINARY_H
@@ -0,0 +1,92 @@
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include "SceneCompiler.h"
+#include "BVH.h"
+#include "Constants.h"
+
+// set all four components of a stream entry
+static cl_float4 makeFloat4(float x, float y, float z, float w)
+{
+	cl_float4 f;
+	f.s[0] = x;
+	f.s[1] = y;
+	f.s[2] = z;
+	f.s[3] = w;
+	return f;
+}
+
+void compilePrimitive(Scene& scene, unsigned int reference)
+{
+	unsigned int primitive = scene.bvhPrimitiveContainer[reference];
+
+	if (primitive & BVH_CYLINDER_FLAG)
+	{
+		const Cylinder& c = scene.cylinderContainer[primitive & ~BVH_CYLINDER_FLAG];
+		Vector ca = c.p2 - c.p1;
+		float caca = ca * ca;
+
+		scene.primitiveShapeContainer[reference] = makeFloat4(c.p1.x, c.p1.y, c.p1.z, c.size);
+		scene.primitiveAxisContainer[reference] = makeFloat4(ca.x, ca.y, ca.z, caca);
+		scene.primitiveRadiusTermContainer[reference] = c.size * c.size * caca;
+	}
+	else
+	{
+		const Sphere& s = scene.sphereContainer[primitive];
+
+		scene.primitiveShapeContainer[reference] = makeFloat4(s.pos.x, s.pos.y, s.pos.z, s.size * s.size);
+		scene.primitiveAxisContainer[reference] = makeFloat4(0.0f, 0.0f, 0.0f, 0.0f);
+		scene.primitiveRadiusTermContainer[reference] = 0.0f;
+	}
+}
+
+void compileScene(Scene& scene)
+{
+	unsigned int numPrimitives = scene.numSpheres + scene.numCylinders;
+
+	scene.primitiveShapeContainer = NULL;
+	scene.primitiveAxisContainer = NULL;
+	scene.primitiveRadiusTermContainer = NULL;
+
+	if (numPrimitives == 0) return;
+
+	scene.primitiveShapeContainer = new cl_float4[numPrimitives];
+	scene.primitiveAxisContainer = new cl_float4[numPrimitives];
+	scene.primitiveRadiusTermContainer = new float[numPrimitives];
+
+	for (unsigned int i = 0; i < numPrimitives; ++i) compilePrimitive(scene, i);
+}
+
+// note which material types and effects a material needs
+static void markMaterialUsed(const Material& material, bool typesUsed[4], bool& reflection, bool& refraction)
+{
+	typesUsed[material.type] = true;
+	if (material.reflection) reflection = true;
+	if (material.refraction) refraction = true;
+}
+
+std::string getSceneBuildOptions(const Scene& scene, int samples)
+{
+	// only materials on objects are shaded (the skybox just contributes its diffuse colour)
+	bool typesUsed[4] = { false, false, false, false };
+	bool reflection = false, refraction = false;
+
+	for (unsigned int i = 0; i < scene.numSpheres; ++i)
+		markMaterialUsed(scene.materialContainer[scene.sphereContainer[i].materialId], typesUsed, reflection, refraction);
+	for (unsigned int i = 0; i < scene.numPlanes; ++i)
+		markMaterialUsed(scene.materialContainer[scene.planeContainer[i].materialId], typesUsed, reflection, refraction);
+	for (unsigned int i = 0; i < scene.numCylinders; ++i)
+		markMaterialUsed(scene.materialContainer[scene.cylinderContainer[i].materialId], typesUsed, reflection, refraction);
+
+	char options[512];
+	sprintf(options, "-cl-std=CL1.2 -DSCENE_NUM_PLANES=%u -DSCENE_NUM_LIGHTS=%u -DSCENE_HAS_BVH=%d"
+		" -DSCENE_USES_GOURAUD=%d -DSCENE_USES_CHECKERBOARD=%d -DSCENE_USES_CIRCLES=%d -DSCENE_USES_WOOD=%d"
+		" -DSCENE_USES_REFLECTION=%d -DSCENE_USES_REFRACTION=%d -DAA_LEVEL=%d -DMAX_RAYS_CAST=%d",
+		scene.numPlanes, scene.numLights, scene.numBVHNodes > 0,
+		typesUsed[Material::GOURAUD], typesUsed[Material::CHECKERBOARD], typesUsed[Material::CIRCLES], typesUsed[Material::WOOD],
+		reflection, refraction, samples, MAX_RAYS_CAST);
+
+	return std::string(options);
+}
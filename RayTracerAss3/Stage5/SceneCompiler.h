@@ -0,0 +1,23 @@
+#ifndef __SCENE_COMPILER_H
+#define __SCENE_COMPILER_H
+
+#include <string>
+#include "Scene.h"
+
+// compile the spheres and cylinders into the streams the intersection tests read, with the per-primitive constants
+// (radius squared, cylinder axis and its length squared) worked out once here instead of for every ray
+// the streams are stored in the order the hierarchy references the primitives, so buildBVH must be called first
+//   shape:       sphere centre and radius squared, or cylinder first end and radius
+//   axis:        cylinder axis and its length squared (unused for spheres)
+//   radius term: cylinder radius squared times its length squared (unused for spheres)
+void compileScene(Scene& scene);
+
+// compile the entry of the streams at a position in the hierarchy's references again (after its sphere or cylinder has changed)
+void compilePrimitive(Scene& scene, unsigned int reference);
+
+// build options that specialise the OpenCL program for this scene and sample count
+// (primitive and light counts, the material types and effects the objects actually use, and the ray cast limit)
+// scenes with the same options can share a build
+std::string getSceneBuildOptions(const Scene& scene, int samples);
+
+#endif // __SCENE_COMPILER_H
@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SceneEdit.h"
+#include "BVH.h"
+#include "LightTree.h"
+#include "SceneCompiler.h"
+
+// scene buffers in the order createSceneBuffers makes them
+enum SceneBuffer { BUFFER_SCENE, BUFFER_MATERIALS, BUFFER_LIGHTS, BUFFER_SPHERES, BUFFER_PLANES, BUFFER_CYLINDERS, BUFFER_BVH_NODES,
+	BUFFER_BVH_PRIMITIVES, BUFFER_PRIMITIVE_SHAPES, BUFFER_PRIMITIVE_AXES, BUFFER_PRIMITIVE_RADII, BUFFER_LIGHT_NODES };
+
+// objects are compared a member at a time, as the padding between them is never set
+static bool samePoint(const Point& a, const Point& b)
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+static bool sameVector(const Vector& a, const Vector& b)
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+static bool sameColour(const Colour& a, const Colour& b)
+{
+	return a.red == b.red && a.green == b.green && a.blue == b.blue;
+}
+
+void beginSceneEdit(SceneEdit& edit, const Scene& scene)
+{
+	size_t numPrimitives = scene.numSpheres + scene.numCylinders;
+	size_t counts[NUM_SCENE_BUFFERS] = { 1, scene.numMaterials, scene.numLights, scene.numSpheres, scene.numPlanes, scene.numCylinders,
+		scene.numBVHNodes, 0, numPrimitives, numPrimitives, numPrimitives, scene.numLightNodes };
+
+	for (int k = 0; k < NUM_SCENE_BUFFERS; ++k) edit.changed[k].assign(counts[k], false);
+	edit.primitivesChanged = false;
+	edit.lightsChanged = false;
+	edit.objects = 0;
+	edit.writes = 0;
+	edit.bytes = 0;
+}
+
+void editMaterial(Scene& scene, SceneEdit& edit, unsigned int index, const Material& material)
+{
+	Material& m = scene.materialContainer[index];
+	if (m.type == material.type && sameColour(m.diffuse, material.diffuse) && sameColour(m.diffuse2, material.diffuse2) && sameVector(m.offset, material.offset) &&
+		m.size == material.size && sameColour(m.specular, material.specular) && m.power == material.power && m.reflection == material.reflection &&
+		m.refraction == material.refraction && m.density == material.density) return;
+
+	m = material;
+	edit.changed[BUFFER_MATERIALS][index] = true;
+	edit.objects++;
+}
+
+void editLight(Scene& scene, SceneEdit& edit, unsigned int index, const Light& light)
+{
+	Light& l = scene.lightContainer[index];
+	if (samePoint(l.pos, light.pos) && sameColour(l.intensity, light.intensity)) return;
+
+	l = light;
+	edit.changed[BUFFER_LIGHTS][index] = true;
+	edit.lightsChanged = true;
+	edit.objects++;
+}
+
+void editSphere(Scene& scene, SceneEdit& edit, unsigned int index, const Sphere& sphere)
+{
+	Sphere& s = scene.sphereContainer[index];
+	bool moved = !samePoint(s.pos, sphere.pos) || s.size != sphere.size;
+	if (!moved && s.materialId == sphere.materialId) return;
+
+	s = sphere;
+	edit.changed[BUFFER_SPHERES][index] = true;
+	if (moved) edit.primitivesChanged = true;
+	edit.objects++;
+}
+
+void editPlane(Scene& scene, SceneEdit& edit, unsigned int index, const Plane& plane)
+{
+	Plane& p = scene.planeContainer[index];
+	if (samePoint(p.pos, plane.pos) && sameVector(p.normal, plane.normal) && p.materialId == plane.materialId) return;
+
+	p = plane;
+	edit.changed[BUFFER_PLANES][index] = true;
+	edit.objects++;
+}
+
+void editCylinder(Scene& scene, SceneEdit& edit, unsigned int index, const Cylinder& cylinder)
+{
+	Cylinder& c = scene.cylinderContainer[index];
+	bool moved = !samePoint(c.p1, cylinder.p1) || !samePoint(c.p2, cylinder.p2) || c.size != cylinder.size;
+	if (!moved && c.materialId == cylinder.materialId) return;
+
+	c = cylinder;
+	edit.changed[BUFFER_CYLINDERS][index] = true;
+	if (moved) edit.primitivesChanged = true;
+	edit.objects++;
+}
+
+bool diffScene(Scene& scene, SceneEdit& edit, const Scene& edited)
+{
+	if (edited.numMaterials != scene.numMaterials || edited.numLights != scene.numLights || edited.numSpheres != scene.numSpheres ||
+		edited.numPlanes != scene.numPlanes || edited.numCylinders != scene.numCylinders) return false;
+
+	// the header is written whole anyway
+	scene.cameraPosition = edited.cameraPosition;
+	scene.cameraRotation = edited.cameraRotation;
+	scene.cameraFieldOfView = edited.cameraFieldOfView;
+	scene.exposure = edited.exposure;
+	scene.skyboxMaterialId = edited.skyboxMaterialId;
+
+	for (unsigned int i = 0; i < scene.numMaterials; ++i) editMaterial(scene, edit, i, edited.materialContainer[i]);
+	for (unsigned int i = 0; i < scene.numLights; ++i) editLight(scene, edit, i, edited.lightContainer[i]);
+	for (unsigned int i = 0; i < scene.numSpheres; ++i) editSphere(scene, edit, i, edited.sphereContainer[i]);
+	for (unsigned int i = 0; i < scene.numPlanes; ++i) editPlane(scene, edit, i, edited.planeContainer[i]);
+	for (unsigned int i = 0; i < scene.numCylinders; ++i) editCylinder(scene, edit, i, edited.cylinderContainer[i]);
+	return true;
+}
+
+// write each run of changed objects of an array to its place in the buffer
+static void writeChangedRuns(SceneEdit& edit, cl_command_queue queue, cl_mem buffer, const void* objects, size_t objectSize, const std::vector<bool>& changed)
+{
+	size_t first = 0;
+	while (first < changed.size())
+	{
+		if (!changed[first])
+		{
+			++first;
+			continue;
+		}
+
+		size_t end = first + 1;
+		while (end < changed.size() && changed[end]) ++end;
+
+		size_t offset = first * objectSize, size = (end - first) * objectSize;
+		cl_int err = clEnqueueWriteBuffer(queue, buffer, CL_FALSE, offset, size, (const char*)objects + offset, 0, NULL, NULL);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't write the changed objects = %d\n", err);
+			exit(1);
+		}
+		edit.writes++;
+		edit.bytes += size;
+		first = end;
+	}
+}
+
+void applySceneEdit(Scene& scene, SceneEdit& edit, cl_command_queue queue, const cl_mem sceneBuffers[NUM_SCENE_BUFFERS])
+{
+	// the streams are in the hierarchy's order, so find where each moved sphere or cylinder went, then fit the boxes around them
+	if (edit.primitivesChanged)
+	{
+		unsigned int numPrimitives = scene.numSpheres + scene.numCylinders;
+		for (unsigned int i = 0; i < numPrimitives; ++i)
+		{
+			unsigned int primitive = scene.bvhPrimitiveContainer[i];
+			bool changed = primitive & BVH_CYLINDER_FLAG ? edit.changed[BUFFER_CYLINDERS][primitive & ~BVH_CYLINDER_FLAG] : edit.changed[BUFFER_SPHERES][primitive];
+			if (!changed) continue;
+
+			compilePrimitive(scene, i);
+			edit.changed[BUFFER_PRIMITIVE_SHAPES][i] = true;
+			edit.changed[BUFFER_PRIMITIVE_AXES][i] = true;
+			edit.changed[BUFFER_PRIMITIVE_RADII][i] = true;
+		}
+		refitBVH(scene, edit.changed[BUFFER_BVH_NODES]);
+	}
+	if (edit.lightsChanged) refitLightTree(scene, edit.changed[BUFFER_LIGHT_NODES]);
+
+	edit.changed[BUFFER_SCENE][0] = true;
+	writeChangedRuns(edit, queue, sceneBuffers[BUFFER_SCENE], &scene, sizeof(Scene), edit.changed[BUFFER_SCENE]);
+	writeChangedRuns(edit, queue, sceneBuffers[BUFFER_MATERIALS], scene.materialContainer, sizeof(Material), edit.changed[BUFFER_MATERIALS]);
+	writeChangedRuns(edit, queue, sceneBuffers[BUFFER_LIGHTS], scene.lightContainer, sizeof(Light), edit.changed[BUFFER_LIGHTS]);
+	writeChangedRuns(edit, queue, sceneBuffers[BUFFER_SPHERES], scene.sphereContainer, sizeof(Sphere), edit.changed[BUFFER_SPHERES]);
+	writeChangedRuns(edit, queue, sceneBuffers[BUFFER_PLANES], scene.planeContainer, sizeof(Plane), edit.changed[BUFFER_PLANES]);
+	writeChangedRuns(edit, queue, sceneBuffers[BUFFER_CYLINDERS], scene.cylinderContainer, sizeof(Cylinder), edit.changed[BUFFER_CYLINDERS]);
+	writeChangedRuns(edit, queue, sceneBuffers[BUFFER_BVH_NODES], scene.bvhContainer, sizeof(BVHNode), edit.changed[BUFFER_BVH_NODES]);
+	writeChangedRuns(edit, queue, sceneBuffers[BUFFER_PRIMITIVE_SHAPES], scene.primitiveShapeContainer, sizeof(cl_float4), edit.changed[BUFFER_PRIMITIVE_SHAPES]);
+	writeChangedRuns(edit, queue, sceneBuffers[BUFFER_PRIMITIVE_AXES], scene.primitiveAxisContainer, sizeof(cl_float4), edit.changed[BUFFER_PRIMITIVE_AXES]);
+	writeChangedRuns(edit, queue, sceneBuffers[BUFFER_PRIMITIVE_RADII], scene.primitiveRadiusTermContainer, sizeof(float), edit.changed[BUFFER_PRIMITIVE_RADII]);
+	writeChangedRuns(edit, queue, sceneBuffers[BUFFER_LIGHT_NODES], scene.lightTreeContainer, sizeof(LightNode), edit.changed[BUFFER_LIGHT_NODES]);
+}
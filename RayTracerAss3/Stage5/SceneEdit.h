@@ -0,0 +1,43 @@
+#ifndef __SCENE_EDIT_H
+#define __SCENE_EDIT_H
+
+#include <vector>
+#include "LoadCL.h"
+#include "Wavefront.h"
+#include "Scene.h"
+
+// changes made to a scene since it was uploaded, so only what changed is written to the device again
+// (a flag per object of each scene buffer, in the order createSceneBuffers makes them)
+typedef struct SceneEdit
+{
+	std::vector<bool> changed[NUM_SCENE_BUFFERS];
+	bool primitivesChanged;		// spheres or cylinders moved or changed size (so the streams need compiling and the hierarchy refitting)
+	bool lightsChanged;			// lights moved or changed brightness (so the light hierarchy, if there is one, needs refitting)
+	int objects;				// objects changed
+
+	// what applySceneEdit wrote
+	int writes;
+	size_t bytes;
+} SceneEdit;
+
+// start a new set of changes to the scene
+void beginSceneEdit(SceneEdit& edit, const Scene& scene);
+
+// change an object of the scene (an object set to what it already is isn't counted as a change)
+void editMaterial(Scene& scene, SceneEdit& edit, unsigned int index, const Material& material);
+void editLight(Scene& scene, SceneEdit& edit, unsigned int index, const Light& light);
+void editSphere(Scene& scene, SceneEdit& edit, unsigned int index, const Sphere& sphere);
+void editPlane(Scene& scene, SceneEdit& edit, unsigned int index, const Plane& plane);
+void editCylinder(Scene& scene, SceneEdit& edit, unsigned int index, const Cylinder& cylinder);
+
+// change every object of the scene that's different in edited (e.g. the same scene file read again after it was changed),
+// along with the camera, exposure and skybox
+// returns false, leaving the scene as it was, if edited doesn't have the same number of each object (so it would need loading again)
+bool diffScene(Scene& scene, SceneEdit& edit, const Scene& edited);
+
+// compile the changed spheres and cylinders and refit the hierarchies over them, then write the scene header and only the changed
+// runs of objects of each buffer (with a write at the runs' offsets, rather than copying whole arrays again)
+// the writes don't block, and the scene's arrays must stay as they are until the queue has finished them
+void applySceneEdit(Scene& scene, SceneEdit& edit, cl_command_queue queue, const cl_mem sceneBuffers[NUM_SCENE_BUFFERS]);
+
+#endif // __SCENE_EDIT_H
@@ -0,0 +1,174 @@
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SceneReader.h"
+
+// sections are recognised as they're opened and each variable is handed over as soon as its ';' is reached,
+// so the file is never held in memory as a whole
+
+// bytes read from the file at a time
+static const int SCENE_READ_SIZE = 1 << 16;
+
+// the file, a buffer at a time
+typedef struct SceneReader
+{
+	FILE* file;
+	char buffer[SCENE_READ_SIZE];
+	int position, size;
+	int line;
+} SceneReader;
+
+// next character of the file (EOF at the end)
+static int readChar(SceneReader& reader)
+{
+	if (reader.position == reader.size)
+	{
+		reader.size = (int)fread(reader.buffer, 1, SCENE_READ_SIZE, reader.file);
+		reader.position = 0;
+		if (reader.size == 0) return EOF;
+	}
+	return (unsigned char)reader.buffer[reader.position++];
+}
+
+// next character of the file without reading past it
+static int peekChar(SceneReader& reader)
+{
+	int c = readChar(reader);
+	if (c != EOF) reader.position--;
+	return c;
+}
+
+// next character that means anything (comments run from // to the end of the line, and whitespace is ignored everywhere, even inside names and values)
+static int nextChar(SceneReader& reader)
+{
+	for (;;)
+	{
+		int c = readChar(reader);
+		switch (c)
+		{
+		case '\n':
+			reader.line++;
+			break;
+		case ' ': case '\t': case '\r':
+			break;
+		case '/':
+			if (peekChar(reader) != '/') return c;
+			while ((c = readChar(reader)) != EOF && c != '\n');
+			if (c == EOF) return EOF;
+			reader.line++;
+			break;
+		default:
+			return c;
+		}
+	}
+}
+
+// read every section of the file, returning false if it isn't laid out as sections of name = value; pairs
+static bool parseSections(SceneReader& reader, const char* kind, const SectionHandler& handler)
+{
+	std::string name, value;
+
+	for (;;)
+	{
+		// section name, up to its opening brace (anything after the last section is ignored)
+		name.clear();
+		int c;
+		while ((c = nextChar(reader)) != EOF && c != '{') name += (char)c;
+		if (c == EOF) return true;
+
+		if (!handler.beginSection(name, reader.line, handler.context)) return false;
+
+		// variables until the matching closing brace (braces inside a section are allowed, and their variables belong to the section)
+		int depth = 1;
+		name.clear();
+		while (depth > 0)
+		{
+			c = nextChar(reader);
+			switch (c)
+			{
+			case EOF:
+				fprintf(stderr, "Malformed %s file: unterminated section at the end of the file.\n", kind);
+				return false;
+			case '{':
+				++depth;
+				break;
+			case '}':
+				if (!name.empty())
+				{
+					fprintf(stderr, "Malformed %s file: %s has no value (line %d).\n", kind, name.c_str(), reader.line);
+					return false;
+				}
+				--depth;
+				break;
+			case '=':
+				if (name.empty())
+				{
+					fprintf(stderr, "Malformed %s file: value without a name (line %d).\n", kind, reader.line);
+					return false;
+				}
+
+				value.clear();
+				while ((c = nextChar(reader)) != ';')
+				{
+					if (c == EOF || c == '{' || c == '}')
+					{
+						fprintf(stderr, "Malformed %s file: %s isn't ended by a ';' (line %d).\n", kind, name.c_str(), reader.line);
+						return false;
+					}
+					value += (char)c;
+				}
+				if (value.empty())
+				{
+					fprintf(stderr, "Malformed %s file: %s has no value (line %d).\n", kind, name.c_str(), reader.line);
+					return false;
+				}
+
+				if (!handler.setVariable(name, value, reader.line, handler.context)) return false;
+				name.clear();
+				break;
+			default:
+				name += (char)c;
+				break;
+			}
+		}
+
+		if (!handler.endSection(handler.context)) return false;
+	}
+}
+
+bool readSections(const char* filename, const char* kind, const SectionHandler& handler)
+{
+	// the reader's buffer is too big for the stack
+	SceneReader* reader = new SceneReader;
+	reader->file = fopen(filename, "rb");
+	reader->position = reader->size = 0;
+	reader->line = 1;
+	if (reader->file == NULL)
+	{
+		fprintf(stderr, "Malformed %s file: couldn't open %s.\n", kind, filename);
+		delete reader;
+		return false;
+	}
+
+	bool parsed = parseSections(*reader, kind, handler);
+	fclose(reader->file);
+	delete reader;
+	return parsed;
+}
+
+bool parseTriple(const char* value, float* x, float* y, float* z)
+{
+	char* end;
+	*x = strtof(value, &end);
+	if (end == value || *end != ',') return false;
+	value = end + 1;
+	*y = strtof(value, &end);
+	if (end == value || *end != ',') return false;
+	value = end + 1;
+	*z = strtof(value, &end);
+	return end != value;
+}
@@ -0,0 +1,26 @@
+#ifndef __SCENE_READER_H
+#define __SCENE_READER_H
+
+#include <string>
+
+// reads files written the way a scene file is: sections of name = value; pairs, with comments from // to the end of the line
+// and whitespace ignored everywhere (keyframe files are written the same way)
+
+// what to do with each section as it's read (context is handed back to each call)
+// beginSection and setVariable report their own errors and return false to stop reading the file
+typedef struct SectionHandler
+{
+	bool (*beginSection)(const std::string& name, int line, void* context);
+	bool (*setVariable)(const std::string& name, const std::string& value, int line, void* context);
+	bool (*endSection)(void* context);
+	void* context;
+} SectionHandler;
+
+// read every section of a file in a single pass, returning false if it can't be opened, isn't laid out as sections
+// or the handler stops it (errors are reported as a malformed kind file, eg. "Scene")
+bool readSections(const char* filename, const char* kind, const SectionHandler& handler);
+
+// read three comma separated numbers into x, y and z (the same as scanning "%f,%f,%f", but without sscanf's overhead), returning false unless all three are there
+bool parseTriple(const char* value, float* x, float* y, float* z);
+
+#endif // __SCENE_READER_H
@@ -0,0 +1,663 @@
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#include "Server.h"
+#include "MultiDevice.h"
+#include "Streamed.h"
+#include "BVH.h"
+#include "LightTree.h"
+#include "SceneCompiler.h"
+#include "SceneBinary.h"
+#include "SceneEdit.h"
+#include "ImageIO.h"
+#include "EmbeddedCL.h"
+
+// a value of a job's JSON object (strings, numbers, true/false and arrays of numbers are all a job needs)
+typedef struct JobValue
+{
+	enum Type { STRING, NUMBER, BOOLEAN, NUMBERS } type;
+	std::string text;				// strings, and numbers as written (so an id is echoed back unchanged)
+	double number;
+	std::vector<double> numbers;
+} JobValue;
+
+typedef std::map<std::string, JobValue> Job;
+
+static void skipSpace(const char*& p)
+{
+	while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') ++p;
+}
+
+static bool parseString(const char*& p, std::string& value)
+{
+	if (*p != '"') return false;
+	++p;
+	value.clear();
+	while (*p != '"')
+	{
+		if (*p == '\0') return false;
+		if (*p == '\\')
+		{
+			++p;
+			switch (*p)
+			{
+			case 'n': value += '\n'; break;
+			case 't': value += '\t'; break;
+			case '"': case '\\': case '/': value += *p; break;
+			default: return false;
+			}
+			++p;
+			continue;
+		}
+		value += *p++;
+	}
+	++p;
+	return true;
+}
+
+static bool parseNumber(const char*& p, double& value, std::string* text)
+{
+	char* end;
+	value = strtod(p, &end);
+	if (end == p) return false;
+	if (text != NULL) text->assign(p, end - p);
+	p = end;
+	return true;
+}
+
+// parse a line holding a single JSON object of the values above
+static bool parseJob(const char* line, Job& job)
+{
+	const char* p = line;
+	skipSpace(p);
+	if (*p++ != '{') return false;
+	skipSpace(p);
+	if (*p == '}') return true;
+
+	for (;;)
+	{
+		std::string key;
+		skipSpace(p);
+		if (!parseString(p, key)) return false;
+		skipSpace(p);
+		if (*p++ != ':') return false;
+		skipSpace(p);
+
+		JobValue value;
+		value.number = 0.0;
+		if (*p == '"')
+		{
+			value.type = JobValue::STRING;
+			if (!parseString(p, value.text)) return false;
+		}
+		else if (strncmp(p, "true", 4) == 0 || strncmp(p, "false", 5) == 0)
+		{
+			value.type = JobValue::BOOLEAN;
+			value.number = *p == 't' ? 1.0 : 0.0;
+			p += *p == 't' ? 4 : 5;
+		}
+		else if (*p == '[')
+		{
+			value.type = JobValue::NUMBERS;
+			++p;
+			skipSpace(p);
+			while (*p != ']')
+			{
+				double number;
+				if (!parseNumber(p, number, NULL)) return false;
+				value.numbers.push_back(number);
+				skipSpace(p);
+				if (*p == ',') ++p;
+				else if (*p != ']') return false;
+				skipSpace(p);
+			}
+			++p;
+		}
+		else
+		{
+			value.type = JobValue::NUMBER;
+			if (!parseNumber(p, value.number, &value.text)) return false;
+		}
+		job[key] = value;
+
+		skipSpace(p);
+		if (*p == '}') break;
+		if (*p++ != ',') return false;
+	}
+
+	++p;
+	skipSpace(p);
+	return *p == '\0';
+}
+
+static const JobValue* findValue(const Job& job, const char* key, JobValue::Type type)
+{
+	Job::const_iterator it = job.find(key);
+	return it != job.end() && it->second.type == type ? &it->second : NULL;
+}
+
+// append a string to a reply, escaped as JSON
+static void appendString(std::string& reply, const std::string& value)
+{
+	reply += '"';
+	for (size_t i = 0; i < value.size(); ++i)
+	{
+		char c = value[i];
+		if (c == '"' || c == '\\') reply += '\\';
+		if (c == '\n') reply += "\\n";
+		else if (c == '\t') reply += "\\t";
+		else if ((unsigned char)c >= 0x20) reply += c;
+	}
+	reply += '"';
+}
+
+static void appendTime(std::string& reply, const char* key, double milliseconds)
+{
+	char text[64];
+	sprintf(text, ",\"%s\":%.3f", key, milliseconds);
+	reply += text;
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point& start)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double milliseconds = std::chrono::duration<double, std::milli>(now - start).count();
+	start = now;
+	return milliseconds;
+}
+
+void createServer(RenderServer& server, cl_device_id device, bool specialiseProgram, const char* cacheDir, int blockSize)
+{
+	server.device = device;
+	server.specialiseProgram = specialiseProgram;
+	server.cacheDir = cacheDir;
+	server.blockSize = blockSize;
+	server.outBuffer = NULL;
+	server.outBufferPixels = 0;
+	server.image = NULL;
+	server.imagePixels = 0;
+	server.quit = false;
+	server.jobs = 0;
+
+	cl_int err;
+	server.context = clCreateContext(NULL, 1, &device, NULL, NULL, &err);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't create a context\n");
+		exit(1);
+	}
+
+	server.queue = clCreateCommandQueue(server.context, device, 0, &err);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't create the command queue\n");
+		exit(1);
+	}
+}
+
+// the scene, loaded and uploaded the first time a job uses it
+static ResidentScene* findScene(RenderServer& server, const std::string& filename, bool* loaded)
+{
+	std::map<std::string, ResidentScene*>::iterator it = server.scenes.find(filename);
+	*loaded = it == server.scenes.end();
+	if (!*loaded) return it->second;
+
+	ResidentScene* resident = new ResidentScene;
+	resident->editable = !isBinaryScene(filename.c_str());
+	if (!resident->editable)
+	{
+		if (!loadBinaryScene(filename.c_str(), resident->scene))
+		{
+			delete resident;
+			return NULL;
+		}
+	}
+	else
+	{
+		if (!init(filename.c_str(), resident->scene))
+		{
+			delete resident;
+			return NULL;
+		}
+		buildBVH(resident->scene);
+		compileScene(resident->scene);
+	}
+
+	createSceneBuffers(server.context, resident->scene, resident->sceneBuffers);
+	server.scenes[filename] = resident;
+	return resident;
+}
+
+// free the arrays of a scene read from a text file (a binary scene's point into its mapped file)
+static void freeScene(Scene& scene)
+{
+	delete[] scene.materialContainer;
+	delete[] scene.lightContainer;
+	delete[] scene.sphereContainer;
+	delete[] scene.planeContainer;
+	delete[] scene.cylinderContainer;
+	delete[] scene.bvhContainer;
+	delete[] scene.bvhPrimitiveContainer;
+	delete[] scene.primitiveShapeContainer;
+	delete[] scene.primitiveAxisContainer;
+	delete[] scene.primitiveRadiusTermContainer;
+	delete[] scene.lightTreeContainer;
+}
+
+// free a resident scene's arrays (or unmap them, for a binary scene)
+static void releaseResidentScene(ResidentScene* resident)
+{
+	if (resident->editable) freeScene(resident->scene);
+	else unloadBinaryScene(resident->scene);
+}
+
+// change the resident scene to the edited scene file, writing only the objects that are different to the device
+// (or loading it in full when it can't be changed in place), and adding what was done to the reply
+static bool editScene(RenderServer& server, ResidentScene* resident, const std::string& filename, std::string& reply, std::string& error)
+{
+	if (isBinaryScene(filename.c_str())) {
+		error = "an edit has to be a text scene";
+		return false;
+	}
+
+	Scene edited;
+	if (!init(filename.c_str(), edited)) {
+		error = "couldn't read the edited scene";
+		return false;
+	}
+
+	SceneEdit edit;
+	beginSceneEdit(edit, resident->scene);
+	if (resident->editable && diffScene(resident->scene, edit, edited))
+	{
+		// the scene's arrays are only changed again by a later job, after this job's blocking read has waited for the writes
+		applySceneEdit(resident->scene, edit, server.queue, resident->sceneBuffers);
+		freeScene(edited);
+
+		char text[128];
+		sprintf(text, ",\"edit\":\"refit\",\"edited_objects\":%d,\"edit_writes\":%d,\"edit_bytes\":%llu", edit.objects, edit.writes, (unsigned long long)edit.bytes);
+		reply += text;
+		return true;
+	}
+
+	// a different number of objects needs new buffers (and a new hierarchy) anyway, and the last job's blocking read means nothing's still using the old ones
+	for (int j = 0; j < NUM_SCENE_BUFFERS; ++j) clReleaseMemObject(resident->sceneBuffers[j]);
+	releaseResidentScene(resident);
+
+	resident->scene = edited;
+	resident->editable = true;
+	buildBVH(resident->scene);
+	compileScene(resident->scene);
+	createSceneBuffers(server.context, resident->scene, resident->sceneBuffers);
+	reply += ",\"edit\":\"reloaded\"";
+	return true;
+}
+
+// func built for the scene and sample count (programs come from the program cache, so scenes with the same options share one)
+static cl_kernel findKernel(RenderServer& server, const Scene& scene, int samples, ProgramOrigin* origin, std::string& error)
+{
+	std::string buildOptions = server.specialiseProgram ? getSceneBuildOptions(scene, samples) : std::string("-cl-std=CL1.2");
+
+	cl_int err;
+	cl_program program = clBuildProgramCached(server.context, server.device, embeddedRaytraceCL, buildOptions.c_str(), server.cacheDir, origin, &err);
+	if (program == NULL || err != CL_SUCCESS) {
+		if (program != NULL) clReleaseProgram(program);
+		error = "couldn't build the program";
+		return NULL;
+	}
+
+	std::map<cl_program, cl_kernel>::iterator it = server.kernels.find(program);
+	if (it != server.kernels.end()) return it->second;
+
+	cl_kernel kernel = clCreateKernel(program, "func", &err);
+	if (err != CL_SUCCESS) {
+		error = "couldn't create the kernel";
+		return NULL;
+	}
+	server.kernels[program] = kernel;
+	return kernel;
+}
+
+// grow the device and host images to hold at least pixels
+static void reserveImage(RenderServer& server, size_t pixels)
+{
+	if (pixels > server.outBufferPixels)
+	{
+		if (server.outBuffer != NULL) clReleaseMemObject(server.outBuffer);
+
+		cl_int err;
+		server.outBuffer = clCreateBuffer(server.context, CL_MEM_WRITE_ONLY, sizeof(int) * pixels, NULL, &err);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't create the output buffer -> %d\n", err);
+			exit(1);
+		}
+		server.outBufferPixels = pixels;
+	}
+
+	if (pixels > server.imagePixels)
+	{
+		delete[] server.image;
+		server.image = new unsigned int[pixels];
+		server.imagePixels = pixels;
+	}
+}
+
+static void setKernelArg(cl_kernel kernel, cl_uint index, size_t size, const void* value)
+{
+	cl_int err = clSetKernelArg(kernel, index, size, value);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't set the kernel(%u) argument = %d\n", index, err);
+		exit(1);
+	}
+}
+
+// render the whole image with func into the server's image
+static void renderImage(RenderServer& server, cl_kernel kernel, ResidentScene* resident, const Scene& jobScene, int width, int height, int samples)
+{
+	cl_int err;
+
+	// the resident buffers are shared by every job on the scene, only the header changes (for the job's camera)
+	err = clEnqueueWriteBuffer(server.queue, resident->sceneBuffers[0], CL_FALSE, 0, sizeof(Scene), &jobScene, 0, NULL, NULL);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't write the scene header = %d\n", err);
+		exit(1);
+	}
+
+	// kernels are shared between scenes (and sizes), so all of func's arguments are set for each job
+	int outFirstRow = 0;
+	setKernelArg(kernel, 0, sizeof(cl_mem), &resident->sceneBuffers[0]);
+	setKernelArg(kernel, 1, sizeof(int), &width);
+	setKernelArg(kernel, 2, sizeof(int), &height);
+	setKernelArg(kernel, 3, sizeof(int), &samples);
+	for (int j = 1; j < NUM_SCENE_BUFFERS; ++j) setKernelArg(kernel, j + 3, sizeof(cl_mem), &resident->sceneBuffers[j]);
+	setKernelArg(kernel, FUNC_OUT_ARG, sizeof(cl_mem), &server.outBuffer);
+	setKernelArg(kernel, FUNC_OUT_FIRST_ROW_ARG, sizeof(int), &outFirstRow);
+
+	for (size_t tileY = 0; tileY < (size_t)height; tileY += server.blockSize)
+	{
+		for (size_t tileX = 0; tileX < (size_t)width; tileX += server.blockSize)
+		{
+			size_t workOffset[] = { tileX, tileY };
+			size_t workSize[] = { std::min((size_t)server.blockSize, width - tileX), std::min((size_t)server.blockSize, height - tileY) };
+			err = clEnqueueNDRangeKernel(server.queue, kernel, 2, workOffset, workSize, NULL, 0, NULL, NULL);
+			if (err != CL_SUCCESS) {
+				printf("Couldn't enqueue the kernel execution command = %d\n", err);
+				exit(1);
+			}
+		}
+	}
+
+	err = clEnqueueReadBuffer(server.queue, server.outBuffer, CL_TRUE, 0, sizeof(int) * width * height, server.image, 0, NULL, NULL);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't read the image = %d\n", err);
+		exit(1);
+	}
+}
+
+// run a job, returning false (with why in error) if it couldn't be, and adding its timing to the reply
+static bool runJob(RenderServer& server, const Job& job, std::chrono::steady_clock::time_point start, std::string& reply, std::string& error)
+{
+	const JobValue* sceneValue = findValue(job, "scene", JobValue::STRING);
+	const JobValue* outputValue = findValue(job, "output", JobValue::STRING);
+	if (sceneValue == NULL || outputValue == NULL) {
+		error = "a job needs a scene and an output";
+		return false;
+	}
+
+	const JobValue* widthValue = findValue(job, "width", JobValue::NUMBER);
+	const JobValue* heightValue = findValue(job, "height", JobValue::NUMBER);
+	const JobValue* samplesValue = findValue(job, "samples", JobValue::NUMBER);
+	int width = widthValue != NULL ? (int)widthValue->number : 1024;
+	int height = heightValue != NULL ? (int)heightValue->number : 1024;
+	int samples = samplesValue != NULL ? (int)samplesValue->number : 1;
+	if (width <= 0 || height <= 0 || samples <= 0) {
+		error = "the size and samples must be positive";
+		return false;
+	}
+
+	bool loaded;
+	ResidentScene* resident = findScene(server, sceneValue->text, &loaded);
+	if (resident == NULL) {
+		error = "couldn't read the scene";
+		return false;
+	}
+	double sceneTime = millisecondsSince(start);
+
+	// edit-to-image latency is edit_ms and everything after it
+	std::string editReply;
+	const JobValue* editValue = findValue(job, "edit", JobValue::STRING);
+	if (editValue != NULL && !editScene(server, resident, editValue->text, editReply, error)) return false;
+	double editTime = millisecondsSince(start);
+
+	// the camera is given the same way as in a scene file (the rotation in degrees)
+	Scene jobScene = resident->scene;
+	const JobValue* positionValue = findValue(job, "cameraPosition", JobValue::NUMBERS);
+	const JobValue* rotationValue = findValue(job, "cameraRotation", JobValue::NUMBER);
+	const JobValue* fieldOfViewValue = findValue(job, "cameraFieldOfView", JobValue::NUMBER);
+	if (positionValue != NULL)
+	{
+		if (positionValue->numbers.size() != 3) {
+			error = "cameraPosition needs three numbers";
+			return false;
+		}
+		jobScene.cameraPosition.x = (float)positionValue->numbers[0];
+		jobScene.cameraPosition.y = (float)positionValue->numbers[1];
+		jobScene.cameraPosition.z = (float)positionValue->numbers[2];
+	}
+	if (rotationValue != NULL) jobScene.cameraRotation = -(float)rotationValue->number * PIOVER180;
+	if (fieldOfViewValue != NULL)
+	{
+		jobScene.cameraFieldOfView = (float)fieldOfViewValue->number;
+		if (jobScene.cameraFieldOfView <= 0.0f || jobScene.cameraFieldOfView >= 189.0f) {
+			error = "cameraFieldOfView is out of range";
+			return false;
+		}
+	}
+
+	ProgramOrigin origin;
+	cl_kernel kernel = findKernel(server, jobScene, samples, &origin, error);
+	if (kernel == NULL) return false;
+	double programTime = millisecondsSince(start);
+
+	reserveImage(server, (size_t)width * height);
+	renderImage(server, kernel, resident, jobScene, width, height, samples);
+	double renderTime = millisecondsSince(start);
+
+	std::ofstream imageFile(outputValue->text.c_str(), std::ios_base::binary);
+	if (!imageFile) {
+		error = "couldn't write the output";
+		return false;
+	}
+	write_bmp_header(imageFile, width, height);
+	write_bmp_rows(imageFile, server.image, width, height, width);
+	imageFile.close();
+	double writeTime = millisecondsSince(start);
+
+	reply += loaded ? ",\"scene\":\"loaded\"" : ",\"scene\":\"resident\"";
+	reply += editReply;
+	reply += origin == PROGRAM_FROM_MEMORY ? ",\"program\":\"resident\"" : origin == PROGRAM_FROM_DISK_CACHE ? ",\"program\":\"cached\"" : ",\"program\":\"compiled\"";
+	appendTime(reply, "scene_ms", sceneTime);
+	if (editValue != NULL) appendTime(reply, "edit_ms", editTime);
+	appendTime(reply, "program_ms", programTime);
+	appendTime(reply, "render_ms", renderTime);
+	appendTime(reply, "image_write_ms", writeTime);
+	return true;
+}
+
+// run a line of input as a job and return its reply (without the newline)
+static std::string serveLine(RenderServer& server, const char* line)
+{
+	std::chrono::steady_clock::time_point received = std::chrono::steady_clock::now();
+
+	std::string reply = "{";
+	Job job;
+	if (!parseJob(line, job))
+	{
+		reply += "\"ok\":false,\"error\":\"the job isn't a JSON object of strings, numbers and arrays of numbers\"}";
+		return reply;
+	}
+
+	// the id is echoed back as it was given, so replies can be matched to jobs
+	Job::const_iterator id = job.find("id");
+	reply += "\"id\":";
+	if (id == job.end()) reply += "null";
+	else if (id->second.type == JobValue::STRING) appendString(reply, id->second.text);
+	else if (id->second.type == JobValue::NUMBER) reply += id->second.text;
+	else reply += "null";
+
+	const JobValue* quit = findValue(job, "quit", JobValue::BOOLEAN);
+	if (quit != NULL && quit->number != 0.0)
+	{
+		server.quit = true;
+		reply += ",\"ok\":true,\"quit\":true}";
+		return reply;
+	}
+
+	std::string timing, error;
+	bool ok = runJob(server, job, received, timing, error);
+	server.jobs++;
+
+	if (ok)
+	{
+		reply += ",\"ok\":true";
+		reply += timing;
+
+		// latency is from receiving the job to its image being written
+		appendTime(reply, "total_ms", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - received).count());
+	}
+	else
+	{
+		reply += ",\"ok\":false,\"error\":";
+		appendString(reply, error);
+	}
+	reply += "}";
+	return reply;
+}
+
+// read a line (of any length) without its newline, returning false at the end of the input
+static bool readLine(FILE* input, std::string& line)
+{
+	line.clear();
+	char chunk[4096];
+	while (fgets(chunk, sizeof(chunk), input) != NULL)
+	{
+		line += chunk;
+		if (!line.empty() && line[line.size() - 1] == '\n')
+		{
+			line.erase(line.size() - 1);
+			if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+			return true;
+		}
+	}
+	return !line.empty();
+}
+
+void serveStream(RenderServer& server, FILE* input, FILE* output)
+{
+	std::string line;
+	while (!server.quit && readLine(input, line))
+	{
+		// blank lines are ignored so a client can keep the connection alive
+		if (line.find_first_not_of(" \t") == std::string::npos) continue;
+
+		std::string reply = serveLine(server, line.c_str());
+		fprintf(output, "%s\n", reply.c_str());
+		fflush(output);
+	}
+}
+
+#ifndef _WIN32
+
+bool serveSocket(RenderServer& server, const char* path)
+{
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path))
+	{
+		printf("the socket path %s is too long\n", path);
+		return false;
+	}
+	strcpy(address.sun_path, path);
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0)
+	{
+		printf("Couldn't create the socket\n");
+		return false;
+	}
+
+	// a socket left behind by an earlier server would stop the bind
+	unlink(path);
+	if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 4) != 0)
+	{
+		printf("Couldn't listen on %s\n", path);
+		close(listener);
+		return false;
+	}
+
+	// a client that goes away before its reply is written shouldn't stop the server
+	signal(SIGPIPE, SIG_IGN);
+
+	while (!server.quit)
+	{
+		int connection = accept(listener, NULL, NULL);
+		if (connection < 0) continue;
+
+		// the connection is read and written as streams, one for each direction
+		FILE* input = fdopen(connection, "r");
+		FILE* output = fdopen(dup(connection), "w");
+		if (input != NULL && output != NULL) serveStream(server, input, output);
+		if (input != NULL) fclose(input);
+		else close(connection);
+		if (output != NULL) fclose(output);
+	}
+
+	close(listener);
+	unlink(path);
+	return true;
+}
+
+#else
+
+bool serveSocket(RenderServer& server, const char* path)
+{
+	printf("-serveSocket isn't supported on Windows, use -serve and pipe the jobs to standard input\n");
+	return false;
+}
+
+#endif
+
+void releaseServer(RenderServer& server)
+{
+	for (std::map<std::string, ResidentScene*>::iterator it = server.scenes.begin(); it != server.scenes.end(); ++it)
+	{
+		for (int j = 0; j < NUM_SCENE_BUFFERS; ++j) clReleaseMemObject(it->second->sceneBuffers[j]);
+		releaseResidentScene(it->second);
+		delete it->second;
+	}
+	server.scenes.clear();
+
+	for (std::map<cl_program, cl_kernel>::iterator it = server.kernels.begin(); it != server.kernels.end(); ++it)
+		clReleaseKernel(it->second);
+	server.kernels.clear();
+
+	if (server.outBuffer != NULL) clReleaseMemObject(server.outBuffer);
+	delete[] server.image;
+	clReleaseCommandQueue(server.queue);
+	clReleaseContext(server.context);
+}
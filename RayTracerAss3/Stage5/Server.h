@@ -0,0 +1,64 @@
+#ifndef __SERVER_H
+#define __SERVER_H
+
+#include <stdio.h>
+#include <map>
+#include <string>
+#include "LoadCL.h"
+#include "Wavefront.h"
+#include "Scene.h"
+
+// a scene kept loaded (and uploaded) between jobs
+typedef struct ResidentScene
+{
+	Scene scene;							// as read from the file (jobs only change the camera of a copy), or as edited since
+	cl_mem sceneBuffers[NUM_SCENE_BUFFERS];
+	bool editable;							// read from a text scene (binary scenes are mapped read only, so they're loaded again instead)
+} ResidentScene;
+
+// long lived renderer for -serve, which keeps its context, built programs and scenes between jobs
+// a job is a line of JSON (one object, no nesting) such as
+//   {"id":1,"scene":"Scenes/cornell.txt","output":"Outputs/job1.bmp","width":256,"height":256,"samples":1,
+//    "cameraPosition":[0,0,-1000],"cameraRotation":0,"cameraFieldOfView":45}
+// where only scene and output are needed (the size defaults to 1024x1024 with 1 sample, and the camera to the scene's own)
+// a job can also give "edit":"Scenes/cornell-edited.txt" to change the resident scene to that scene file before rendering it,
+// writing only the objects that are different to the device and refitting the hierarchy (the edit can be the scene's own file,
+// after it's been saved with changes), which is loaded in full instead if it has a different number of any object
+// and the reply is a line of JSON with the job's id, whether it worked (or why not) and how long each part of it took
+// a job of {"quit":true} stops the server
+typedef struct RenderServer
+{
+	cl_device_id device;
+	cl_context context;
+	cl_command_queue queue;
+
+	std::map<std::string, ResidentScene*> scenes;	// keyed on the scene's filename
+	std::map<cl_program, cl_kernel> kernels;		// func of each program built so far
+
+	cl_mem outBuffer;						// image of the current job (grown when a job needs more)
+	size_t outBufferPixels;
+	unsigned int* image;					// host copy of the image
+	size_t imagePixels;
+
+	bool specialiseProgram;
+	const char* cacheDir;					// NULL disables the program cache on disk
+	int blockSize;
+
+	bool quit;								// set by a quit job
+	int jobs;								// jobs run so far
+} RenderServer;
+
+// create the context and queue the server keeps for its lifetime
+void createServer(RenderServer& server, cl_device_id device, bool specialiseProgram, const char* cacheDir, int blockSize);
+
+// run each line of input as a job, writing each reply as a line to output, until the input ends or a quit job
+void serveStream(RenderServer& server, FILE* input, FILE* output);
+
+// listen on a UNIX socket at path, serving each client connection in turn like serveStream until a quit job
+// returns false if the socket can't be set up (or on Windows, where it isn't supported)
+bool serveSocket(RenderServer& server, const char* path);
+
+// release the scenes, kernels, buffers, queue and context (the programs belong to the program cache)
+void releaseServer(RenderServer& server);
+
+#endif // __SERVER_H
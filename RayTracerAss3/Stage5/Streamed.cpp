@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+
+#include "Streamed.h"
+#include "Constants.h"
+#include "ImageIO.h"
+
+void createStreamed(Streamed& streamed, cl_context context, int width, int height, int blockSize)
+{
+	streamed.width = width;
+	streamed.height = height;
+	streamed.blockSize = blockSize;
+
+	int tileRows = std::min(height, blockSize);
+	streamed.rows = new unsigned int[(size_t)width * std::min(height, STREAM_TILE_ROWS * blockSize)];
+	for (int slot = 0; slot < STREAM_TILE_ROWS; ++slot)
+	{
+		cl_int err;
+		streamed.outBuffers[slot] = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(int) * width * tileRows, NULL, &err);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't create a streamed row buffer -> %d\n", err);
+			exit(1);
+		}
+	}
+}
+
+// wait for a row of tiles to finish reading back, then append it to the file (rows of tiles finish in the order the file wants them)
+static void writeTileRow(Streamed& streamed, std::ofstream& imageFile, cl_event* readEvent, int tileRow, Trace* trace)
+{
+	std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+	clWaitForEvents(1, readEvent);
+	clReleaseEvent(*readEvent);
+	if (trace != NULL) trace->hostSpan("wait for readback", TRACK_HOST_WAITS, waitStart, std::chrono::steady_clock::now());
+
+	int tileY = tileRow * streamed.blockSize;
+	int slot = tileRow % STREAM_TILE_ROWS;
+	int rows = std::min(streamed.blockSize, streamed.height - tileY);
+	write_bmp_rows(imageFile, streamed.rows + (size_t)slot * streamed.blockSize * streamed.width, streamed.width, rows, streamed.width);
+}
+
+bool renderStreamed(Streamed& streamed, cl_command_queue queue, cl_command_queue readQueue, cl_kernel kernel,
+	const char* filename, Trace* trace, int run)
+{
+	cl_int err;
+
+	std::ofstream imageFile(filename, std::ios_base::binary);
+	if (!imageFile) return false;
+	write_bmp_header(imageFile, streamed.width, streamed.height);
+
+	int tilesX = (streamed.width + streamed.blockSize - 1) / streamed.blockSize;
+	int tilesY = (streamed.height + streamed.blockSize - 1) / streamed.blockSize;
+
+	// read back of each row of tiles in the ring (reused once that row has been written)
+	cl_event readEvents[STREAM_TILE_ROWS];
+
+	for (int tileRow = 0; tileRow < tilesY; ++tileRow)
+	{
+		// the row that last used this slot has to be written out before it's rendered over
+		int slot = tileRow % STREAM_TILE_ROWS;
+		if (tileRow >= STREAM_TILE_ROWS) writeTileRow(streamed, imageFile, &readEvents[slot], tileRow - STREAM_TILE_ROWS, trace);
+
+		// the kernel writes each pixel at its row of the image less this, which puts the row of tiles at the start of its slot's buffer
+		size_t tileY = (size_t)tileRow * streamed.blockSize;
+		int outFirstRow = (int)tileY;
+		err = clSetKernelArg(kernel, FUNC_OUT_ARG, sizeof(cl_mem), &streamed.outBuffers[slot]);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't set the kernel(%d) argument = %d\n", FUNC_OUT_ARG, err);
+			exit(1);
+		}
+		err = clSetKernelArg(kernel, FUNC_OUT_FIRST_ROW_ARG, sizeof(int), &outFirstRow);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't set the kernel(%d) argument = %d\n", FUNC_OUT_FIRST_ROW_ARG, err);
+			exit(1);
+		}
+
+		cl_event kernelEvent = NULL;
+		for (int tileColumn = 0; tileColumn < tilesX; ++tileColumn)
+		{
+			size_t tileX = (size_t)tileColumn * streamed.blockSize;
+			size_t workOffset[] = { tileX, tileY };
+			size_t workSize[] = { std::min((size_t)streamed.blockSize, streamed.width - tileX), std::min((size_t)streamed.blockSize, streamed.height - tileY) };
+
+			if (kernelEvent != NULL) clReleaseEvent(kernelEvent);
+			err = clEnqueueNDRangeKernel(queue, kernel, 2, workOffset, workSize, NULL, 0, NULL, &kernelEvent);
+			if (err != CL_SUCCESS) {
+				printf("Couldn't enqueue the kernel execution (%d, %d) command = %d\n", tileColumn, tileRow, err);
+				exit(1);
+			}
+
+			if (trace != NULL) trace->deviceCommand("tile kernel", TRACK_KERNELS, kernelEvent, kernelEvent, run, tileRow * tilesX + tileColumn, (int)tileX, (int)tileY);
+		}
+		clFlush(queue);
+
+		// the queue is in order, so once the row's last tile is rendered the whole row is
+		size_t rows = std::min((size_t)streamed.blockSize, streamed.height - tileY);
+		size_t slotOffset = (size_t)slot * streamed.blockSize * streamed.width;
+		err = clEnqueueReadBuffer(readQueue, streamed.outBuffers[slot], CL_FALSE, 0, sizeof(int) * rows * streamed.width,
+			streamed.rows + slotOffset, 1, &kernelEvent, &readEvents[slot]);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't enqueue the read buffer (row %d) command = %d\n", tileRow, err);
+			exit(1);
+		}
+		clFlush(readQueue);
+
+		if (trace != NULL) trace->deviceCommand("row readback", TRACK_READBACKS, readEvents[slot], readEvents[slot], run, tileRow, 0, (int)tileY);
+		clReleaseEvent(kernelEvent);
+	}
+
+	// write the rows still in the ring
+	for (int tileRow = std::max(0, tilesY - STREAM_TILE_ROWS); tileRow < tilesY; ++tileRow)
+	{
+		writeTileRow(streamed, imageFile, &readEvents[tileRow % STREAM_TILE_ROWS], tileRow, trace);
+	}
+
+	return (bool)imageFile;
+}
+
+void releaseStreamed(Streamed& streamed)
+{
+	for (int slot = 0; slot < STREAM_TILE_ROWS; ++slot) clReleaseMemObject(streamed.outBuffers[slot]);
+	delete[] streamed.rows;
+}
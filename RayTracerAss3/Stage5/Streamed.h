@@ -0,0 +1,36 @@
+#ifndef __STREAMED_H
+#define __STREAMED_H
+
+#include "LoadCL.h"
+#include "Constants.h"
+#include "Trace.h"
+
+// func's output arguments (must match Raytrace.cl)
+const int FUNC_OUT_ARG = 15;
+const int FUNC_OUT_FIRST_ROW_ARG = 16;
+
+// host side of the streamed renderer, which renders the image a row of tiles at a time into a ring of rows
+// and appends each row of tiles to the output file once it's read back, so memory doesn't grow with the image
+typedef struct Streamed
+{
+	unsigned int* rows;			// host copy of the ring (STREAM_TILE_ROWS rows of tiles)
+
+	// device output for each row of tiles in the ring (a buffer each, as a kernel can't write to a buffer, even a different part of it,
+	// while a read on the other queue is using it)
+	cl_mem outBuffers[STREAM_TILE_ROWS];
+
+	int width, height, blockSize;
+} Streamed;
+
+// allocate the ring, on the host and the device
+void createStreamed(Streamed& streamed, cl_context context, int width, int height, int blockSize);
+
+// render the whole image with func into the ring and write it to filename as it goes
+// each tile's kernel and each row's readback are added to the trace if it isn't NULL, returns false if the file can't be written
+bool renderStreamed(Streamed& streamed, cl_command_queue queue, cl_command_queue readQueue, cl_kernel kernel,
+	const char* filename, Trace* trace, int run);
+
+// release the ring
+void releaseStreamed(Streamed& streamed);
+
+#endif // __STREAMED_H
@@ -1,34 +1,15 @@
-// YOU SHOULD _NOT_ NEED TO MODIFY THIS FILE
-
 // simple timer
-// system/OS/core specific functions required for timing
-// to use this file you _MUST_ define either TARGET_PPU, TARGET_SPU, or TARGET_WINDOWS
+// uses std::chrono's steady clock, so it builds anywhere with a C++11 compiler and has sub-millisecond resolution
 
 #ifndef __TIMER_H
 #define __TIMER_H
 
-#if defined(TARGET_PPU)
-	#include <ppu_intrinsics.h>
-#elif defined(TARGET_SPU)
-	#include <spu_mfcio.h>
-#elif defined(TARGET_WINDOWS)
-	#define NOMINMAX			// undefine stupid windows macros that break STL
-	#include <windows.h>
-#else
-	#error Must define one of TARGET_PPU, TARGET_SPU, or TARGET_WINDOWS
-#endif
+#include <chrono>
 
 class Timer
 {
 	// timing variables
-	#if defined(TARGET_PPU)
-		unsigned long long startTicks, finishTicks, usedTicks;
-	#elif defined(TARGET_SPU)
-		static const unsigned int startTicks = 0xFFFFFFFF;
-		unsigned int finishTicks, usedTicks;
-	#elif defined(TARGET_WINDOWS)
-		ULONGLONG startTicks, finishTicks, usedTicks;
-	#endif
+	std::chrono::steady_clock::time_point startTime, finishTime;
 
 public:
 	Timer()
@@ -40,46 +21,42 @@ public:
 	// store start time
 	inline void start()
 	{
-		#if defined(TARGET_PPU)
-			startTicks = __mftb();								
-		#elif defined(TARGET_SPU)
-			spu_write_decrementer(startTicks);
-		#elif defined(TARGET_WINDOWS)
-			startTicks = GetTickCount64();
-		#endif
+		startTime = std::chrono::steady_clock::now();
 	}
 
 	// calculate total time taken
 	inline void end()
 	{
-		#if defined(TARGET_PPU)
-			finishTicks = __mftb();								
-			usedTicks = finishTicks - startTicks;
-		#elif defined(TARGET_SPU)
-			finishTicks = spu_read_decrementer();
-			usedTicks = startTicks - finishTicks;
-		#elif defined(TARGET_WINDOWS)
-			finishTicks = GetTickCount64();						
-			usedTicks = finishTicks - startTicks;
-		#endif
+		finishTime = std::chrono::steady_clock::now();
 	}
 
-	// get raw tick count (different per system/OS/core/whatever)
+	// get raw tick count (nanoseconds)
 	inline unsigned long long getTicks()
 	{
-		return (unsigned long long) usedTicks;
+		return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(finishTime - startTime).count();
 	}
 
 	// get time in milliseconds
 	inline unsigned int getMilliseconds()
 	{
-		#if defined(TARGET_PPU)
-			return (usedTicks * 1000) / 79800000;
-		#elif defined(TARGET_SPU)
-			return usedTicks / 80000;
-		#elif defined(TARGET_WINDOWS)
-			return (unsigned int) usedTicks;
-		#endif
+		return (unsigned int)std::chrono::duration_cast<std::chrono::milliseconds>(finishTime - startTime).count();
+	}
+
+	// get time in milliseconds, including the fraction of a millisecond
+	inline double getMillisecondsPrecise()
+	{
+		return std::chrono::duration<double, std::milli>(finishTime - startTime).count();
+	}
+
+	// get the times the timer was started and ended (e.g. to place them on a timeline)
+	inline std::chrono::steady_clock::time_point getStartTime()
+	{
+		return startTime;
+	}
+
+	inline std::chrono::steady_clock::time_point getEndTime()
+	{
+		return finishTime;
 	}
 };
 
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include "Trace.h"
+
+static const char* trackNames[NUM_TRACKS] = { "host phases", "host waits", "kernels", "readbacks" };
+
+// nanoseconds between two host times
+static long long nanoseconds(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+	return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+}
+
+Trace::Trace()
+{
+	origin = std::chrono::steady_clock::now();
+	deviceOffset = 0;
+}
+
+void Trace::calibrate(cl_command_queue queue)
+{
+	cl_event marker;
+	std::chrono::steady_clock::time_point before = std::chrono::steady_clock::now();
+	if (clEnqueueMarkerWithWaitList(queue, 0, NULL, &marker) != CL_SUCCESS) return;
+	clWaitForEvents(1, &marker);
+	std::chrono::steady_clock::time_point after = std::chrono::steady_clock::now();
+
+	// the marker finished somewhere between the two host times, so assume halfway
+	cl_ulong end;
+	if (clGetEventProfilingInfo(marker, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL) == CL_SUCCESS)
+	{
+		deviceOffset = (nanoseconds(origin, before) + nanoseconds(origin, after)) / 2 - (long long)end;
+	}
+	clReleaseEvent(marker);
+}
+
+void Trace::hostSpan(const char* name, TraceTrack track, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+	TraceHostSpan span = { name, track, nanoseconds(origin, start), nanoseconds(origin, end) };
+	hostSpans.push_back(span);
+}
+
+void Trace::deviceCommand(const char* name, TraceTrack track, cl_event first, cl_event last, int run, int tile, int tileX, int tileY)
+{
+	clRetainEvent(first);
+	clRetainEvent(last);
+
+	TraceDeviceCommand command = { name, track, first, last, run, tile, tileX, tileY };
+	deviceCommands.push_back(command);
+}
+
+// read one of an event's timestamps (converted to nanoseconds since the trace started)
+static long long eventTime(cl_event event, cl_profiling_info info, long long deviceOffset)
+{
+	cl_ulong time = 0;
+	clGetEventProfilingInfo(event, info, sizeof(time), &time, NULL);
+	return (long long)time + deviceOffset;
+}
+
+bool Trace::write(const char* filename)
+{
+	FILE* file = fopen(filename, "w");
+	if (file == NULL) return false;
+
+	// timestamps are in microseconds, each track is a thread of the one process
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Stage5\"}}");
+	for (int track = 0; track < NUM_TRACKS; ++track)
+	{
+		fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", track + 1, trackNames[track]);
+		fprintf(file, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}}", track + 1, track);
+	}
+
+	for (size_t i = 0; i < hostSpans.size(); ++i)
+	{
+		const TraceHostSpan& span = hostSpans[i];
+		fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"host\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+			span.name.c_str(), span.track + 1, span.start / 1000.0, (span.end - span.start) / 1000.0);
+	}
+
+	for (size_t i = 0; i < deviceCommands.size(); ++i)
+	{
+		const TraceDeviceCommand& command = deviceCommands[i];
+		long long queued = eventTime(command.first, CL_PROFILING_COMMAND_QUEUED, deviceOffset);
+		long long submit = eventTime(command.first, CL_PROFILING_COMMAND_SUBMIT, deviceOffset);
+		long long start = eventTime(command.first, CL_PROFILING_COMMAND_START, deviceOffset);
+		long long end = eventTime(command.last, CL_PROFILING_COMMAND_END, deviceOffset);
+
+		// the span is the time on the device, when it was queued and submitted go in the arguments
+		fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"device\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+			"\"args\":{\"run\":%d,\"tile\":%d,\"x\":%d,\"y\":%d,\"queued_us\":%.3f,\"submit_us\":%.3f,\"start_us\":%.3f,\"end_us\":%.3f,\"wait_us\":%.3f}}",
+			command.name, command.track + 1, start / 1000.0, (end - start) / 1000.0,
+			command.run, command.tile, command.tileX, command.tileY, queued / 1000.0, submit / 1000.0, start / 1000.0, end / 1000.0, (start - queued) / 1000.0);
+
+		clReleaseEvent(command.first);
+		clReleaseEvent(command.last);
+	}
+	deviceCommands.clear();
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	return true;
+}
+
+void tracePhase(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, void* context)
+{
+	((Trace*)context)->hostSpan(name, TRACK_HOST_PHASES, start, end);
+}
@@ -0,0 +1,58 @@
+#ifndef __TRACE_H
+#define __TRACE_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include "LoadCL.h"
+
+// rows of the timeline
+enum TraceTrack { TRACK_HOST_PHASES, TRACK_HOST_WAITS, TRACK_KERNELS, TRACK_READBACKS, NUM_TRACKS };
+
+// a span of time on the host
+typedef struct TraceHostSpan
+{
+	std::string name;
+	TraceTrack track;
+	long long start, end;			// nanoseconds since the trace started
+} TraceHostSpan;
+
+// a command on the device (timestamps are read from its events once it has finished)
+typedef struct TraceDeviceCommand
+{
+	const char* name;
+	TraceTrack track;
+	cl_event first, last;			// first and last events of the command (the same unless it took several enqueues)
+	int run, tile, tileX, tileY;
+} TraceDeviceCommand;
+
+// timeline of the host phases and every tile's kernel and readback, written out as Chrome trace event JSON (chrome://tracing or ui.perfetto.dev)
+// device commands need queues created with CL_QUEUE_PROFILING_ENABLE
+class Trace
+{
+	std::chrono::steady_clock::time_point origin;
+	long long deviceOffset;			// add to a device timestamp to get nanoseconds since the trace started
+
+	std::vector<TraceHostSpan> hostSpans;
+	std::vector<TraceDeviceCommand> deviceCommands;
+
+public:
+	Trace();
+
+	// line the device's clock up with the host's (by timing a marker on the queue)
+	void calibrate(cl_command_queue queue);
+
+	// add a span of time on the host
+	void hostSpan(const char* name, TraceTrack track, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+	// add a tile's command on the device, from the queued time of first to the end of last (the events are retained until the trace is written)
+	void deviceCommand(const char* name, TraceTrack track, cl_event first, cl_event last, int run, int tile, int tileX, int tileY);
+
+	// write the timeline (every command must have finished), returning false if the file can't be written
+	bool write(const char* filename);
+};
+
+// PhaseCallback that adds each phase to the trace given as the context
+void tracePhase(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, void* context);
+
+#endif // __TRACE_H
@@ -0,0 +1,394 @@
+﻿// wavefront (split-kernel) renderer
+// instead of following each sample through all of its bounces in one work-item (like func does), every bounce is split
+// into separate kernels that work through a compacted queue of the paths that are still going, so work-items that have
+// finished never sit idle next to ones that are still bouncing through glass
+
+// indices into the counters buffer (see Wavefront.h)
+#define QUEUE_COUNT 0
+#define SHADOW_RAY_COUNT 1
+
+// how a path was lit during the current bounce
+enum PathLighting { UNLIT, LIT_BY_SHADOW_RAYS, LIT_INLINE };
+
+// a single sample being followed through the scene
+typedef struct Path
+{
+	Ray ray;						// ray for the next bounce
+	float3 colour;					// colour gathered so far
+	float3 lighting;				// lighting calculated without shadow rays (when the shadow ray queue is full)
+	float coef;						// amount of ray left to transmit
+	float refractiveIndex;			// current refractive index
+	float lightingCoef;				// amount of this bounce's lighting that makes it back to the camera
+	float skyCoef;					// amount of the environment map picked up at the end of this bounce
+	unsigned int shadowFirst;		// first of this bounce's shadow rays
+	unsigned int numShadowRays;		// number of this bounce's shadow rays
+	enum PathLighting lit;			// how this bounce was lit
+} Path;
+
+// the closest intersection found for a path
+typedef struct Hit
+{
+	float3 pos;						// point of intersection
+	float3 normal;					// normal at point of intersection (only set for cylinders)
+	enum PrimitiveType objectType;	// type of object intersected with
+	unsigned int objectIndex;		// index of object intersected with
+} Hit;
+
+// a light ray waiting to be tested for occlusion, along with the light it'll add if it isn't
+typedef struct ShadowRay
+{
+	Ray ray;
+	float3 diffuse;
+	float3 specular;
+	float dist;						// distance to the light
+	int occluded;					// set by traceShadowRays
+} ShadowRay;
+
+// scene parameters shared by all the wavefront kernels
+#define WAVEFRONT_SCENE_PARAMS __global struct Scene* scenein, \
+	__global Material* materialContainerIn, \
+	__global Light* lightContainerIn, \
+	__global Sphere* sphereContainerIn, \
+	__global Plane* planeContainerIn, \
+	__global Cylinder* cylinderContainerIn, \
+	__global BVHNode* bvhContainerIn, \
+	__global unsigned int* bvhPrimitiveContainerIn, \
+	__global float4* primitiveShapeContainerIn, \
+	__global float4* primitiveAxisContainerIn, \
+	__global float* primitiveRadiusTermContainerIn, \
+	__global LightNode* lightTreeContainerIn
+
+#define WAVEFRONT_SCENE_ARGS scenein, materialContainerIn, lightContainerIn, sphereContainerIn, planeContainerIn, cylinderContainerIn, \
+	bvhContainerIn, bvhPrimitiveContainerIn, primitiveShapeContainerIn, primitiveAxisContainerIn, primitiveRadiusTermContainerIn, \
+	lightTreeContainerIn
+
+Scene bindScene(WAVEFRONT_SCENE_PARAMS)
+{
+	Scene scene = *scenein;
+	scene.materialContainer = materialContainerIn;
+	scene.lightContainer = lightContainerIn;
+	scene.sphereContainer = sphereContainerIn;
+	scene.planeContainer = planeContainerIn;
+	scene.cylinderContainer = cylinderContainerIn;
+	scene.bvhContainer = bvhContainerIn;
+	scene.bvhPrimitiveContainer = bvhPrimitiveContainerIn;
+	scene.primitiveShapeContainer = primitiveShapeContainerIn;
+	scene.primitiveAxisContainer = primitiveAxisContainerIn;
+	scene.primitiveRadiusTermContainer = primitiveRadiusTermContainerIn;
+	scene.lightTreeContainer = lightTreeContainerIn;
+	scene.heatmapCounts = 0;
+
+	return scene;
+}
+
+// position of one of the pixel's samples, returns false if the pixel doesn't have that sample
+// the steps are added up exactly like the loops in func, so the same sub-locations are used
+bool getSample(int x, int y, int sample, int aaLevel, int slotsPerAxis, float* fragmentx, float* fragmenty)
+{
+#ifdef AA_LEVEL
+	aaLevel = AA_LEVEL;
+#endif
+	const float sampleStep = 1.0f / aaLevel;
+
+	*fragmentx = (float)x;
+	for (int i = 0; i < sample / slotsPerAxis; ++i) *fragmentx += sampleStep;
+
+	*fragmenty = (float)y;
+	for (int i = 0; i < sample % slotsPerAxis; ++i) *fragmenty += sampleStep;
+
+	return *fragmentx < x + 1.0f && *fragmenty < y + 1.0f;
+}
+
+// create a path for every sample of the batch's pixels and add them to the queue
+__kernel void generatePaths(WAVEFRONT_SCENE_PARAMS, int width, int height, int aaLevel, int slotsPerAxis,
+	int tileX, int tileY, int tileWidth, int firstPixel,
+	__global Path* paths, __global unsigned int* queue, __global int* counters)
+{
+	Scene scene = bindScene(WAVEFRONT_SCENE_ARGS);
+
+	unsigned int slot = get_global_id(0);
+	int slotsPerPixel = slotsPerAxis * slotsPerAxis;
+	int pixel = firstPixel + slot / slotsPerPixel;
+
+	int x = tileX + pixel % tileWidth - (width / 2);
+	int y = tileY + pixel / tileWidth - (height / 2);
+
+	float fragmentx, fragmenty;
+	if (!getSample(x, y, slot % slotsPerPixel, aaLevel, slotsPerAxis, &fragmentx, &fragmenty)) return;
+
+	// angle between each successive ray cast (per pixel, anti-aliasing uses a fraction of this)
+	const float dirStepSize = 1.0f / (0.5f * width / tan(PIOVER180 * 0.5f * scene.cameraFieldOfView));
+
+	// direction of default forward facing ray
+	float3 dir = { fragmentx * dirStepSize, fragmenty * dirStepSize, 1.0f };
+
+	// rotated direction of ray
+	float3 rotatedDir = {
+		dir.x * cos(scene.cameraRotation) - dir.z * sin(scene.cameraRotation),
+		dir.y,
+		dir.x * sin(scene.cameraRotation) + dir.z * cos(scene.cameraRotation) };
+
+	Path path;
+	path.ray.start = scene.cameraPosition;
+	path.ray.dir = normalise(rotatedDir);
+	path.colour = (float3)(0.0f, 0.0f, 0.0f);
+	path.coef = 1.0f;
+	path.refractiveIndex = DEFAULT_REFRACTIVE_INDEX;
+	path.lit = UNLIT;
+	path.skyCoef = 0.0f;
+
+	paths[slot] = path;
+	queue[atomic_inc(&counters[QUEUE_COUNT])] = slot;
+}
+
+// find the closest intersection for every queued path
+__kernel void intersectPaths(WAVEFRONT_SCENE_PARAMS, __global const Path* paths, __global const unsigned int* queue, __global Hit* hits)
+{
+	Scene scene = bindScene(WAVEFRONT_SCENE_ARGS);
+
+	unsigned int p = queue[get_global_id(0)];
+	Ray viewRay = paths[p].ray;
+
+	Intersection intersect;
+	Hit hit;
+
+	if (!objectIntersection(&scene, &viewRay, &intersect))
+	{
+		hit.objectType = NONE;
+		hits[p] = hit;
+		return;
+	}
+
+	hit.pos = intersect.pos;
+	hit.objectType = intersect.objectType;
+
+	switch (intersect.objectType)
+	{
+	case SPHERE:
+		hit.objectIndex = intersect.sphere - scene.sphereContainer;
+		break;
+	case PLANE:
+		hit.objectIndex = intersect.plane - scene.planeContainer;
+		break;
+	case CYLINDER:
+		hit.objectIndex = intersect.cylinder - scene.cylinderContainer;
+		hit.normal = intersect.normal;
+		break;
+	case NONE:
+		break;
+	}
+
+	hits[p] = hit;
+}
+
+// work out the lighting, shadow rays and next ray for every queued path, adding the ones that keep going to the next queue
+// the lights are done the same way as applyLighting, but the shadow tests are left for traceShadowRays
+__kernel void shadePaths(WAVEFRONT_SCENE_PARAMS, int level, int maxShadowRays,
+	__global Path* paths, __global const unsigned int* queue, __global const Hit* hits,
+	__global unsigned int* nextQueue, __global ShadowRay* shadowRays, __global int* counters)
+{
+	Scene scene = bindScene(WAVEFRONT_SCENE_ARGS);
+
+	unsigned int p = queue[get_global_id(0)];
+	Path path = paths[p];
+	Hit hit = hits[p];
+
+	path.lit = UNLIT;
+	path.skyCoef = 0.0f;
+
+	// nothing hit, so read from the environment map
+	if (hit.objectType == NONE)
+	{
+		if (path.coef > 0.0f) path.skyCoef = path.coef;
+
+		paths[p] = path;
+		return;
+	}
+
+	// rebuild the intersection from the hit
+	Intersection intersect;
+	intersect.objectType = hit.objectType;
+	intersect.pos = hit.pos;
+	intersect.normal = hit.normal;
+
+	switch (hit.objectType)
+	{
+	case SPHERE:
+		intersect.sphere = &scene.sphereContainer[hit.objectIndex];
+		break;
+	case PLANE:
+		intersect.plane = &scene.planeContainer[hit.objectIndex];
+		break;
+	case CYLINDER:
+		intersect.cylinder = &scene.cylinderContainer[hit.objectIndex];
+		break;
+	case NONE:
+		break;
+	}
+
+	calculateIntersectionResponse(&scene, &path.ray, &intersect);
+
+	if (!intersect.insideObject)
+	{
+		path.lightingCoef = path.coef;
+
+		// count the lights facing the surface so all of this path's shadow rays can be stored together
+		unsigned int numShadowRays = 0;
+		for (unsigned int j = 0; j < NUM_LIGHTS(&scene); ++j)
+		{
+			if (dot(scene.lightContainer[j].pos - intersect.pos, intersect.normal) > 0.0f) numShadowRays++;
+		}
+
+		unsigned int first = atomic_add(&counters[SHADOW_RAY_COUNT], numShadowRays);
+
+		if (first + numShadowRays > (unsigned int)maxShadowRays)
+		{
+			// no room left in the shadow ray queue, so just do the lighting here
+			path.lighting = applyLighting(&scene, &path.ray, &intersect);
+			path.lit = LIT_INLINE;
+		}
+		else
+		{
+			path.shadowFirst = first;
+			path.numShadowRays = numShadowRays;
+			path.lit = LIT_BY_SHADOW_RAYS;
+
+			Ray lightRay = { intersect.pos };
+
+			for (unsigned int j = 0; j < NUM_LIGHTS(&scene); ++j)
+			{
+				__global const Light* currentLight = &scene.lightContainer[j];
+
+				lightRay.dir = currentLight->pos - intersect.pos;
+				float angleBetweenLightAndNormal = dot(lightRay.dir, intersect.normal);
+
+				if (angleBetweenLightAndNormal <= 0.0f)
+				{
+					continue;
+				}
+
+				float lightDist = sqrt(dot(lightRay.dir, lightRay.dir));
+				float invLightDist = 1.0f / lightDist;
+				float lightProjection = invLightDist * angleBetweenLightAndNormal;
+				lightRay.dir = lightRay.dir * invLightDist;
+
+				ShadowRay shadowRay;
+				shadowRay.ray = lightRay;
+				shadowRay.dist = lightDist;
+				shadowRay.diffuse = applyDiffuse(&lightRay, currentLight, &intersect);
+				shadowRay.specular = applySpecular(&lightRay, currentLight, lightProjection, &path.ray, &intersect);
+				shadowRays[first++] = shadowRay;
+			}
+		}
+	}
+
+	// if object has reflection or refraction component, adjust the view ray and coefficent of calculation and keep going
+	bool keepGoing = true;
+	if (SCENE_USES_REFLECTION && intersect.material->reflection)
+	{
+		path.ray = calculateReflection(&path.ray, &intersect);
+		path.coef *= intersect.material->reflection;
+	}
+	else if (SCENE_USES_REFRACTION && intersect.material->refraction)
+	{
+		path.ray = calculateRefraction(&path.ray, &intersect, &path.refractiveIndex);
+		path.coef *= intersect.material->refraction;
+	}
+	else
+	{
+		keepGoing = false;
+	}
+
+	if (keepGoing)
+	{
+		if (level + 1 < MAX_RAYS_CAST)
+		{
+			nextQueue[atomic_inc(&counters[QUEUE_COUNT])] = p;
+		}
+		else if (path.coef > 0.0f)
+		{
+			// reached maximum ray cast limit, so read from the environment map
+			path.skyCoef = path.coef;
+		}
+	}
+
+	paths[p] = path;
+}
+
+// test every queued shadow ray for occlusion
+__kernel void traceShadowRays(WAVEFRONT_SCENE_PARAMS, __global ShadowRay* shadowRays)
+{
+	Scene scene = bindScene(WAVEFRONT_SCENE_ARGS);
+
+	unsigned int i = get_global_id(0);
+	Ray lightRay = shadowRays[i].ray;
+
+	shadowRays[i].occluded = isInShadow(&scene, &lightRay, shadowRays[i].dist);
+}
+
+// add this bounce's lighting (and environment map) to every queued path's colour
+// the lights are added up in the same order as applyLighting
+__kernel void accumulatePaths(WAVEFRONT_SCENE_PARAMS, __global Path* paths, __global const unsigned int* queue, __global const ShadowRay* shadowRays)
+{
+	Scene scene = bindScene(WAVEFRONT_SCENE_ARGS);
+
+	unsigned int p = queue[get_global_id(0)];
+	Path path = paths[p];
+
+	if (path.lit == LIT_BY_SHADOW_RAYS)
+	{
+		float3 lighting = { 0.0f, 0.0f, 0.0f };
+		for (unsigned int i = path.shadowFirst; i < path.shadowFirst + path.numShadowRays; ++i)
+		{
+			if (!shadowRays[i].occluded)
+			{
+				lighting += shadowRays[i].diffuse;
+				lighting += shadowRays[i].specular;
+			}
+		}
+
+		path.colour += path.lightingCoef * lighting;
+	}
+	else if (path.lit == LIT_INLINE)
+	{
+		path.colour += path.lightingCoef * path.lighting;
+	}
+
+	if (path.skyCoef > 0.0f)
+	{
+		path.colour += path.skyCoef * scene.materialContainer[scene.skyboxMaterialId].diffuse;
+	}
+
+	paths[p].colour = path.colour;
+}
+
+// combine the samples of each of the batch's pixels and store the final colour in the output buffer
+__kernel void resolvePixels(__global struct Scene* scenein, int width, int height, int aaLevel, int slotsPerAxis,
+	int tileX, int tileY, int tileWidth, int firstPixel,
+	__global const Path* paths, __global int* out)
+{
+	unsigned int i = get_global_id(0);
+	int slotsPerPixel = slotsPerAxis * slotsPerAxis;
+	int pixel = firstPixel + i;
+
+	int x = tileX + pixel % tileWidth - (width / 2);
+	int y = tileY + pixel / tileWidth - (height / 2);
+
+#ifdef AA_LEVEL
+	aaLevel = AA_LEVEL;
+#endif
+	const float sampleRatio = 1.0f / (aaLevel * aaLevel);
+
+	float3 output = { 0.0f, 0.0f, 0.0f };
+	float fragmentx, fragmenty;
+
+	for (int sample = 0; sample < slotsPerPixel; ++sample)
+	{
+		if (getSample(x, y, sample, aaLevel, slotsPerAxis, &fragmentx, &fragmenty))
+		{
+			output += sampleRatio * paths[i * slotsPerPixel + sample].colour;
+		}
+	}
+
+	out[((y + (height / 2)) * (width)+(x + (width / 2)))] = convertToPixel(output, scenein->exposure);
+}
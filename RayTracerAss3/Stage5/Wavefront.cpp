@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "Wavefront.h"
+
+// counter values at the start of each launch
+static const int zeroCounters[NUM_COUNTERS] = { 0 };
+
+
+// create a kernel from the program, exiting if it can't be found
+static cl_kernel createKernel(cl_program program, const char* name)
+{
+	cl_int err;
+	cl_kernel kernel = clCreateKernel(program, name, &err);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't create the %s kernel = %d\n", name, err);
+		exit(1);
+	}
+
+	return kernel;
+}
+
+// create a device only buffer, exiting if it can't be allocated
+static cl_mem createBuffer(cl_context context, size_t size, const char* name)
+{
+	cl_int err;
+	cl_mem buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, size, NULL, &err);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't create the %s buffer -> %d\n", name, err);
+		exit(1);
+	}
+
+	return buffer;
+}
+
+// set a kernel argument, exiting if it can't be set
+static void setArg(cl_kernel kernel, cl_uint index, size_t size, const void* value)
+{
+	cl_int err = clSetKernelArg(kernel, index, size, value);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't set the wavefront kernel(%d) argument = %d\n", index, err);
+		exit(1);
+	}
+}
+
+// set the scene arguments that come first for every kernel but resolvePixels
+static void setSceneArgs(cl_kernel kernel, const cl_mem sceneBuffers[NUM_SCENE_BUFFERS])
+{
+	for (int i = 0; i < NUM_SCENE_BUFFERS; ++i)
+	{
+		setArg(kernel, i, sizeof(cl_mem), &sceneBuffers[i]);
+	}
+}
+
+// run a kernel over a one dimensional range, exiting if it can't be queued
+static void enqueue(cl_command_queue queue, cl_kernel kernel, size_t size, cl_event* event)
+{
+	cl_int err = clEnqueueNDRangeKernel(queue, kernel, 1, NULL, &size, NULL, 0, NULL, event);
+	if (err != CL_SUCCESS) {
+		printf("Couldn't enqueue the wavefront kernel execution command = %d\n", err);
+		exit(1);
+	}
+}
+
+
+void createWavefront(Wavefront& wavefront, cl_context context, cl_program program, const cl_mem sceneBuffers[NUM_SCENE_BUFFERS], cl_mem outBuffer, int width, int height, int aaLevel)
+{
+	// the sample loops step by 1 / aaLevel, which only adds up exactly (giving aaLevel samples) for powers of two
+	// otherwise rounding can squeeze in an extra sample, so leave room for it
+	wavefront.slotsPerAxis = (aaLevel & (aaLevel - 1)) == 0 ? aaLevel : aaLevel + 1;
+	int slotsPerPixel = wavefront.slotsPerAxis * wavefront.slotsPerAxis;
+
+	// there's no point making room for more paths than the whole image has
+	long long imageSlots = (long long)width * height * slotsPerPixel;
+	wavefront.maxPaths = (int)std::min((long long)std::max(WAVEFRONT_MAX_PATHS, slotsPerPixel), imageSlots);
+	wavefront.maxShadowRays = wavefront.maxPaths * WAVEFRONT_SHADOW_RAYS_PER_PATH;
+
+	wavefront.generateKernel = createKernel(program, "generatePaths");
+	wavefront.intersectKernel = createKernel(program, "intersectPaths");
+	wavefront.shadeKernel = createKernel(program, "shadePaths");
+	wavefront.shadowKernel = createKernel(program, "traceShadowRays");
+	wavefront.accumulateKernel = createKernel(program, "accumulatePaths");
+	wavefront.resolveKernel = createKernel(program, "resolvePixels");
+
+	wavefront.pathBuffer = createBuffer(context, sizeof(WavefrontPath) * wavefront.maxPaths, "path");
+	wavefront.hitBuffer = createBuffer(context, sizeof(WavefrontHit) * wavefront.maxPaths, "hit");
+	wavefront.queueBuffers[0] = createBuffer(context, sizeof(unsigned int) * wavefront.maxPaths, "queue");
+	wavefront.queueBuffers[1] = createBuffer(context, sizeof(unsigned int) * wavefront.maxPaths, "queue");
+	wavefront.shadowRayBuffer = createBuffer(context, sizeof(WavefrontShadowRay) * wavefront.maxShadowRays, "shadow ray");
+	wavefront.counterBuffer = createBuffer(context, sizeof(int) * NUM_COUNTERS, "counter");
+
+	// arguments that don't change between tiles (the rest are set as each tile is rendered)
+	setSceneArgs(wavefront.generateKernel, sceneBuffers);
+	setArg(wavefront.generateKernel, NUM_SCENE_BUFFERS + 0, sizeof(int), &width);
+	setArg(wavefront.generateKernel, NUM_SCENE_BUFFERS + 1, sizeof(int), &height);
+	setArg(wavefront.generateKernel, NUM_SCENE_BUFFERS + 2, sizeof(int), &aaLevel);
+	setArg(wavefront.generateKernel, NUM_SCENE_BUFFERS + 3, sizeof(int), &wavefront.slotsPerAxis);
+	setArg(wavefront.generateKernel, NUM_SCENE_BUFFERS + 8, sizeof(cl_mem), &wavefront.pathBuffer);
+	setArg(wavefront.generateKernel, NUM_SCENE_BUFFERS + 9, sizeof(cl_mem), &wavefront.queueBuffers[0]);
+	setArg(wavefront.generateKernel, NUM_SCENE_BUFFERS + 10, sizeof(cl_mem), &wavefront.counterBuffer);
+
+	setSceneArgs(wavefront.intersectKernel, sceneBuffers);
+	setArg(wavefront.intersectKernel, NUM_SCENE_BUFFERS + 0, sizeof(cl_mem), &wavefront.pathBuffer);
+	setArg(wavefront.intersectKernel, NUM_SCENE_BUFFERS + 2, sizeof(cl_mem), &wavefront.hitBuffer);
+
+	setSceneArgs(wavefront.shadeKernel, sceneBuffers);
+	setArg(wavefront.shadeKernel, NUM_SCENE_BUFFERS + 1, sizeof(int), &wavefront.maxShadowRays);
+	setArg(wavefront.shadeKernel, NUM_SCENE_BUFFERS + 2, sizeof(cl_mem), &wavefront.pathBuffer);
+	setArg(wavefront.shadeKernel, NUM_SCENE_BUFFERS + 4, sizeof(cl_mem), &wavefront.hitBuffer);
+	setArg(wavefront.shadeKernel, NUM_SCENE_BUFFERS + 6, sizeof(cl_mem), &wavefront.shadowRayBuffer);
+	setArg(wavefront.shadeKernel, NUM_SCENE_BUFFERS + 7, sizeof(cl_mem), &wavefront.counterBuffer);
+
+	setSceneArgs(wavefront.shadowKernel, sceneBuffers);
+	setArg(wavefront.shadowKernel, NUM_SCENE_BUFFERS + 0, sizeof(cl_mem), &wavefront.shadowRayBuffer);
+
+	setSceneArgs(wavefront.accumulateKernel, sceneBuffers);
+	setArg(wavefront.accumulateKernel, NUM_SCENE_BUFFERS + 0, sizeof(cl_mem), &wavefront.pathBuffer);
+	setArg(wavefront.accumulateKernel, NUM_SCENE_BUFFERS + 2, sizeof(cl_mem), &wavefront.shadowRayBuffer);
+
+	setArg(wavefront.resolveKernel, 0, sizeof(cl_mem), &sceneBuffers[0]);
+	setArg(wavefront.resolveKernel, 1, sizeof(int), &width);
+	setArg(wavefront.resolveKernel, 2, sizeof(int), &height);
+	setArg(wavefront.resolveKernel, 3, sizeof(int), &aaLevel);
+	setArg(wavefront.resolveKernel, 4, sizeof(int), &wavefront.slotsPerAxis);
+	setArg(wavefront.resolveKernel, 9, sizeof(cl_mem), &wavefront.pathBuffer);
+	setArg(wavefront.resolveKernel, 10, sizeof(cl_mem), &outBuffer);
+}
+
+
+void renderTileWavefront(Wavefront& wavefront, cl_command_queue queue, int tileX, int tileY, int tileWidth, int tileHeight, cl_event* started, cl_event* finished)
+{
+	cl_int err;
+	int counters[NUM_COUNTERS];
+
+	// split the tile into batches of whole pixels that fit in the path buffer
+	int slotsPerPixel = wavefront.slotsPerAxis * wavefront.slotsPerAxis;
+	int tilePixels = tileWidth * tileHeight;
+	int pixelsPerBatch = wavefront.maxPaths / slotsPerPixel;
+
+	for (int firstPixel = 0; firstPixel < tilePixels; firstPixel += pixelsPerBatch)
+	{
+		int numPixels = std::min(pixelsPerBatch, tilePixels - firstPixel);
+
+		// create a path for every sample
+		setArg(wavefront.generateKernel, NUM_SCENE_BUFFERS + 4, sizeof(int), &tileX);
+		setArg(wavefront.generateKernel, NUM_SCENE_BUFFERS + 5, sizeof(int), &tileY);
+		setArg(wavefront.generateKernel, NUM_SCENE_BUFFERS + 6, sizeof(int), &tileWidth);
+		setArg(wavefront.generateKernel, NUM_SCENE_BUFFERS + 7, sizeof(int), &firstPixel);
+
+		clEnqueueWriteBuffer(queue, wavefront.counterBuffer, CL_FALSE, 0, sizeof(zeroCounters), zeroCounters, 0, NULL, firstPixel == 0 ? started : NULL);
+		enqueue(queue, wavefront.generateKernel, (size_t)numPixels * slotsPerPixel, NULL);
+
+		err = clEnqueueReadBuffer(queue, wavefront.counterBuffer, CL_TRUE, 0, sizeof(counters), counters, 0, NULL, NULL);
+		if (err != CL_SUCCESS) {
+			printf("Couldn't read the wavefront counters = %d\n", err);
+			exit(1);
+		}
+
+		// follow the paths a bounce at a time, until they've all finished (or reached the maximum ray cast limit)
+		int current = 0;
+		int queueCount = counters[QUEUE_COUNT];
+
+		for (int level = 0; level < MAX_RAYS_CAST && queueCount > 0; ++level)
+		{
+			cl_mem* currentQueue = &wavefront.queueBuffers[current];
+			cl_mem* nextQueue = &wavefront.queueBuffers[1 - current];
+
+			setArg(wavefront.intersectKernel, NUM_SCENE_BUFFERS + 1, sizeof(cl_mem), currentQueue);
+			setArg(wavefront.shadeKernel, NUM_SCENE_BUFFERS + 0, sizeof(int), &level);
+			setArg(wavefront.shadeKernel, NUM_SCENE_BUFFERS + 3, sizeof(cl_mem), currentQueue);
+			setArg(wavefront.shadeKernel, NUM_SCENE_BUFFERS + 5, sizeof(cl_mem), nextQueue);
+			setArg(wavefront.accumulateKernel, NUM_SCENE_BUFFERS + 1, sizeof(cl_mem), currentQueue);
+
+			clEnqueueWriteBuffer(queue, wavefront.counterBuffer, CL_FALSE, 0, sizeof(zeroCounters), zeroCounters, 0, NULL, NULL);
+			enqueue(queue, wavefront.intersectKernel, queueCount, NULL);
+			enqueue(queue, wavefront.shadeKernel, queueCount, NULL);
+
+			// the shadow ray and next bounce queues are now full, so find out how big they are
+			err = clEnqueueReadBuffer(queue, wavefront.counterBuffer, CL_TRUE, 0, sizeof(counters), counters, 0, NULL, NULL);
+			if (err != CL_SUCCESS) {
+				printf("Couldn't read the wavefront counters = %d\n", err);
+				exit(1);
+			}
+
+			// shade counts the shadow rays it couldn't fit too, so don't go past the end of the buffer
+			int shadowRayCount = std::min(counters[SHADOW_RAY_COUNT], wavefront.maxShadowRays);
+			if (shadowRayCount > 0) enqueue(queue, wavefront.shadowKernel, shadowRayCount, NULL);
+
+			enqueue(queue, wavefront.accumulateKernel, queueCount, NULL);
+
+			queueCount = counters[QUEUE_COUNT];
+			current = 1 - current;
+		}
+
+		// combine the samples into pixels
+		setArg(wavefront.resolveKernel, 5, sizeof(int), &tileX);
+		setArg(wavefront.resolveKernel, 6, sizeof(int), &tileY);
+		setArg(wavefront.resolveKernel, 7, sizeof(int), &tileWidth);
+		setArg(wavefront.resolveKernel, 8, sizeof(int), &firstPixel);
+
+		bool lastBatch = firstPixel + numPixels >= tilePixels;
+		enqueue(queue, wavefront.resolveKernel, numPixels, lastBatch ? finished : NULL);
+	}
+}
+
+
+void releaseWavefront(Wavefront& wavefront)
+{
+	clReleaseKernel(wavefront.generateKernel);
+	clReleaseKernel(wavefront.intersectKernel);
+	clReleaseKernel(wavefront.shadeKernel);
+	clReleaseKernel(wavefront.shadowKernel);
+	clReleaseKernel(wavefront.accumulateKernel);
+	clReleaseKernel(wavefront.resolveKernel);
+
+	clReleaseMemObject(wavefront.pathBuffer);
+	clReleaseMemObject(wavefront.hitBuffer);
+	clReleaseMemObject(wavefront.queueBuffers[0]);
+	clReleaseMemObject(wavefront.queueBuffers[1]);
+	clReleaseMemObject(wavefront.shadowRayBuffer);
+	clReleaseMemObject(wavefront.counterBuffer);
+}
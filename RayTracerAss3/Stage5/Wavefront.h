@@ -0,0 +1,84 @@
+#ifndef __WAVEFRONT_H
+#define __WAVEFRONT_H
+
+#include "LoadCL.h"
+#include "Primitives.h"
+
+// number of buffers making up the scene, in the order the wavefront kernels take them
+// (scene, materials, lights, spheres, planes, cylinders, BVH nodes, BVH primitive references, compiled scene streams, light hierarchy)
+const int NUM_SCENE_BUFFERS = 12;
+
+// indices into the counters buffer (must match Wavefront.cl)
+const int QUEUE_COUNT = 0;
+const int SHADOW_RAY_COUNT = 1;
+const int NUM_COUNTERS = 2;
+
+// a single sample being followed through the scene
+// laid out to match the Path struct in Wavefront.cl
+typedef struct WavefrontPath
+{
+	Ray ray;
+	Point colour;
+	Point lighting;
+	float coef;
+	float refractiveIndex;
+	float lightingCoef;
+	float skyCoef;
+	unsigned int shadowFirst;
+	unsigned int numShadowRays;
+	int lit;
+} WavefrontPath;
+
+// the closest intersection found for a path
+// laid out to match the Hit struct in Wavefront.cl
+typedef struct WavefrontHit
+{
+	Point pos;
+	Point normal;
+	int objectType;
+	unsigned int objectIndex;
+} WavefrontHit;
+
+// a light ray waiting to be tested for occlusion
+// laid out to match the ShadowRay struct in Wavefront.cl
+typedef struct WavefrontShadowRay
+{
+	Ray ray;
+	Point diffuse;
+	Point specular;
+	float dist;
+	int occluded;
+} WavefrontShadowRay;
+
+// kernels and buffers used by the wavefront (split-kernel) renderer
+typedef struct Wavefront
+{
+	cl_kernel generateKernel;
+	cl_kernel intersectKernel;
+	cl_kernel shadeKernel;
+	cl_kernel shadowKernel;
+	cl_kernel accumulateKernel;
+	cl_kernel resolveKernel;
+
+	cl_mem pathBuffer;
+	cl_mem hitBuffer;
+	cl_mem queueBuffers[2];		// paths to follow this bounce and the next (swapped each bounce)
+	cl_mem shadowRayBuffer;
+	cl_mem counterBuffer;
+
+	int slotsPerAxis;			// most samples a pixel can have along each axis
+	int maxPaths;				// size of the path buffer (and queues)
+	int maxShadowRays;			// size of the shadow ray buffer
+} Wavefront;
+
+// create the wavefront kernels (from the already built program) and the buffers they pass paths between
+void createWavefront(Wavefront& wavefront, cl_context context, cl_program program, const cl_mem sceneBuffers[NUM_SCENE_BUFFERS], cl_mem outBuffer, int width, int height, int aaLevel);
+
+// render a tile into the output buffer, a bounce at a time
+// started (if not NULL) is set to the tile's first command, and finished to an event that completes once the tile's pixels have been written
+void renderTileWavefront(Wavefront& wavefront, cl_command_queue queue, int tileX, int tileY, int tileWidth, int tileHeight, cl_event* started, cl_event* finished);
+
+// release the wavefront kernels and buffers
+void releaseWavefront(Wavefront& wavefront);
+
+#endif // __WAVEFRONT_H
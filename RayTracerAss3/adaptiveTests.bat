@@ -0,0 +1,5 @@
+@rem adaptive anti-aliasing: a cheap pass, then the full grid of samples only where it has contrast
+@rem prints the samples saved and the error against the uniform reference render
+
+Release\RayTracerAss3.exe -runs 1 -size 1000 1000 -samples 4 -output Outputs/a03s00adaptive02.bmp -input Scenes/allmaterials.txt -adaptive -reference Outputs_REFERENCE/a03s00t02.bmp
+Release\Stage5.exe -runs 1 -size 1000 1000 -samples 4 -output Outputs/a03s05adaptive02.bmp -input Scenes/allmaterials.txt -adaptive -reference Outputs_REFERENCE/a03s00t02.bmp
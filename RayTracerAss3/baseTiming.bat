@@ -2,13 +2,14 @@
 set runs=%1
 if "%1"=="" set runs=5
 @ECHO ON
-Release\RayTracerAss3.exe -runs %runs% -size 1024 1024 -samples 1  -input Scenes/cornell.txt  
-Release\RayTracerAss3.exe -runs %runs% -size 1024 1024 -samples 4  -input Scenes/cornell.txt  
-Release\RayTracerAss3.exe -runs %runs% -size 1024 1024 -samples 16 -input Scenes/cornell.txt  
-Release\RayTracerAss3.exe -runs %runs% -size 1000 1000 -samples 4  -input Scenes/allmaterials.txt 
-Release\RayTracerAss3.exe -runs %runs% -size 1280  720 -samples 1  -input Scenes/5000spheres.txt 
-Release\RayTracerAss3.exe -runs %runs% -size 1024 1024 -samples 1  -input Scenes/donuts.txt 
-Release\RayTracerAss3.exe -runs %runs% -size 1024 1024 -samples 1  -input Scenes/cornell-199lights.txt
+@rem standard scene/size/sample matrix (median, p95, Mrays/s and samples/s of each configuration)
+Release\Benchmark.exe -exe Release\RayTracerAss3.exe -repeats %runs% -csv Outputs/baseTiming.csv -json Outputs/baseTiming.json
+
+@rem single-threaded reference (the runs above use every core)
+Release\Benchmark.exe -exe Release\RayTracerAss3.exe -args "-threads 1" -repeats %runs% -csv Outputs/baseTiming_1thread.csv -json Outputs/baseTiming_1thread.json
+
+@rem to check for a regression, compare against results saved earlier (exits with 1 if any configuration is over 5%% slower)
+@rem Release\Benchmark.exe -exe Release\RayTracerAss3.exe -repeats %runs% -baseline Outputs/baseTiming_baseline.csv -threshold 5
 
 @rem Release\RayTracerAss1.exe -runs %runs% -threads 32 -size 1024 1024 -samples 1  -input Scenes/cornell.txt  
 @rem Release\RayTracerAss1.exe -runs %runs% -threads 32 -size 1024 1024 -samples 4  -input Scenes/cornell.txt  
@@ -6,9 +6,9 @@ Release\Stage1.exe -runs 1 -size 1280 720  -samples 1 -output Outputs/a03s01t03.
 Release\Stage1.exe -runs 1 -size 1024 1024 -samples 1 -output Outputs/a03s01t04.bmp -input Scenes/donuts.txt 
 Release\Stage1.exe -runs 1 -size 1024 1024 -samples 1 -output Outputs/a03s01t05.bmp -input Scenes/cornell-199lights.txt
 
-magick compare -metric mae Outputs\a03s01t01.bmp Outputs_REFERENCE\a03s01t01.bmp Outputs\stage1diff_01.bmp
-magick compare -metric mae Outputs\a03s01t02.bmp Outputs_REFERENCE\a03s01t02.bmp Outputs\stage1diff_02.bmp
-magick compare -metric mae Outputs\a03s01t03.bmp Outputs_REFERENCE\a03s01t03.bmp Outputs\stage1diff_03.bmp
-magick compare -metric mae Outputs\a03s01t04.bmp Outputs_REFERENCE\a03s01t04.bmp Outputs\stage1diff_04.bmp
-magick compare -metric mae Outputs\a03s01t05.bmp Outputs_REFERENCE\a03s01t05.bmp Outputs\stage1diff_05.bmp
+Release\Compare.exe Outputs\a03s01t01.bmp Outputs_REFERENCE\a03s01t01.bmp -diff Outputs\stage1diff_01.bmp
+Release\Compare.exe Outputs\a03s01t02.bmp Outputs_REFERENCE\a03s01t02.bmp -diff Outputs\stage1diff_02.bmp
+Release\Compare.exe Outputs\a03s01t03.bmp Outputs_REFERENCE\a03s01t03.bmp -diff Outputs\stage1diff_03.bmp
+Release\Compare.exe Outputs\a03s01t04.bmp Outputs_REFERENCE\a03s01t04.bmp -diff Outputs\stage1diff_04.bmp
+Release\Compare.exe Outputs\a03s01t05.bmp Outputs_REFERENCE\a03s01t05.bmp -diff Outputs\stage1diff_05.bmp
 
@@ -6,9 +6,9 @@ Release\Stage4.exe -runs 1 -size 1280 720  -samples 1 -output Outputs/a03s04t03.
 Release\Stage4.exe -runs 1 -size 1024 1024 -samples 1 -output Outputs/a03s04t04.bmp -input Scenes/donuts.txt 
 Release\Stage4.exe -runs 1 -size 1024 1024 -samples 1 -output Outputs/a03s04t05.bmp -input Scenes/cornell-199lights.txt
 
-magick compare -metric mae Outputs\a03s04t01.bmp Outputs_REFERENCE\a03s04t01.bmp Outputs\stage4diff_01.bmp
-magick compare -metric mae Outputs\a03s04t02.bmp Outputs_REFERENCE\a03s04t02.bmp Outputs\stage4diff_02.bmp
-magick compare -metric mae Outputs\a03s04t03.bmp Outputs_REFERENCE\a03s04t03.bmp Outputs\stage4diff_03.bmp
-magick compare -metric mae Outputs\a03s04t04.bmp Outputs_REFERENCE\a03s04t04.bmp Outputs\stage4diff_04.bmp
-magick compare -metric mae Outputs\a03s04t05.bmp Outputs_REFERENCE\a03s04t05.bmp Outputs\stage4diff_05.bmp
+Release\Compare.exe Outputs\a03s04t01.bmp Outputs_REFERENCE\a03s04t01.bmp -diff Outputs\stage4diff_01.bmp
+Release\Compare.exe Outputs\a03s04t02.bmp Outputs_REFERENCE\a03s04t02.bmp -diff Outputs\stage4diff_02.bmp
+Release\Compare.exe Outputs\a03s04t03.bmp Outputs_REFERENCE\a03s04t03.bmp -diff Outputs\stage4diff_03.bmp
+Release\Compare.exe Outputs\a03s04t04.bmp Outputs_REFERENCE\a03s04t04.bmp -diff Outputs\stage4diff_04.bmp
+Release\Compare.exe Outputs\a03s04t05.bmp Outputs_REFERENCE\a03s04t05.bmp -diff Outputs\stage4diff_05.bmp
 
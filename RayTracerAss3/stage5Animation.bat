@@ -0,0 +1,11 @@
+@rem camera path animation: every frame of cornellFlythrough.txt is rendered by one process, which only writes the camera to the device between frames
+@rem each frame is written out while the next one renders (see "frame hand-off" in the timing for any wait on it)
+
+Release\Stage5.exe -size 640 480 -samples 1 -input Scenes/cornell.txt -animation cornellFlythrough.txt -output Outputs/a03s05anim.bmp
+
+@rem the first frame is the scene's own camera, so it should match a still render
+Release\Stage5.exe -size 640 480 -samples 1 -input Scenes/cornell.txt -output Outputs/a03s05anim_still.bmp
+Release\Compare.exe Outputs\a03s05anim_0000.bmp Outputs\a03s05anim_still.bmp -diff Outputs\animdiff_01.bmp
+
+@rem the same path with the wavefront renderer (its kernels read the camera from the same scene header)
+Release\Stage5.exe -size 640 480 -samples 1 -input Scenes/cornell.txt -animation cornellFlythrough.txt -wavefront -output Outputs/a03s05animwave.bmp
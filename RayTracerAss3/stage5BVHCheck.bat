@@ -0,0 +1,10 @@
+@rem hierarchy check: renders on the host walking the BVH and with the brute-force loops, and prints how many pixels differ
+@rem (exits with 1 if any do), writing the brute-force image so the device render can be compared with it as well
+
+Release\Stage5.exe -checkBVH -size 512 512 -samples 1 -output Outputs/a03s05bvh01.bmp -input Scenes/donuts.txt
+Release\Stage5.exe -size 512 512 -samples 1 -output Outputs/a03s05bvh02.bmp -input Scenes/donuts.txt
+Release\Compare.exe Outputs\a03s05bvh02.bmp Outputs\a03s05bvh01.bmp -diff Outputs\bvhdiff_01.bmp
+
+Release\Stage5.exe -checkBVH -size 512 512 -samples 1 -output Outputs/a03s05bvh03.bmp -input Scenes/5000spheres.txt
+Release\Stage5.exe -size 512 512 -samples 1 -output Outputs/a03s05bvh04.bmp -input Scenes/5000spheres.txt
+Release\Compare.exe Outputs\a03s05bvh04.bmp Outputs\a03s05bvh03.bmp -diff Outputs\bvhdiff_02.bmp
@@ -0,0 +1,13 @@
+@rem binary scenes: convert the text scenes once (the hierarchy and compiled streams are stored too), then render straight from the mapped files
+@rem the binary renders should match the text ones exactly
+
+Release\Stage5.exe -input Scenes/5000spheres.txt -convertScene Scenes/5000spheres.bscene
+Release\Stage5.exe -input Scenes/donuts.txt -convertScene Scenes/donuts.bscene
+
+Release\Stage5.exe -size 1024 1024 -samples 1 -output Outputs/a03s05binary01.bmp -input Scenes/5000spheres.bscene
+Release\Stage5.exe -size 1024 1024 -samples 1 -output Outputs/a03s05text01.bmp -input Scenes/5000spheres.txt
+Release\Compare.exe Outputs\a03s05binary01.bmp Outputs\a03s05text01.bmp -diff Outputs\binarydiff_01.bmp
+
+Release\Stage5.exe -size 1024 1024 -samples 1 -output Outputs/a03s05binary02.bmp -input Scenes/donuts.bscene
+Release\Stage5.exe -size 1024 1024 -samples 1 -output Outputs/a03s05text02.bmp -input Scenes/donuts.txt
+Release\Compare.exe Outputs\a03s05binary02.bmp Outputs\a03s05text02.bmp -diff Outputs\binarydiff_02.bmp
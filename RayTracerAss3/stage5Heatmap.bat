@@ -0,0 +1,4 @@
+@rem writes images of the intersection tests, shadow rays and bounces of each pixel beside the output, and prints the totals
+
+Release\Stage5.exe -size 1024 1024 -samples 1 -output Outputs/a03s05heatmap01.bmp -input Scenes/allmaterials.txt -heatmap
+Release\Stage5.exe -size 1024 1024 -samples 1 -output Outputs/a03s05heatmap02.bmp -input Scenes/5000spheres.txt -heatmap
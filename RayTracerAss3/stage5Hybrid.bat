@@ -0,0 +1,9 @@
+@rem hybrid rendering: host threads render tiles with the C++ traceRay alongside the OpenCL device, taking them from the same queue
+@rem prints the share of the tiles and the samples per second of the device and the host, and checks against a device-only render
+
+Release\Stage5.exe -size 1024 1024 -samples 4 -output Outputs/a03s05hybrid01.bmp -input Scenes/allmaterials.txt -hostThreads 4 -blockSize 64
+Release\Stage5.exe -size 1024 1024 -samples 4 -output Outputs/a03s05hybrid02.bmp -input Scenes/allmaterials.txt
+Release\Compare.exe Outputs\a03s05hybrid01.bmp Outputs\a03s05hybrid02.bmp -diff Outputs\hybriddiff_01.bmp
+
+Release\Stage5.exe -size 1024 1024 -samples 1 -output Outputs/a03s05hybrid03.bmp -input Scenes/donuts.txt -hostThreads 4 -blockSize 64
+Release\Stage5.exe -size 1024 1024 -samples 1 -output Outputs/a03s05hybrid04.bmp -input Scenes/cornell-199lights.txt -device all -hostThreads 2 -blockSize 64
@@ -0,0 +1,7 @@
+@rem many-light sampling on the 199 light cornell box: an exact render, then 1, 4 and 16 lights picked per shading point from the light hierarchy
+@rem each sampled render reports its error against the exact one
+
+Release\Stage5.exe -size 1024 1024 -samples 4 -output Outputs/a03s05manylights00.bmp -input Scenes/cornell-199lights.txt
+Release\Stage5.exe -size 1024 1024 -samples 4 -output Outputs/a03s05manylights01.bmp -input Scenes/cornell-199lights.txt -manyLights 1 -reference Outputs/a03s05manylights00.bmp
+Release\Stage5.exe -size 1024 1024 -samples 4 -output Outputs/a03s05manylights04.bmp -input Scenes/cornell-199lights.txt -manyLights 4 -reference Outputs/a03s05manylights00.bmp
+Release\Stage5.exe -size 1024 1024 -samples 4 -output Outputs/a03s05manylights16.bmp -input Scenes/cornell-199lights.txt -manyLights 16 -reference Outputs/a03s05manylights00.bmp
@@ -0,0 +1,9 @@
+@rem multi-device rendering: tiles are taken from a shared counter by every device picked, faster devices take more of them
+@rem lists the devices, then splits device 0 into 4 sub-devices (e.g. a CPU OpenCL device) and checks against a single device render
+
+Release\Stage5.exe -listDevices
+Release\Stage5.exe -size 1024 1024 -samples 4 -output Outputs/a03s05multi01.bmp -input Scenes/allmaterials.txt -device 0 -subDevices 4 -blockSize 64
+Release\Stage5.exe -size 1024 1024 -samples 4 -output Outputs/a03s05multi02.bmp -input Scenes/allmaterials.txt -device 0
+Release\Compare.exe Outputs\a03s05multi01.bmp Outputs\a03s05multi02.bmp -diff Outputs\multidiff_01.bmp
+
+Release\Stage5.exe -size 1280 720 -samples 1 -output Outputs/a03s05multi03.bmp -input Scenes/5000spheres.txt -device all -blockSize 64
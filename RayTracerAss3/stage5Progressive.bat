@@ -0,0 +1,5 @@
+@rem progressive rendering: a sample of every pixel per pass, stopping at the target or before the time limit runs out
+@rem the second render writes an image every 64 passes beside the output
+
+Release\Stage5.exe -size 2048 2048 -samples 32 -output Outputs/a03s05progressive01.bmp -input Scenes/donuts.txt -progressive -timeLimit 5000
+Release\Stage5.exe -size 1024 1024 -samples 16 -output Outputs/a03s05progressive02.bmp -input Scenes/allmaterials.txt -progressive -targetSamples 256 -intermediate 64
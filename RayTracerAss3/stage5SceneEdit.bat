@@ -0,0 +1,8 @@
+@rem incremental scene edits: the server changes its resident copy of cornell.txt to cornell-edited.txt, writing only the objects that
+@rem changed to the device and refitting the hierarchy, then changes it back (each reply gives edit_ms and how much was written)
+
+Release\Stage5.exe -serve < editJobs.txt
+
+@rem the edited scene should render the same as the edited file loaded from scratch, and editing it back the same as the original
+Release\Compare.exe Outputs\a03s05edit02.bmp Outputs\a03s05edit03.bmp -diff Outputs\editdiff_01.bmp
+Release\Compare.exe Outputs\a03s05edit01.bmp Outputs\a03s05edit04.bmp -diff Outputs\editdiff_02.bmp
@@ -0,0 +1,7 @@
+@rem render server: one process keeps its context, programs and scenes, and renders each line of serveJobs.txt as a job
+@rem each reply gives how long the job took (the second job on a scene shouldn't load it again, or build its program again)
+
+Release\Stage5.exe -serve < serveJobs.txt
+
+@rem the first and last jobs are the same render, so the resident scene and program should give the same image
+Release\Compare.exe Outputs\a03s05serve01.bmp Outputs\a03s05serve05.bmp -diff Outputs\servediff_01.bmp
@@ -0,0 +1,5 @@
+@rem reports Stage5 startup cost: the first run compiles the kernel (cold), the second loads the binary cached beside the executable (warm)
+
+del /q Release\Raytrace_*.clbin 2>nul
+Release\Stage5.exe -runs 1 -size 256 256 -samples 1 -output Outputs/a03s05startup01.bmp -input Scenes/cornell.txt
+Release\Stage5.exe -runs 1 -size 256 256 -samples 1 -output Outputs/a03s05startup02.bmp -input Scenes/cornell.txt
@@ -0,0 +1,9 @@
+@rem streamed output: rows of tiles are written to the file as they finish, so only a couple of rows of tiles are held at once
+@rem the first render is compared against the same image held whole to check streaming doesn't change anything
+
+Release\Stage5.exe -size 1024 1024 -samples 4 -output Outputs/a03s05streamed01.bmp -input Scenes/allmaterials.txt -stream -blockSize 96
+Release\Stage5.exe -size 1024 1024 -samples 4 -output Outputs/a03s05streamed02.bmp -input Scenes/allmaterials.txt
+Release\Compare.exe Outputs\a03s05streamed01.bmp Outputs\a03s05streamed02.bmp -diff Outputs\streameddiff_01.bmp
+
+Release\Stage5.exe -size 8192 8192 -samples 1 -output Outputs/a03s05streamed8k.bmp -input Scenes/allmaterials.txt -stream
+Release\Stage5.exe -size 32768 32768 -samples 1 -output Outputs/a03s05streamed32k.bmp -input Scenes/allmaterials.txt -stream -blockSize 512
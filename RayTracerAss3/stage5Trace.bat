@@ -0,0 +1,3 @@
+@rem writes a timeline of the host phases and every tile's kernel and readback (open it in chrome://tracing or ui.perfetto.dev)
+
+Release\Stage5.exe -runs 3 -size 2048 2048 -samples 1 -blockSize 256 -output Outputs/a03s05trace01.bmp -input Scenes/donuts.txt -trace Outputs/a03s05trace01.json
@@ -0,0 +1,8 @@
+@rem compares the megakernel (func) against the wavefront renderer (-wavefront) on the scenes with the most bounces
+
+Release\Stage5.exe -runs 10 -size 1000 1000 -samples 4  -output Outputs/a03s05timing01.bmp -input Scenes/allmaterials.txt
+Release\Stage5.exe -runs 10 -size 1000 1000 -samples 4  -output Outputs/a03s05timing02.bmp -input Scenes/allmaterials.txt -wavefront
+Release\Stage5.exe -runs 10 -size 1024 1024 -samples 1  -output Outputs/a03s05timing03.bmp -input Scenes/donuts.txt
+Release\Stage5.exe -runs 10 -size 1024 1024 -samples 1  -output Outputs/a03s05timing04.bmp -input Scenes/donuts.txt -wavefront
+Release\Stage5.exe -runs 10 -size 1024 1024 -samples 4  -output Outputs/a03s05timing05.bmp -input Scenes/donuts.txt
+Release\Stage5.exe -runs 10 -size 1024 1024 -samples 4  -output Outputs/a03s05timing06.bmp -input Scenes/donuts.txt -wavefront